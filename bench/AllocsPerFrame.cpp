@@ -0,0 +1,189 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AllocsPerFrame.cpp
+/// @brief counts the heap allocations made by a typical per frame sequence of NGL calls (use a shader,
+/// set some uniforms, read the mesh lists, load a light and material). operator new is replaced so every
+/// allocation made by the library is counted. Build with make bench and run from the pingl directory as
+/// bench/AllocsPerFrame [file.obj], building it against an older tree gives the before numbers.
+/// A 64x64 pbuffer is used for the context so no window is opened. The colour shader has no light or material
+/// uniforms so ShaderProgram warns about them on stderr, the counts are the last line on stdout.
+//----------------------------------------------------------------------------------------------------------------------
+#include <bcm_host.h>
+#include <EGL/egl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include "ShaderLib.h"
+#include "Obj.h"
+#include "Light.h"
+#include "Material.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+// every new / new[] in the process goes through these so the library calls are counted
+static unsigned long s_allocations=0;
+
+void *operator new(size_t _size)
+{
+  ++s_allocations;
+  void *p=malloc(_size !=0 ? _size : 1);
+  if(p == 0)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t _size)
+{
+  return operator new(_size);
+}
+
+void operator delete(void *_p) throw()
+{
+  free(_p);
+}
+
+void operator delete[](void *_p) throw()
+{
+  free(_p);
+}
+
+#if __cplusplus >= 201402L
+// newer compilers default to C++14 or later and call the sized versions
+void operator delete(void *_p, size_t) throw()
+{
+  free(_p);
+}
+
+void operator delete[](void *_p, size_t) throw()
+{
+  free(_p);
+}
+#endif
+
+//----------------------------------------------------------------------------------------------------------------------
+// make a GLES 2 context on a 64x64 pbuffer
+static bool createContext()
+{
+  bcm_host_init();
+  EGLDisplay display=eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if(display == EGL_NO_DISPLAY || eglInitialize(display,0,0) == EGL_FALSE)
+  {
+    std::cerr<<"error initialising display\n";
+    return false;
+  }
+  static const EGLint configAttributes[] =
+  {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint numConfigs=0;
+  eglChooseConfig(display,configAttributes,&config,1,&numConfigs);
+  if(numConfigs == 0)
+  {
+    std::cerr<<"no pbuffer config found\n";
+    return false;
+  }
+  static const EGLint pbufferAttributes[] =
+  {
+    EGL_WIDTH, 64,
+    EGL_HEIGHT, 64,
+    EGL_NONE
+  };
+  static const EGLint contextAttributes[] =
+  {
+    EGL_CONTEXT_CLIENT_VERSION, 2,
+    EGL_NONE
+  };
+  eglBindAPI(EGL_OPENGL_ES_API);
+  EGLSurface surface=eglCreatePbufferSurface(display,config,pbufferAttributes);
+  EGLContext context=eglCreateContext(display,config,EGL_NO_CONTEXT,contextAttributes);
+  if(surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT)
+  {
+    std::cerr<<"couldn't create the pbuffer context\n";
+    return false;
+  }
+  return eglMakeCurrent(display,surface,surface,context) == EGL_TRUE;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+  if(createContext() == false)
+  {
+    return EXIT_FAILURE;
+  }
+  ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+  ngl::Obj mesh(argc > 1 ? argv[1] : "bench/quad.obj");
+  if(mesh.getNumVerts() == 0)
+  {
+    std::cerr<<"the mesh needs vertices, normals and uvs so the list getters have something to return\n";
+    return EXIT_FAILURE;
+  }
+  ngl::Light light(ngl::Vec4(1,1,1,1),ngl::Colour(1,1,1),ngl::POINTLIGHT);
+  ngl::Material material(ngl::GOLD);
+  const std::string program="nglColourShader";
+  const std::string mvpName="MVP";
+  const std::string colourName="Colour";
+  ngl::Mat4 mvp;
+  ngl::Colour colour(1,0,0,1);
+  ngl::Vec4 vec(1,2,3,4);
+  const int frames=100;
+  // the sum stops the compiler dropping the mesh list calls
+  float sum=0.0f;
+
+  // a frame as the demos write it with the names held in std::strings
+  unsigned long start=s_allocations;
+  for(int f=0; f<frames; ++f)
+  {
+    shader->use(program);
+    shader->setShaderParamFromMatrix(mvpName,mvp);
+    shader->setRegisteredUniformFromMatrix(mvpName,mvp);
+    shader->setShaderParamFromColour(colourName,colour);
+    shader->setRegisteredUniformVector(colourName,vec);
+    shader->setRegisteredUniformFromColour(colourName,colour);
+    const std::vector<ngl::Vec3> &verts=mesh.getVertexList();
+    const std::vector<ngl::Vec3> &normals=mesh.getNormalList();
+    const std::vector<ngl::Vec3> &uvs=mesh.getTextureCordList();
+    sum+=verts[0].m_x+normals[0].m_x+uvs[0].m_x+mesh.getVertexAtIndex(1).m_y;
+    light.loadToShader("light[0]");
+    material.loadToShader("material");
+  }
+  unsigned long stored=s_allocations-start;
+
+  // the shader calls again with string literals for the names
+  start=s_allocations;
+  for(int f=0; f<frames; ++f)
+  {
+    shader->use("nglColourShader");
+    shader->setShaderParamFromMatrix("MVP",mvp);
+    shader->setRegisteredUniformFromMatrix("MVP",mvp);
+    shader->setRegisteredUniformFromColour("Colour",colour);
+  }
+  unsigned long literal=s_allocations-start;
+
+  printf("allocations per frame: stored names %.1f literal names %.1f (%g)\n",
+         stored/double(frames),literal/double(frames),sum);
+  return EXIT_SUCCESS;
+}
@@ -32,11 +32,23 @@
 #include "BBox.h"
 #include "NGLassert.h"
 #include "VertexArrayObject.h"
+#include "VertexQuantiser.h"
+#include "MeshOptimiser.h"
+#include "MeshBVH.h"
+#include "Mat4.h"
 #include <cmath>
 #include <boost/tokenizer.hpp>
 
 namespace ngl
 {
+class Camera;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief how the faces around a vertex are weighted when generating smooth normals, NORMAL_AREA
+/// weights each face by its area and NORMAL_ANGLE by the angle of the face corner at the vertex
+/// (which doesn't change when a face is split into more triangles)
+//----------------------------------------------------------------------------------------------------------------------
+enum NORMALWEIGHT{NORMAL_AREA,NORMAL_ANGLE};
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -45,7 +57,8 @@ typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
 
 //----------------------------------------------------------------------------------------------------------------------
 /// @class Face  "include/Obj.h"
-/// @brief simple class used to encapsulate a single face of an abstract mesh file
+/// @brief simple class used to encapsulate a single face of an abstract mesh file. The mesh itself stores
+/// the faces as flat index arrays, this is only used by AbstractMesh::getFaceList for older code
 /// @todo add the ability to have user installable attribute lists
 //----------------------------------------------------------------------------------------------------------------------
 class Face
@@ -104,6 +117,76 @@ public :
                   unsigned _n,
                   unsigned _t
                  ):m_v(_v),m_n(_n),m_t(_t){;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compare two index triples
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool operator==(
+                         const IndexRef &_r
+                        ) const
+                        {
+                          return m_v==_r.m_v && m_n==_r.m_n && m_t==_r.m_t;
+                        }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief value used for m_n or m_t when the face has no normal or texture co-ordinate
+  //----------------------------------------------------------------------------------------------------------------------
+  static const unsigned NOINDEX=0xffffffff;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class IndexRefTable
+/// @brief an open addressing (linear probe) hash table used to weld the v/n/t triples of a mesh into
+/// unique vertices, it only stores indices into the IndexRef list being built so it is very compact
+/// and each lookup is O(1) rather than a search of the whole list.
+//----------------------------------------------------------------------------------------------------------------------
+class IndexRefTable
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _expected the number of unique entries expected, the table will grow if needed
+  //----------------------------------------------------------------------------------------------------------------------
+  IndexRefTable(
+                size_t _expected=0
+               );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the triple in the list, adding it to the end of the list if not already present
+  /// @param[in] _ref the triple to find
+  /// @param[in,out] io_indices the list of unique triples, this must only be modified via this table
+  /// @param[out] o_index the index of the triple in io_indices
+  /// @returns true if the triple was already in the list
+  //----------------------------------------------------------------------------------------------------------------------
+  bool insert(
+              const IndexRef &_ref,
+              std::vector<IndexRef> &io_indices,
+              GLuint &o_index
+             );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief empty the table
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hash the triple
+  //----------------------------------------------------------------------------------------------------------------------
+  static size_t hash(
+                     const IndexRef &_ref
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief re-build the table with a new (power of 2) capacity
+  //----------------------------------------------------------------------------------------------------------------------
+  void rehash(
+              size_t _capacity,
+              const std::vector<IndexRef> &_indices
+             );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the slots each holding an index into the IndexRef list or EMPTY
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_slots;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of used slots
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t m_count;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -122,12 +205,15 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief Method to load the file in
   /// @param[in]  &_fname the name of the obj file to load
+  /// @param[in] _calcBB if we only want to load data and not use GL then set this to false
+  /// @param[in] _numThreads the number of threads the loader may use (0 for all cores)
   //----------------------------------------------------------------------------------------------------------------------
-  virtual bool load(const std::string &_fname,bool _calcBB=true)=0;
+  virtual bool load(const std::string &_fname,bool _calcBB=true,unsigned int _numThreads=1)=0;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief default ctor must be called from the child class so our dtor is called
+  /// @brief default ctor must be called from the child class so our dtor is called, this sets
+  /// the mesh to empty so the dtor is safe even if nothing is loaded
   //----------------------------------------------------------------------------------------------------------------------
-  AbstractMesh(){m_vao=false;}
+  AbstractMesh();
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief destructor this will clear out all the vert data and the vbo if created
   //----------------------------------------------------------------------------------------------------------------------
@@ -171,23 +257,347 @@ public :
 	void calcBoundingSphere();
 
 
-	//----------------------------------------------------------------------------------------------------------------------
-		void createVAO();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief split every face into triangles, convex faces are fanned and concave faces are ear clipped.
+  /// The faces are processed in parallel and the result is stored in m_triangles, a face of n verts
+  /// always gives n-2 triangles which are stored in face order.
+  /// @param[in] _numThreads the number of threads to use (0 for all cores)
+  //----------------------------------------------------------------------------------------------------------------------
+  void triangulate(
+                   unsigned int _numThreads=0
+                  );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief for meshes loaded progressively (see Obj::beginStream) load the next block and add it to
+  /// the VAO, this is usually called once per frame and the mesh can be drawn in between
+  /// @returns true if there is more to load, meshes which don't stream always return false
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual bool streamStep(){return false;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief are we part way through a progressive load
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual bool isStreaming() const {return false;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the number of triangles created by triangulate
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned long int getNumTriangles() const {return m_triangles.size()/3;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the number of triangles a face was split into
+  /// @param[in] _face the face index
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getFaceTriangleCount(
+                                           unsigned long int _face
+                                          ) const
+                                          {
+                                            return m_faceTriStart[_face+1]-m_faceTriStart[_face];
+                                          }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the first triangle of a face, the face triangles are contiguous
+  /// @param[in] _face the face index
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned long int getFaceTriangleStart(
+                                                unsigned long int _face
+                                               ) const
+                                               {
+                                                 return m_faceTriStart[_face];
+                                               }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map a triangle of the VAO back to the face it came from so this can be used for picking,
+  /// if the indices have been re-ordered by optimiseIndices the draw order is used
+  /// @param[in] _triangle the triangle index
+  /// @returns the index of the source face
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long int getTriangleFace(
+                                    unsigned long int _triangle
+                                   ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the BVH of the mesh triangles used by intersectRay, closestPoint and sphereOverlap. The
+  /// queries build it on first use so this only needs calling to do the work up front (for example on a
+  /// loader thread). The ids in the BVH are the source faces. Moving a vertex with setVertexAtIndex or
+  /// streaming in more faces removes the BVH so it is rebuilt by the next query
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildBVH();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the BVH of the mesh, building it if needed
+  //----------------------------------------------------------------------------------------------------------------------
+  const MeshBVH &getBVH();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the nearest face hit by a ray in model space, for picking un-project the mouse at the
+  /// near and far planes with the inverse of the model view projection matrix to get the ray
+  /// @param[in] _origin the start of the ray
+  /// @param[in] _dir the direction of the ray
+  /// @param[out] o_hit the hit, m_id is the face index
+  /// @param[in] _maxT only hits closer than this (in units of _dir) are found
+  /// @returns true if the mesh was hit
+  //----------------------------------------------------------------------------------------------------------------------
+  bool intersectRay(
+                    const Vec3 &_origin,
+                    const Vec3 &_dir,
+                    BVHHit &o_hit,
+                    Real _maxT=1e30f
+                   );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the closest point on the mesh surface to a point
+  /// @param[in] _point the query point in model space
+  /// @param[out] o_hit the closest point, m_t is the distance and m_id the face index
+  /// @param[in] _maxDistance only points closer than this are found
+  /// @returns true if a point was found
+  //----------------------------------------------------------------------------------------------------------------------
+  bool closestPoint(
+                    const Vec3 &_point,
+                    BVHHit &o_hit,
+                    Real _maxDistance=1e30f
+                   );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the faces touching a sphere
+  /// @param[in] _center the center of the sphere in model space
+  /// @param[in] _radius the radius of the sphere
+  /// @param[out] o_faces the sorted face indices
+  //----------------------------------------------------------------------------------------------------------------------
+  void sphereOverlap(
+                     const Vec3 &_center,
+                     Real _radius,
+                     std::vector<GLuint> &o_faces
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief weld the triangle corners into unique v/n/t vertices, this fills in m_indices with the unique
+  /// triples and m_outIndices with an index into m_indices for each triangle corner. The mesh is
+  /// triangulated first if needed
+  //----------------------------------------------------------------------------------------------------------------------
+  void weldVertices();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief re-order the welded index buffer for the post transform vertex cache, then optionally for
+  /// overdraw, then re-order the unique vertices for fetch locality (see MeshOptimiser.h). The mesh is
+  /// welded first if needed
+  /// @param[in] _overdraw if true the triangles are also clustered to reduce overdraw
+  //----------------------------------------------------------------------------------------------------------------------
+  void optimiseIndices(
+                       bool _overdraw=true
+                      );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the vertex cache statistics of the welded index buffer before and after the last
+  /// optimiseIndices, both are zero if it hasn't been called
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const VertexCacheStats &getCacheStatsBefore() const {return m_cacheStatsBefore;}
+  inline const VertexCacheStats &getCacheStatsAfter() const {return m_cacheStatsAfter;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set if createVAO(true) optimises the index buffer, this is on by default
+  /// @param[in] _optimise if true call optimiseIndices after welding
+  /// @param[in] _overdraw if true also optimise for overdraw
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setIndexOptimisation(
+                                   bool _optimise,
+                                   bool _overdraw=true
+                                  )
+                                  {
+                                    m_optimiseIndices=_optimise;
+                                    m_optimiseOverdraw=_overdraw;
+                                  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build a chain of simplified LODs from the welded mesh with quadric error simplification (see
+  /// MeshSimplifier.h). The LODs are index lists into the same vertices as the full mesh, uv / normal seams
+  /// and open edges are kept. The mesh is welded first if needed. createVAO(true) packs the LODs into the
+  /// index buffer so use setLODGeneration to build them as part of createVAO
+  /// @param[in] _numLevels the number of LODs to make after the full mesh
+  /// @param[in] _ratio the fraction of the triangles kept at each level
+  //----------------------------------------------------------------------------------------------------------------------
+  void generateLODs(
+                    unsigned int _numLevels=4,
+                    Real _ratio=0.5f
+                   );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set if createVAO(true) builds LODs, this is off by default
+  /// @param[in] _numLevels the number of LODs after the full mesh (0 for none)
+  /// @param[in] _ratio the fraction of the triangles kept at each level
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setLODGeneration(
+                               unsigned int _numLevels,
+                               Real _ratio=0.5f
+                              )
+                              {
+                                m_lodLevels=_numLevels;
+                                m_lodRatio=_ratio;
+                              }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the number of LODs in the VAO including the full mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getNumLODs() const {return m_lodCount.size() !=0 ? m_lodCount.size() : 1;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the number of triangles in a LOD of the VAO
+  /// @param[in] _lod the LOD, 0 is the full mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getLODTriangles(
+                                      unsigned int _lod
+                                     ) const
+                                     {
+                                       return _lod < m_lodCount.size() ? m_lodCount[_lod]/3 : m_meshSize/3;
+                                     }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the LOD used by draw
+  /// @param[in] _lod the LOD, 0 is the full mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setLOD(
+                     unsigned int _lod
+                    )
+                    {
+                      m_lod= _lod < m_lodCount.size() ? _lod : 0;
+                    }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the LOD used by draw
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getLOD() const {return m_lod;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief pick a LOD from how big the bounding sphere is on screen, the LOD chosen keeps about the same
+  /// number of triangles per pixel as the full mesh has at _fullDetailSize
+  /// @param[in] _cam the camera used to draw the mesh
+  /// @param[in] _transform the model transform of the mesh
+  /// @param[in] _fullDetailSize the size of the sphere (as a fraction of the viewport height) where the
+  /// full mesh is used
+  /// @returns the LOD to pass to setLOD
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int selectLOD(
+                         const Camera &_cam,
+                         const Mat4 &_transform,
+                         Real _fullDetailSize=0.5f
+                        ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief generate smooth vertex normals replacing any loaded ones, the face normals and weights are
+  /// worked out in parallel over the faces and then summed in parallel over the vertices. With a crease
+  /// angle below 180 a face only smooths with the faces around a vertex within that angle of it, so the
+  /// vertex can get more than one normal. Any triangulated / welded data is cleared so the next
+  /// createVAO uses the new normals
+  /// @param[in] _weight how the faces around a vertex are weighted
+  /// @param[in] _creaseAngle the crease angle in degrees, 180 for fully smooth
+  /// @param[in] _numThreads the number of threads to use (0 for all cores)
+  //----------------------------------------------------------------------------------------------------------------------
+  void calcNormals(
+                   NORMALWEIGHT _weight=NORMAL_ANGLE,
+                   Real _creaseAngle=180.0f,
+                   unsigned int _numThreads=0
+                  );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief recalculate only the normals affected by moving some vertices (see setVertexAtIndex), for
+  /// deforming meshes. The faces using the vertices and the normals of all the vertices of those faces
+  /// are redone with the settings from calcNormals, keeping the smoothing groups it found. If calcNormals
+  /// hasn't been called it is called now
+  /// @param[in] _changedVerts the indices of the vertices which have moved
+  /// @param[out] o_changedNormals if not null set to the sorted indices of the normals which were updated
+  /// @param[in] _numThreads the number of threads to use (0 for all cores)
+  //----------------------------------------------------------------------------------------------------------------------
+  void updateNormals(
+                     const std::vector<GLuint> &_changedVerts,
+                     std::vector<GLuint> *o_changedNormals=0,
+                     unsigned int _numThreads=0
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set if createVAO (and prepareVAO) generate normals for meshes loaded without any, this is
+  /// on by default using angle weighting and no crease angle
+  /// @param[in] _generate true to generate missing normals
+  /// @param[in] _weight how the faces around a vertex are weighted
+  /// @param[in] _creaseAngle the crease angle in degrees, 180 for fully smooth
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setNormalGeneration(
+                                  bool _generate,
+                                  NORMALWEIGHT _weight=NORMAL_ANGLE,
+                                  Real _creaseAngle=180.0f
+                                 )
+                                 {
+                                   m_generateNormals=_generate;
+                                   m_normalWeight=_weight;
+                                   m_creaseAngle=_creaseAngle;
+                                 }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief generate a tangent for each vertex of the VAO for normal mapping following the MikkTSpace
+  /// conventions: each triangle's tangent comes from its uv derivatives, is projected onto the vertex
+  /// normal and the corners are angle weighted. The w of each tangent is the bitangent sign so the
+  /// shader bitangent is w*cross(n,t). The welded vertices can't be split so a vertex shared by
+  /// triangles with mirrored uvs takes the sign of most of its corners. The triangles and the vertex
+  /// sums are done in parallel
+  /// @param[in] _indexed if true the tangents are for the welded vertices (see weldVertices) else one
+  /// per triangle corner, this should match the createVAO call
+  /// @param[in] _numThreads the number of threads to use (0 for all cores)
+  //----------------------------------------------------------------------------------------------------------------------
+  void calcTangents(
+                    bool _indexed=false,
+                    unsigned int _numThreads=0
+                   );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set if createVAO generates tangents and adds them as an extra attribute stream on attribute
+  /// 3 (4 floats, or 4 normalised bytes for VERTEX_QUANTISED), this is off by default
+  /// @param[in] _generate true to add tangents
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setTangentGeneration(
+                                   bool _generate
+                                  )
+                                  {
+                                    m_generateTangents=_generate;
+                                  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the tangents made by calcTangents, xyz is the tangent and w the bitangent sign
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector<Vec4> &getTangents() const {return m_tangents;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief do the CPU side work of createVAO (triangulate, weld, LODs and index optimisation) without
+  /// touching GL, so it can be run on a loader thread. createVAO with the same _indexed value then only
+  /// has to pack and upload the data
+  /// @param[in] _indexed if true the mesh is welded for an indexed VAO
+  //----------------------------------------------------------------------------------------------------------------------
+  void prepareVAO(
+                  bool _indexed=false
+                 );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create the VAO used to draw the mesh
+  /// @param[in] _indexed if true the welded unique vertices are uploaded with an index buffer,
+  /// else every triangle corner is expanded into the vertex buffer
+  /// @param[in] _format the vertex layout, VERTEX_QUANTISED halves the size of the vertex data but the
+  /// model matrix must then include getDequantiseTransform (see VertexQuantiser.h)
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual void createVAO(
+                 bool _indexed=false,
+                 VERTEXFORMAT _format=VERTEX_FLOAT
+                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the vertex layout the VAO was created with
+  //----------------------------------------------------------------------------------------------------------------------
+  inline VERTEXFORMAT getVertexFormat() const {return m_vertexFormat;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the matrix to turn the quantised positions back into model space, draw with
+  /// getDequantiseTransform()*model as the model matrix. This is the identity for VERTEX_FLOAT
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const Mat4 &getDequantiseTransform() const {return m_dequantise;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the uv scale (x,y) and offset (z,w) for quantised uvs which were outside 0-1,
+  /// this is (1,1,0,0) otherwise
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const Vec4 &getUVTransform() const {return m_uvTransform;}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief get the texture id
   /// @returns the texture id
   //----------------------------------------------------------------------------------------------------------------------
   unsigned int getTextureID() const { return m_textureID; }
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief map the VBO vertex data
-  /// @returns a pointer to the VBO vertex data
+  /// @brief map the VAO vertex data for editing. GLES 2 can't read buffers back so this is a CPU copy of the
+  /// buffer, kept from the first map on, with getBufferPackSize floats per vertex laid out u,v,nx,ny,nz,x,y,z.
+  /// Only VAOs with one float format buffer can be mapped
+  /// @returns a pointer to the vertex data or 0 if the VAO can't be mapped
   //----------------------------------------------------------------------------------------------------------------------
   Real *mapVAOVerts();
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief unmap the VBO based
+  /// @brief finish editing the mapped vertices and send the changed byte ranges to GL, ranges close together
+  /// are sent as one. The ranges given to markVAOVertsDirty are used if there are any, else the changed
+  /// vertices are found by comparing with what was last uploaded
   //----------------------------------------------------------------------------------------------------------------------
   void unMapVAO();
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief say which mapped vertices have been edited so unMapVAO needn't search for them, this is worth
+  /// doing for big meshes as the search reads the whole buffer twice
+  /// @param[in] _first the first vertex edited
+  /// @param[in] _count the number of vertices edited
+  //----------------------------------------------------------------------------------------------------------------------
+  void markVAOVertsDirty(
+                         unsigned int _first,
+                         unsigned int _count
+                        );
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief get a pointer to the indices used to represent the VBO data, this is used in the clip
   /// class when re-ordering the clip data values
   /// @returns the array of indices
@@ -195,11 +605,16 @@ public :
   inline const std::vector<IndexRef> & getIndices() { return m_indices; }
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief save the mesh as NCCA Binary VBO format
-  /// basically this format is the processed binary vbo mesh data as
-  /// as packed by the CreateVBO() method is called.
-  //----------------------------------------------------------------------------------------------------------------------
-  void saveNCCABinaryMesh(
-                          const std::string &_fname
+  /// basically this format is the welded interleaved vertex data and index buffer as packed
+  /// by createVAO(true) along with the bounds and the BVH, see NCCABinaryMesh.h for the layout and loader.
+  /// This does not need a GL context so can be used in offline tools.
+  /// @param[in] _fname the name of the file to save
+  /// @param[in] _optimise if true the indices are optimised with optimiseIndices before saving
+  /// @returns true if the file was written
+  //----------------------------------------------------------------------------------------------------------------------
+  bool saveNCCABinaryMesh(
+                          const std::string &_fname,
+                          bool _optimise=true
                          );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief a method to get the current bounding box of the mesh
@@ -211,37 +626,79 @@ public :
                           return *m_ext;
                         }
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief accessor for the vertex data
+  /// @brief accessor for the vertex data, this is a reference to the mesh data so nothing is copied
   /// @returns a std::vector containing the vert data
   //----------------------------------------------------------------------------------------------------------------------
-  std::vector <ngl::Vec3> getVertexList(){return m_verts;}
+  inline const std::vector <ngl::Vec3> &getVertexList() const {return m_verts;}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief accessor for the vertex data
   /// @returns a std::vector containing the vert data
   //----------------------------------------------------------------------------------------------------------------------
-  inline ngl::Vec3 getVertexAtIndex(
+  inline const ngl::Vec3 &getVertexAtIndex(
                                        unsigned long int _i
                                      ) const
                                       {
                                         //NGL_ASSERT(_i>0 && _i<m_nVerts);
                                         return m_verts[_i];
                                       }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief move a vertex, the VAO is not changed (see updateNormals for deforming meshes) and the
+  /// BVH is removed to be rebuilt by the next query
+  /// @param[in] _i the vertex index
+  /// @param[in] _v the new position
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setVertexAtIndex(
+                               unsigned long int _i,
+                               const Vec3 &_v
+                              )
+                              {
+                                m_verts[_i]=_v;
+                                m_bvh.clear();
+                              }
 
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief accessor for the normals data
+  /// @brief accessor for the normals data, this is a reference to the mesh data so nothing is copied
   /// @returns a std::vector containing the normal data
   //----------------------------------------------------------------------------------------------------------------------
-  std::vector <ngl::Vec3> getNormalList(){return m_norm;}
+  inline const std::vector <ngl::Vec3> &getNormalList() const {return m_norm;}
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief accessor for the texture co-ordinates data
+  /// @brief accessor for the texture co-ordinates data, this is a reference to the mesh data so nothing is copied
   /// @returns a std::vector containing the texture cord data
   //----------------------------------------------------------------------------------------------------------------------
-  std::vector <ngl::Vec3> getTextureCordList(){return m_tex;}
+  inline const std::vector <ngl::Vec3> &getTextureCordList() const {return m_tex;}
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief accessor for the Face data
+  /// @brief accessor for the Face data, this builds a Face for each face of the mesh so is slow
+  /// for large meshes, use getFaceNumVerts and the face index arrays instead
   /// @returns a std::vector containing the face data
   //----------------------------------------------------------------------------------------------------------------------
-  std::vector <Face> getFaceList(){return m_face;}
+  std::vector <Face> getFaceList() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor to get the number of vertices in a face
+  /// @param[in] _face the face index
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getFaceNumVerts(
+                                      unsigned long int _face
+                                     ) const
+                                     {
+                                       return m_faceOffset[_face+1]-m_faceOffset[_face];
+                                     }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the start of each face in the face index arrays, there is an extra entry
+  /// at the end holding the total number of face corners
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector<GLuint> & getFaceOffsets() const {return m_faceOffset;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the vertex index of each face corner
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector<GLuint> & getFaceVertIndices() const {return m_faceVert;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the normal index of each face corner (IndexRef::NOINDEX if not present)
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector<GLuint> & getFaceNormalIndices() const {return m_faceNorm;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the texture cord index of each face corner (IndexRef::NOINDEX if not present)
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector<GLuint> & getFaceTexIndices() const {return m_faceTex;}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief accessor to get the number of vertices in the object
   //----------------------------------------------------------------------------------------------------------------------
@@ -272,7 +729,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   inline Vec3 getCenter() const {return m_center;}
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief check to see if obj is triangulated as we only support tri or quad objs at the moment
+  /// @brief check to see if every face of the mesh is a triangle
   /// @returns true or false
   //----------------------------------------------------------------------------------------------------------------------
   bool isTriangular();
@@ -308,22 +765,130 @@ protected :
   //----------------------------------------------------------------------------------------------------------------------
   std::vector<Vec3> m_tex;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief Pointer to the Face list
+  /// @brief the start of each face in the corner arrays below with an extra entry for the total, so the
+  /// corners of face i are [m_faceOffset[i],m_faceOffset[i+1])
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_faceOffset;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the vertex index of each face corner
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_faceVert;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the normal index of each face corner or IndexRef::NOINDEX
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_faceNorm;
   //----------------------------------------------------------------------------------------------------------------------
-  std::vector<Face> m_face;
+  /// @brief the texture cord index of each face corner or IndexRef::NOINDEX
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_faceTex;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the v/n/t triples of each triangle corner (3 per triangle) created by triangulate
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<IndexRef> m_triangles;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the first triangle of each face with an extra entry for the total so the triangles of
+  /// face i are [m_faceTriStart[i],m_faceTriStart[i+1])
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_faceTriStart;
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief Center of the object
   //----------------------------------------------------------------------------------------------------------------------
   Vec3 m_center;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief a vector of indices used to pass the index into the Data arrays to the VBO
+  /// @brief the unique v/n/t triples of the mesh, each one becomes a vertex in the indexed VBO
   //----------------------------------------------------------------------------------------------------------------------
   std::vector<IndexRef> m_indices;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief a vectr of indices without duplicates which are actually passed to the VBO when creating
+  /// @brief an index into m_indices for each triangle corner, this is the index buffer of the indexed VBO
   //----------------------------------------------------------------------------------------------------------------------
   std::vector<GLuint> m_outIndices;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the m_triangles index of each triangle in m_outIndices once optimiseIndices has re-ordered it,
+  /// empty if the triangles are in their original order
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_drawTriangleOrder;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the vertex cache statistics before and after the last optimiseIndices
+  //----------------------------------------------------------------------------------------------------------------------
+  VertexCacheStats m_cacheStatsBefore;
+  VertexCacheStats m_cacheStatsAfter;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief flags to say if createVAO(true) calls optimiseIndices and with overdraw optimisation
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_optimiseIndices;
+  bool m_optimiseOverdraw;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the vertex layout of the VAO
+  //----------------------------------------------------------------------------------------------------------------------
+  VERTEXFORMAT m_vertexFormat;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the index list of each LOD after the full mesh, these index m_indices like m_outIndices
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector< std::vector<GLuint> > m_lodIndices;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the first index and number of indices of each LOD (including the full mesh) in the VAO
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_lodFirst;
+  std::vector<GLuint> m_lodCount;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the LOD settings used by createVAO(true)
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_lodLevels;
+  Real m_lodRatio;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the LOD drawn by draw
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_lod;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the normal generation settings, used by createVAO for meshes without normals and by updateNormals
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_generateNormals;
+  NORMALWEIGHT m_normalWeight;
+  Real m_creaseAngle;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief flag to say if createVAO adds a tangent stream
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_generateTangents;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the tangent and bitangent sign of each VAO vertex made by calcTangents
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<Vec4> m_tangents;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the BVH of the triangles, built on the first query or read from a binary mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  MeshBVH m_bvh;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the unit normal of each face, kept by calcNormals for updateNormals
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<Vec3> m_faceNormals;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the weighted face normal each face corner adds to its vertex normal
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<Vec3> m_cornerNormalWeights;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the face of each face corner
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_cornerFace;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the face corners using each vertex, the corners of vertex i are
+  /// m_vertCorners[m_vertCornerStart[i] .. m_vertCornerStart[i+1]-1]
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<GLuint> m_vertCornerStart;
+  std::vector<GLuint> m_vertCorners;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set by prepareVAO so createVAO can skip the CPU work, and the mode it was prepared for
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_vaoPrepared;
+  bool m_vaoPreparedIndexed;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the transform from quantised to model space positions
+  //----------------------------------------------------------------------------------------------------------------------
+  Mat4 m_dequantise;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the uv scale and offset for quantised uvs
+  //----------------------------------------------------------------------------------------------------------------------
+  Vec4 m_uvTransform;
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief the size of the index array
   //----------------------------------------------------------------------------------------------------------------------
   unsigned int m_indexSize;
@@ -345,12 +910,26 @@ protected :
   /// @brief flag to indicate if a VBO has been created
   //----------------------------------------------------------------------------------------------------------------------
 	bool m_vao;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if the VAO holds the welded m_indices vertices, false for a vertex per m_triangles corner
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_vaoIndexed;
 
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief flag to indicate if the VBO vertex data has been mapped
   //----------------------------------------------------------------------------------------------------------------------
   bool m_vboMapped;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the vertex data mapVAOVerts hands out and a copy of what is in the GL buffer, unMapVAO uploads
+  /// where they differ, both are empty until the first map
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Real> m_vaoMapped;
+  std::vector <Real> m_vaoShadow;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the first vertex and count of each range given to markVAOVertsDirty since the map
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector< std::pair<unsigned int,unsigned int> > m_vaoDirty;
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief flag to indicate if texture assigned
   //----------------------------------------------------------------------------------------------------------------------
   bool m_texture;
@@ -405,16 +984,115 @@ protected :
   /// @param[in] _v the vertex index
   /// @param[in] _n the normal index
   /// @param[in] _t the texture index
+  /// @param[in,out] io_table the hash table used to find existing v/n/t triples in io_indices
   /// @param[in] io_indices the index list stored
   /// @param[in] io_outIndices the re-orderd list
+  /// @returns true if an existing index was re-used
   //----------------------------------------------------------------------------------------------------------------------
   bool addIndex(
                 const unsigned _v,
                 const unsigned _n,
                 const unsigned _t,
+                IndexRefTable &io_table,
                 std::vector<IndexRef>& io_indices,
                 std::vector<GLuint>& io_outIndices
-               );
+               ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief weld m_triangles as weldVertices does but into the lists passed, the mesh must be triangulated
+  /// @param[out] o_indices the unique v/n/t triples
+  /// @param[out] o_outIndices an index into o_indices for each triangle corner
+  //----------------------------------------------------------------------------------------------------------------------
+  void weldTriangles(
+                     std::vector<IndexRef> &o_indices,
+                     std::vector<GLuint> &o_outIndices
+                    ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the work of optimiseIndices on the lists passed rather than the members
+  /// @param[in] _overdraw if true the triangles are also clustered to reduce overdraw
+  /// @param[in,out] io_indices the welded vertices, re-ordered for fetch locality
+  /// @param[in,out] io_outIndices the triangle corners, re-ordered and re-numbered
+  /// @param[out] o_triangleOrder the original index of each triangle in io_outIndices
+  /// @param[in,out] io_lods LOD index lists into io_indices, re-numbered and cache optimised
+  /// @param[out] o_before the cache statistics before
+  /// @param[out] o_after the cache statistics after
+  //----------------------------------------------------------------------------------------------------------------------
+  void optimiseIndexLists(
+                          bool _overdraw,
+                          std::vector<IndexRef> &io_indices,
+                          std::vector<GLuint> &io_outIndices,
+                          std::vector<GLuint> &o_triangleOrder,
+                          std::vector< std::vector<GLuint> > &io_lods,
+                          VertexCacheStats &o_before,
+                          VertexCacheStats &o_after
+                         ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief triangulate the faces from _firstFace to the end of the face list appending the triangles to
+  /// m_triangles, the faces before _firstFace must already be triangulated
+  /// @param[in] _firstFace the first face to triangulate
+  /// @param[in] _numThreads the number of threads to use (0 for all cores)
+  //----------------------------------------------------------------------------------------------------------------------
+  void triangulateRange(
+                        unsigned long int _firstFace,
+                        unsigned int _numThreads
+                       );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief used by progressive loaders, triangulate the faces from _firstFace to the end of the face
+  /// list and upload them as a new buffer (draw range) of the VAO, creating the VAO if needed
+  /// @param[in] _firstFace the first of the newly loaded faces
+  /// @param[in] _numThreads the number of threads to use for the triangulation (0 for all cores)
+  //----------------------------------------------------------------------------------------------------------------------
+  void appendStreamFaces(
+                         unsigned long int _firstFace,
+                         unsigned int _numThreads
+                        );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief triangulate the faces [_begin,_end) into their part of m_triangles, this is the body
+  /// of the parallel loop in triangulate
+  //----------------------------------------------------------------------------------------------------------------------
+  void triangulateFaces(
+                        size_t _begin,
+                        size_t _end
+                       );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief work out the unit normal and the corner weights of some faces, this is the body of the
+  /// parallel face loop in calcNormals / updateNormals
+  /// @param[in] _faces the faces to do or null to do the faces [_begin,_end) directly
+  //----------------------------------------------------------------------------------------------------------------------
+  void calcFaceNormals(
+                       size_t _begin,
+                       size_t _end,
+                       const GLuint *_faces
+                      );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief sum the corner weights around some vertices, this is the body of the parallel vertex loop
+  /// in calcNormals / updateNormals
+  /// @param[in] _verts the vertices to do or null to do the vertices [_begin,_end) directly
+  /// @param[out] o_cornerNormals if not null the normal of each face corner is written here, else the
+  /// normals are written to m_norm through m_faceNorm
+  //----------------------------------------------------------------------------------------------------------------------
+  void calcVertexNormals(
+                         size_t _begin,
+                         size_t _end,
+                         const GLuint *_verts,
+                         std::vector<Vec3> *o_cornerNormals
+                        );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the v/n/t indices for a corner of a face
+  /// @param[in] _face the face index
+  /// @param[in] _corner the corner of the face
+  /// @returns the triple with NOINDEX for any missing normal or tex cord
+  //----------------------------------------------------------------------------------------------------------------------
+  IndexRef faceCorner(
+                      unsigned long int _face,
+                      unsigned int _corner
+                     ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the attribute pointers for the interleaved u,v,nx,ny,nz,x,y,z vertex format
+  /// @param[in] _vao the bound VAO to set the attributes for
+  //----------------------------------------------------------------------------------------------------------------------
+  static void setVertDataAttributes(
+                                    VertexArrayObject *_vao
+                                   );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  flag to indicate if anything loaded for dtor
   //----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,314 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ASYNCLOADER_H__
+#define ASYNCLOADER_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AsyncLoader.h
+/// @brief loads meshes and textures on a pool of worker threads so the render loop doesn't stall
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <deque>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include "Singleton.h"
+#include "Obj.h"
+#include "Texture.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the states an asynchronous asset goes through
+/// ASYNC_PENDING waiting for or running on a worker, ASYNC_LOADED the CPU work is done and it is waiting for
+/// AsyncLoader::processCompleted, ASYNC_READY resident in GL, ASYNC_FAILED the load failed
+//----------------------------------------------------------------------------------------------------------------------
+enum ASYNCSTATE{ASYNC_PENDING,ASYNC_LOADED,ASYNC_READY,ASYNC_FAILED};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class AsyncAsset "include/ngl/AsyncLoader.h"
+/// @brief the base of the handles returned by AsyncLoader, the state is safe to poll from any thread
+//----------------------------------------------------------------------------------------------------------------------
+class AsyncAsset : private boost::noncopyable
+{
+  friend class AsyncLoader;
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _fname the file to load
+  //----------------------------------------------------------------------------------------------------------------------
+  AsyncAsset(
+             const std::string &_fname
+            );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual ~AsyncAsset(){;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the current state
+  //----------------------------------------------------------------------------------------------------------------------
+  ASYNCSTATE getState() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief is the asset resident and ready to use
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isReady() const {return getState() == ASYNC_READY;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief did the load fail
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isFailed() const {return getState() == ASYNC_FAILED;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the name of the file being loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::string &getFileName() const {return m_fname;}
+
+protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the CPU side of the load, called on a worker thread so it must not use GL
+  /// @returns true on success
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual bool loadData()=0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the GL side of the load, called on the render thread by AsyncLoader::processCompleted
+  //----------------------------------------------------------------------------------------------------------------------
+  virtual void createGL()=0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the state
+  //----------------------------------------------------------------------------------------------------------------------
+  void setState(
+                ASYNCSTATE _state
+               );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the file to load
+  //----------------------------------------------------------------------------------------------------------------------
+  std::string m_fname;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the current state, guarded by m_mutex as it is written by the workers
+  //----------------------------------------------------------------------------------------------------------------------
+  ASYNCSTATE m_state;
+  mutable boost::mutex m_mutex;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class AsyncMesh "include/ngl/AsyncLoader.h"
+/// @brief an Obj mesh loaded by AsyncLoader, the parsing, welding and index optimisation happen on a worker
+/// and the VAO is created by AsyncLoader::processCompleted
+//----------------------------------------------------------------------------------------------------------------------
+class AsyncMesh : public AsyncAsset
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _fname the obj file to load
+  /// @param[in] _indexed passed to createVAO
+  /// @param[in] _format passed to createVAO
+  //----------------------------------------------------------------------------------------------------------------------
+  AsyncMesh(
+            const std::string &_fname,
+            bool _indexed,
+            VERTEXFORMAT _format
+           );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the mesh, only use this once isReady is true (or to set options before the load starts)
+  //----------------------------------------------------------------------------------------------------------------------
+  inline Obj &getMesh() {return m_mesh;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief draw the mesh if it is ready, else draw a VAOPrimitives shape in its place
+  /// @param[in] _placeholder the name of the VAOPrimitives shape, empty to draw nothing
+  //----------------------------------------------------------------------------------------------------------------------
+  void draw(
+            const std::string &_placeholder=""
+           ) const;
+
+protected :
+  bool loadData();
+  void createGL();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mesh being loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  Obj m_mesh;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the createVAO options
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_indexed;
+  VERTEXFORMAT m_format;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class AsyncTexture "include/ngl/AsyncLoader.h"
+/// @brief a texture loaded by AsyncLoader, the image is decoded on a worker and the GL texture is created by
+/// AsyncLoader::processCompleted
+//----------------------------------------------------------------------------------------------------------------------
+class AsyncTexture : public AsyncAsset
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  /// @param[in] _fname the image to load
+  //----------------------------------------------------------------------------------------------------------------------
+  AsyncTexture(
+               const std::string &_fname
+              );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the texture id if it is ready
+  /// @param[in] _placeholder the id returned until the texture is ready
+  //----------------------------------------------------------------------------------------------------------------------
+  inline GLuint getTextureID(GLuint _placeholder=0) const {return isReady() ? m_id : _placeholder;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the texture, the image data is valid once isReady is true
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const Texture &getTexture() const {return m_texture;}
+
+protected :
+  bool loadData();
+  void createGL();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the texture being loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  Texture m_texture;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the GL texture id
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint m_id;
+};
+
+typedef boost::shared_ptr<AsyncMesh> AsyncMeshHandle;
+typedef boost::shared_ptr<AsyncTexture> AsyncTextureHandle;
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class AsyncLoader "include/ngl/AsyncLoader.h"
+/// @brief a singleton pool of loader threads. The load calls return a handle straight away and the file is
+/// loaded on a worker, the GL objects are then created when the render thread calls processCompleted,
+/// usually once per frame. For example
+/// @code
+/// ngl::AsyncMeshHandle troll=ngl::AsyncLoader::instance()->loadMesh("models/troll.obj");
+/// // each frame
+/// ngl::AsyncLoader::instance()->processCompleted();
+/// troll->draw("cube");
+/// @endcode
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 12/11/12 created
+//----------------------------------------------------------------------------------------------------------------------
+class AsyncLoader : public Singleton<AsyncLoader>
+{
+  friend class Singleton<AsyncLoader>;
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the number of worker threads, this must be called before the first load
+  /// @param[in] _numThreads the number of workers (0 for one less than the number of cores)
+  //----------------------------------------------------------------------------------------------------------------------
+  void setNumThreads(
+                     unsigned int _numThreads
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue an Obj mesh to load
+  /// @param[in] _fname the file to load
+  /// @param[in] _indexed passed to createVAO
+  /// @param[in] _format passed to createVAO
+  /// @returns the handle to poll and draw
+  //----------------------------------------------------------------------------------------------------------------------
+  AsyncMeshHandle loadMesh(
+                           const std::string &_fname,
+                           bool _indexed=true,
+                           VERTEXFORMAT _format=VERTEX_FLOAT
+                          );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue a texture to load
+  /// @param[in] _fname the file to load
+  /// @returns the handle to poll
+  //----------------------------------------------------------------------------------------------------------------------
+  AsyncTextureHandle loadTexture(
+                                 const std::string &_fname
+                                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create the GL objects for the loads which have finished, this must be called on the render thread
+  /// @param[in] _maxItems the most to process this call (0 for all) to limit the time taken per frame
+  /// @returns the number processed
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int processCompleted(
+                                unsigned int _maxItems=0
+                               );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the number of loads which are not yet resident
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int getNumPending() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief stop the workers once the queued loads are done, this is called by the dtor
+  //----------------------------------------------------------------------------------------------------------------------
+  void shutdown();
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor, the workers are started on the first load
+  //----------------------------------------------------------------------------------------------------------------------
+  AsyncLoader();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor stops the workers
+  //----------------------------------------------------------------------------------------------------------------------
+  ~AsyncLoader();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief add a load to the queue and start the workers if needed
+  //----------------------------------------------------------------------------------------------------------------------
+  void submit(
+              const boost::shared_ptr<AsyncAsset> &_asset
+             );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the loop run by each worker
+  //----------------------------------------------------------------------------------------------------------------------
+  void workerLoop();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the loads waiting for a worker
+  //----------------------------------------------------------------------------------------------------------------------
+  std::deque< boost::shared_ptr<AsyncAsset> > m_jobs;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the loads waiting for processCompleted
+  //----------------------------------------------------------------------------------------------------------------------
+  std::deque< boost::shared_ptr<AsyncAsset> > m_completed;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of loads queued or running
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_pending;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief guards the queues, m_pending and m_quit
+  //----------------------------------------------------------------------------------------------------------------------
+  mutable boost::mutex m_mutex;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wakes the workers when a job is added
+  //----------------------------------------------------------------------------------------------------------------------
+  boost::condition_variable m_wake;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the worker threads
+  //----------------------------------------------------------------------------------------------------------------------
+  boost::thread_group m_workers;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of workers to start
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_numThreads;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief have the workers been started
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_started;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief tells the workers to stop
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_quit;
+};
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
@@ -370,6 +370,16 @@ public :
                                       Vec3 &_p,
                                       float _radius
                                     ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get how big a sphere will be on screen, this is used to pick the LOD of a mesh
+  /// @param[in] _center the center of the sphere in world space
+  /// @param[in] _radius the radius of the sphere
+  /// @returns the projected diameter as a fraction of the viewport height, very large if the eye is inside
+  //----------------------------------------------------------------------------------------------------------------------
+  Real getProjectedSphereSize(
+                              const Vec3 &_center,
+                              Real _radius
+                             ) const;
 
 protected :
 
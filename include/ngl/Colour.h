@@ -211,6 +211,7 @@ public :
   /// @returns m_openGL[0] the first element of the array
   //----------------------------------------------------------------------------------------------------------------------
   inline Real * openGL(){return &m_openGL[0];}
+  inline const Real * openGL() const {return &m_openGL[0];}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief accesor method for the Red colour component
   /// @returns the red colour component
@@ -23,6 +23,7 @@
 #include <bcm_host.h>
 
 #include "EGLConfig.h"
+#include "SharedContextLoader.h"
 namespace ngl
 {
 
@@ -72,6 +73,13 @@ class EGLWindow
 		/// @brief set the flag to upscale the screen dst rectangle.
 		/// by default this is not set
 		inline void setUpscale(bool _f){m_upscale=_f;}
+		/// @brief create a second context sharing objects with this one and bound to a loader
+		/// thread, call this from initializeGL (or later) once the surface exists. The config
+		/// needs EGL_PBUFFER_BIT in its surface type unless EGL_KHR_surfaceless_context is supported
+		/// @returns the loader, owned by the window, or 0 if the context couldn't be made
+		SharedContextLoader *createLoaderContext();
+		/// @brief get the loader made by createLoaderContext (0 if none)
+		inline SharedContextLoader *getLoader()const {return m_loader;}
 
 
 
@@ -104,6 +112,8 @@ class EGLWindow
  		DISPMANX_DISPLAY_HANDLE_T m_dispmanDisplay;
 		/// @brief vc display manager update structure
  		DISPMANX_UPDATE_HANDLE_T m_dispmanUpdate;
+		/// @brief the optional loader thread context
+		SharedContextLoader *m_loader;
 	 private :
 	  /// @brief destroy the surface if it exists
 	 	void destroySurface();
@@ -0,0 +1,303 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GLSTATECACHE_H__
+#define GLSTATECACHE_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GLStateCache.h
+/// @brief shadows the GL state NGL sets so calls which wouldn't change anything are skipped
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include "Singleton.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the kinds of call counted by GLStateCache
+//----------------------------------------------------------------------------------------------------------------------
+enum GLSTATECALL
+{
+  STATE_PROGRAM,
+  STATE_VERTEXARRAY,
+  STATE_BUFFER,
+  STATE_ACTIVETEXTURE,
+  STATE_TEXTURE,
+  STATE_ATTRIBUTE,
+  STATE_CAPABILITY,
+  STATE_BLENDFUNC,
+  STATE_DEPTH,
+  STATE_CULLFACE,
+  STATE_VIEWPORT,
+  STATE_NUMCALLS
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class GLStateCache "include/ngl/GLStateCache.h"
+/// @brief a singleton copy of the program, buffer, texture, vertex attribute, capability, blend, depth, cull and
+/// viewport state of the render context. Each method only makes the GL call if the value differs from the
+/// copy and counts the calls issued and elided. Everything starts unknown so the first call of each kind is
+/// always made, if code outside NGL changes any of this state call invalidate afterwards. Only use this on
+/// the render thread, the SharedContextLoader context has its own state. Element buffer and vertex attribute
+/// enables belong to the bound GL VAO so are forgotten when it changes and always issued while one is bound.
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 19/11/12 created
+//----------------------------------------------------------------------------------------------------------------------
+class GLStateCache : public Singleton<GLStateCache>
+{
+  friend class Singleton<GLStateCache>;
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the value of an object binding that isn't known
+  //----------------------------------------------------------------------------------------------------------------------
+  static const GLuint UNKNOWN=0xffffffff;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of texture units shadowed, binds on higher units are always issued
+  //----------------------------------------------------------------------------------------------------------------------
+  static const unsigned int MAXTEXTUREUNITS=16;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief forget everything, call this after raw GL code has changed any of the state held here
+  //----------------------------------------------------------------------------------------------------------------------
+  void invalidate();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glUseProgram
+  //----------------------------------------------------------------------------------------------------------------------
+  void useProgram(
+                  GLuint _program
+                 );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glDeleteProgram, the name may be reused so it is forgotten if it is current
+  //----------------------------------------------------------------------------------------------------------------------
+  void deleteProgram(
+                     GLuint _program
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glBindVertexArrayOES, this does nothing until VertexArrayObject has found the extension
+  //----------------------------------------------------------------------------------------------------------------------
+  void bindVertexArray(
+                       GLuint _array
+                      );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the glBindVertexArrayOES entry point, VertexArrayObject does this once it has loaded it
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setBindVertexArray(PFNGLBINDVERTEXARRAYOESPROC _bind){m_bindVertexArray=_bind; m_vertexArray= _bind !=0 ? UNKNOWN : 0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glBindBuffer for GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER
+  //----------------------------------------------------------------------------------------------------------------------
+  void bindBuffer(
+                  GLenum _target,
+                  GLuint _buffer
+                 );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glDeleteBuffers, GL binds 0 in place of any of them that were bound
+  //----------------------------------------------------------------------------------------------------------------------
+  void deleteBuffers(
+                     GLsizei _n,
+                     const GLuint *_buffers
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glActiveTexture
+  /// @param _unit the unit as GL_TEXTURE0+n
+  //----------------------------------------------------------------------------------------------------------------------
+  void activeTexture(
+                     GLenum _unit
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glBindTexture on the active unit
+  //----------------------------------------------------------------------------------------------------------------------
+  void bindTexture(
+                   GLenum _target,
+                   GLuint _texture
+                  );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glDeleteTextures, GL binds 0 in place of any of them that were bound
+  //----------------------------------------------------------------------------------------------------------------------
+  void deleteTextures(
+                      GLsizei _n,
+                      const GLuint *_textures
+                     );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glEnableVertexAttribArray / glDisableVertexAttribArray
+  //----------------------------------------------------------------------------------------------------------------------
+  void enableVertexAttribArray(
+                               GLuint _index
+                              );
+  void disableVertexAttribArray(
+                                GLuint _index
+                               );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glEnable / glDisable, capabilities GLES 2 doesn't list are always issued
+  //----------------------------------------------------------------------------------------------------------------------
+  void enable(
+              GLenum _cap
+             );
+  void disable(
+               GLenum _cap
+              );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glBlendFunc
+  //----------------------------------------------------------------------------------------------------------------------
+  void blendFunc(
+                 GLenum _src,
+                 GLenum _dst
+                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glDepthFunc / glDepthMask
+  //----------------------------------------------------------------------------------------------------------------------
+  void depthFunc(
+                 GLenum _func
+                );
+  void depthMask(
+                 GLboolean _flag
+                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glCullFace
+  //----------------------------------------------------------------------------------------------------------------------
+  void cullFace(
+                GLenum _mode
+               );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief glViewport
+  //----------------------------------------------------------------------------------------------------------------------
+  void viewport(
+                GLint _x,
+                GLint _y,
+                GLsizei _width,
+                GLsizei _height
+               );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessors for the shadowed bindings, UNKNOWN if not known
+  //----------------------------------------------------------------------------------------------------------------------
+  inline GLuint getProgram() const {return m_program;}
+  inline GLuint getVertexArray() const {return m_vertexArray;}
+  inline GLuint getBuffer(GLenum _target) const {return _target == GL_ELEMENT_ARRAY_BUFFER ? m_elementBuffer : m_arrayBuffer;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a bit for each vertex attribute array known to be enabled with no GL VAO bound
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getEnabledAttributes() const {return m_attributeKnown & m_attributeEnabled;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of calls made and skipped of one kind since the last resetCounters
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned long getIssued(GLSTATECALL _call) const {return m_issued[_call];}
+  inline unsigned long getElided(GLSTATECALL _call) const {return m_elided[_call];}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the number of calls made and skipped of all kinds since the last resetCounters
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long getTotalIssued() const;
+  unsigned long getTotalElided() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief zero the counters
+  //----------------------------------------------------------------------------------------------------------------------
+  void resetCounters();
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor starts with everything unknown
+  //----------------------------------------------------------------------------------------------------------------------
+  GLStateCache();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief mark everything here as unknown
+  //----------------------------------------------------------------------------------------------------------------------
+  void forget();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief count a call and say if it should be made
+  /// @param _call the kind of call
+  /// @param _changed does the call change the state
+  /// @returns _changed
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool count(GLSTATECALL _call, bool _changed)
+  {
+    if(_changed == true)
+    {
+      ++m_issued[_call];
+    }
+    else
+    {
+      ++m_elided[_call];
+    }
+    return _changed;
+  }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set a capability bit
+  /// @param _cap the capability
+  /// @param _enabled the new state
+  /// @returns true if the GL call is needed
+  //----------------------------------------------------------------------------------------------------------------------
+  bool setCapability(
+                     GLenum _cap,
+                     bool _enabled
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set a vertex attribute enable bit
+  /// @param _index the attribute
+  /// @param _enabled the new state
+  /// @returns true if the GL call is needed
+  //----------------------------------------------------------------------------------------------------------------------
+  bool setAttribute(
+                    GLuint _index,
+                    bool _enabled
+                   );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the current program, VAO and buffers
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint m_program;
+  GLuint m_vertexArray;
+  GLuint m_arrayBuffer;
+  GLuint m_elementBuffer;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the glBindVertexArrayOES entry point or 0 without the extension
+  //----------------------------------------------------------------------------------------------------------------------
+  PFNGLBINDVERTEXARRAYOESPROC m_bindVertexArray;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the active texture unit (GL_TEXTURE0+n or UNKNOWN) and the 2D and cube map texture on each unit
+  //----------------------------------------------------------------------------------------------------------------------
+  GLenum m_activeTexture;
+  GLuint m_texture2D[MAXTEXTUREUNITS];
+  GLuint m_textureCube[MAXTEXTUREUNITS];
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the vertex attribute arrays whose state is known and the enabled ones for VAO 0
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_attributeKnown;
+  unsigned int m_attributeEnabled;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the capabilities whose state is known and the enabled ones
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_capabilityKnown;
+  unsigned int m_capabilityEnabled;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the blend, depth and cull state, UNKNOWN if not known
+  //----------------------------------------------------------------------------------------------------------------------
+  GLenum m_blendSrc;
+  GLenum m_blendDst;
+  GLenum m_depthFunc;
+  GLuint m_depthMask;
+  GLenum m_cullFace;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the viewport, a width of -1 if not known
+  //----------------------------------------------------------------------------------------------------------------------
+  GLint m_viewport[4];
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the counters
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned long m_issued[STATE_NUMCALLS];
+  unsigned long m_elided[STATE_NUMCALLS];
+};
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
@@ -194,7 +194,7 @@ public:
   /// @param[in] _uniformName name of the uniform to set
   //----------------------------------------------------------------------------------------------------------------------
   void loadToShader(
-                    std::string _uniformName
+                    const std::string &_uniformName
                    )const;
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief set a transform so that the light position is multiplied by this value (default is identity matrix)
@@ -239,6 +239,7 @@ public:
   /// @returns a pointer to m_openGL[0]
   //----------------------------------------------------------------------------------------------------------------------
   inline Real * openGL(){return &m_openGL[0];}
+  inline const Real * openGL() const {return &m_openGL[0];}
 
 public :
  //----------------------------------------------------------------------------------------------------------------------
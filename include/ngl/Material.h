@@ -192,7 +192,7 @@ public :
   /// @param[in] _uniformName
   //----------------------------------------------------------------------------------------------------------------------
   void loadToShader(
-                    std::string _uniformName
+                    const std::string &_uniformName
                    )const;
   //----------------------------------------------------------------------------------------------------------------------
 
@@ -0,0 +1,121 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MEMORYMAPPEDFILE_H__
+#define MEMORYMAPPEDFILE_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MemoryMappedFile.h
+/// @brief a read only memory mapped file used by the mesh and point bake loaders
+//----------------------------------------------------------------------------------------------------------------------
+#include <string>
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MemoryMappedFile "include/ngl/MemoryMappedFile.h"
+/// @brief wraps the posix mmap calls so a whole file can be accessed as a contiguous block of
+/// read only memory, the pages are loaded on demand by the OS so large files cost nothing until
+/// they are touched.
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 12/11/12 Initial version
+//----------------------------------------------------------------------------------------------------------------------
+class MemoryMappedFile : private boost::noncopyable
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief hint passed to the OS about how the pages will be accessed
+  //----------------------------------------------------------------------------------------------------------------------
+  enum ACCESSHINT{NORMAL,SEQUENTIAL,RANDOM};
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief default ctor, nothing is mapped until open is called
+  //----------------------------------------------------------------------------------------------------------------------
+  MemoryMappedFile();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor which opens the file
+  /// @param[in] _fname the name of the file to map
+  /// @param[in] _hint how we expect to access the data
+  //----------------------------------------------------------------------------------------------------------------------
+  MemoryMappedFile(
+                   const std::string &_fname,
+                   ACCESSHINT _hint=NORMAL
+                  );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor will unmap the file if open
+  //----------------------------------------------------------------------------------------------------------------------
+  ~MemoryMappedFile();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map the file into memory, any previous mapping is released first
+  /// @param[in] _fname the name of the file to map
+  /// @param[in] _hint how we expect to access the data
+  /// @returns true if the file was mapped
+  //----------------------------------------------------------------------------------------------------------------------
+  bool open(
+            const std::string &_fname,
+            ACCESSHINT _hint=NORMAL
+           );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief release the mapping
+  //----------------------------------------------------------------------------------------------------------------------
+  void close();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the mapped data
+  /// @returns a pointer to the first byte of the file or 0 if not mapped
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const char *data() const {return m_data;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for one past the last byte of the file
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const char *end() const {return m_data+m_size;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the size of the file in bytes
+  //----------------------------------------------------------------------------------------------------------------------
+  inline size_t size() const {return m_size;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief check to see if we have a file mapped
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isOpen() const {return m_open;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ask the OS to start reading part of the file in, so the pages are loaded before they are touched
+  /// @param[in] _offset the first byte to load
+  /// @param[in] _size the number of bytes to load
+  //----------------------------------------------------------------------------------------------------------------------
+  void willNeed(
+                size_t _offset,
+                size_t _size
+               ) const;
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the start of the mapped memory
+  //----------------------------------------------------------------------------------------------------------------------
+  const char *m_data;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the size of the mapping
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t m_size;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief flag to indicate we have an open file, an empty file is open but has no mapping
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_open;
+};
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,225 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MESHBVH_H__
+#define MESHBVH_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshBVH.h
+/// @brief a bounding volume hierarchy over the triangles of a mesh for picking and proximity queries
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <stdint.h>
+#include <ostream>
+#include <vector>
+#include "Vec3.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the result of a MeshBVH query
+//----------------------------------------------------------------------------------------------------------------------
+struct BVHHit
+{
+  /// @brief the distance along the ray (intersectRay) or from the query point (closestPoint)
+  Real m_t;
+  /// @brief the point hit on the mesh
+  Vec3 m_point;
+  /// @brief the barycentric cords of m_point in the triangle, m_point=(1-u-v)*v0+u*v1+v*v2
+  Real m_u;
+  Real m_v;
+  /// @brief the id given to the triangle when the BVH was built (the source face for a mesh)
+  GLuint m_id;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a node of the flattened tree, 32 bytes so two fit in a cache line. The children of a node are
+/// always next to each other in the node array so only the first is stored
+//----------------------------------------------------------------------------------------------------------------------
+struct BVHNode
+{
+  /// @brief the bounds of the node
+  float m_min[3];
+  /// @brief the first child for an inner node, the first packet for a leaf
+  uint32_t m_first;
+  float m_max[3];
+  /// @brief 0 for an inner node else the number of packets in the leaf
+  uint32_t m_count;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief 4 triangles stored as structure of arrays so the ray test can do all 4 at once. Each triangle
+/// is a corner and two edges, unused lanes have zero edges and an id of MeshBVH::NOID so never hit
+//----------------------------------------------------------------------------------------------------------------------
+struct BVHPacket
+{
+  /// @brief the x,y,z of the first corner of each triangle
+  float m_v0[3][4];
+  /// @brief the edges v1-v0 and v2-v0
+  float m_e1[3][4];
+  float m_e2[3][4];
+  /// @brief the id of each triangle
+  uint32_t m_id[4];
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class MeshBVH "include/ngl/MeshBVH.h"
+/// @brief a bounding volume hierarchy over a triangle soup, built top down with the binned surface area
+/// heuristic (Wald "On fast Construction of SAH-based Bounding Volume Hierarchies") and flattened into
+/// a node array with the triangles of each leaf packed 4 to a BVHPacket. Rays are tested against the 4
+/// triangles of a packet at once with the Moller Trumbore test written with 4 wide vector types, which the
+/// compiler turns into NEON / SSE where the target has them. The node and packet arrays are plain data so
+/// they can be written to and read back from a file with no rebuild.
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 16/11/12 created
+//----------------------------------------------------------------------------------------------------------------------
+class MeshBVH
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the id of an unused packet lane
+  //----------------------------------------------------------------------------------------------------------------------
+  static const uint32_t NOID=0xffffffff;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor makes an empty tree
+  //----------------------------------------------------------------------------------------------------------------------
+  MeshBVH();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief build the tree, any existing tree is replaced
+  /// @param[in] _corners the 3 corners of each triangle
+  /// @param[in] _ids the id returned in BVHHit for each triangle
+  //----------------------------------------------------------------------------------------------------------------------
+  void build(
+             const std::vector<Vec3> &_corners,
+             const std::vector<GLuint> &_ids
+            );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief remove the tree
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief has the tree been built or read
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isBuilt() const {return m_nodes.empty() == false;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the nearest triangle hit by a ray, both sides of a triangle are hit
+  /// @param[in] _origin the start of the ray
+  /// @param[in] _dir the direction of the ray, this doesn't need to be normalized and m_t is in its units
+  /// @param[out] o_hit the nearest hit
+  /// @param[in] _maxT only hits closer than this are found
+  /// @returns true if anything was hit
+  //----------------------------------------------------------------------------------------------------------------------
+  bool intersectRay(
+                    const Vec3 &_origin,
+                    const Vec3 &_dir,
+                    BVHHit &o_hit,
+                    Real _maxT=1e30f
+                   ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the closest point on the mesh to a point
+  /// @param[in] _point the query point
+  /// @param[out] o_hit the closest point, m_t is the distance to it
+  /// @param[in] _maxDistance only points closer than this are found
+  /// @returns true if a point was found
+  //----------------------------------------------------------------------------------------------------------------------
+  bool closestPoint(
+                    const Vec3 &_point,
+                    BVHHit &o_hit,
+                    Real _maxDistance=1e30f
+                   ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief find the triangles touching a sphere
+  /// @param[in] _center the center of the sphere
+  /// @param[in] _radius the radius of the sphere
+  /// @param[out] o_ids the sorted unique ids of the triangles found, this is cleared first
+  //----------------------------------------------------------------------------------------------------------------------
+  void sphereOverlap(
+                     const Vec3 &_center,
+                     Real _radius,
+                     std::vector<GLuint> &o_ids
+                    ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the size of the data written by write
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t getDataSize() const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief write the tree as a node count, a packet count, 8 bytes of padding, the nodes and the packets
+  /// @param[in] io_stream the stream to write to
+  //----------------------------------------------------------------------------------------------------------------------
+  void write(
+             std::ostream &io_stream
+            ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief read a tree saved with write
+  /// @param[in] _data the start of the data
+  /// @param[in] _size the number of bytes available
+  /// @returns false if the data is truncated or corrupt, the tree is then empty
+  //----------------------------------------------------------------------------------------------------------------------
+  bool read(
+            const unsigned char *_data,
+            size_t _size
+           );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessors for the flattened tree
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::vector<BVHNode> &getNodes() const {return m_nodes;}
+  inline const std::vector<BVHPacket> &getPackets() const {return m_packets;}
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a triangle while building
+  //----------------------------------------------------------------------------------------------------------------------
+  struct BuildTriangle
+  {
+    Vec3 m_min;
+    Vec3 m_max;
+    Vec3 m_centroid;
+    GLuint m_index;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief split a node and recurse or make it a leaf
+  /// @param[in] _node the index of the node to fill in
+  /// @param[in] io_tris the triangles being built
+  /// @param[in] _begin the first triangle of the node
+  /// @param[in] _end one past the last triangle of the node
+  /// @param[in] _depth the depth of the node in the tree
+  /// @param[in] _corners the corners passed to build
+  /// @param[in] _ids the ids passed to build
+  //----------------------------------------------------------------------------------------------------------------------
+  void buildNode(
+                 size_t _node,
+                 std::vector<BuildTriangle> &io_tris,
+                 size_t _begin,
+                 size_t _end,
+                 unsigned int _depth,
+                 const std::vector<Vec3> &_corners,
+                 const std::vector<GLuint> &_ids
+                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the nodes, the root is node 0
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<BVHNode> m_nodes;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the triangles in leaf order
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector<BVHPacket> m_packets;
+};
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,101 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MESHOPTIMISER_H__
+#define MESHOPTIMISER_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshOptimiser.h
+/// @brief functions to re-order indexed triangle lists for the post transform vertex cache, overdraw
+/// and vertex fetch. They all work on a GL_TRIANGLES index list (3 per triangle) into _numVerts vertices.
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <vector>
+#include "Vec3.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the results of simulating a FIFO post transform vertex cache
+//----------------------------------------------------------------------------------------------------------------------
+struct VertexCacheStats
+{
+  /// @brief the number of vertices transformed (cache misses)
+  unsigned int m_misses;
+  /// @brief average cache miss ratio, transformed verts per triangle (0.5 is the best for a closed mesh, 3 the worst)
+  float m_acmr;
+  /// @brief average transform to vertex ratio, transformed verts per vertex (1 is the best)
+  float m_atvr;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief simulate a FIFO vertex cache for the index list
+/// @param[in] _indices the triangle list indices
+/// @param[in] _numVerts the number of vertices the indices point to
+/// @param[in] _cacheSize the number of entries in the cache
+/// @returns the cache statistics
+//----------------------------------------------------------------------------------------------------------------------
+extern VertexCacheStats analyseVertexCache(
+                                           const std::vector<GLuint> &_indices,
+                                           size_t _numVerts,
+                                           unsigned int _cacheSize=16
+                                          );
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief re-order the triangles so vertices are re-used while still in the cache, this is Tom Forsyth's
+/// "Linear-Speed Vertex Cache Optimisation" which doesn't depend on the exact size of the hardware cache
+/// @param[in,out] io_indices the triangle list indices
+/// @param[in] _numVerts the number of vertices the indices point to
+/// @param[out] o_triangleOrder if not null this is set to the old index of each new triangle
+//----------------------------------------------------------------------------------------------------------------------
+extern void optimiseVertexCache(
+                                std::vector<GLuint> &io_indices,
+                                size_t _numVerts,
+                                std::vector<GLuint> *o_triangleOrder=0
+                               );
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief re-order a vertex cache optimised triangle list to reduce overdraw. The list is split into clusters
+/// where the cache starts again and the clusters which face out from the center of the mesh are drawn
+/// first, so they tend to hide the rest, this is the approach from Sander et al "Fast Triangle Reordering
+/// for Vertex Locality and Reduced Overdraw". If the new order makes the ACMR worse than _threshold times
+/// the original the list is left alone
+/// @param[in,out] io_indices the triangle list indices
+/// @param[in] _positions the position of each vertex
+/// @param[in] _threshold how much worse the ACMR may get
+/// @param[out] o_triangleOrder if not null this is set to the old index of each new triangle
+//----------------------------------------------------------------------------------------------------------------------
+extern void optimiseOverdraw(
+                             std::vector<GLuint> &io_indices,
+                             const std::vector<Vec3> &_positions,
+                             float _threshold=1.05f,
+                             std::vector<GLuint> *o_triangleOrder=0
+                            );
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief re-number the vertices in the order they are first used so the vertex fetch reads the
+/// vertex buffer in order, this should be done last
+/// @param[in,out] io_indices the triangle list indices
+/// @param[in] _numVerts the number of vertices the indices point to
+/// @param[out] o_vertexOrder the old index of each new vertex, use this to re-order the vertex data
+//----------------------------------------------------------------------------------------------------------------------
+extern void optimiseVertexFetch(
+                                std::vector<GLuint> &io_indices,
+                                size_t _numVerts,
+                                std::vector<GLuint> &o_vertexOrder
+                               );
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
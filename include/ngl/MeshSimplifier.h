@@ -0,0 +1,55 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MESHSIMPLIFIER_H__
+#define MESHSIMPLIFIER_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshSimplifier.h
+/// @brief quadric error mesh simplification used to build the LOD chain of a mesh
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <vector>
+#include "Vec3.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief simplify an indexed triangle list with the quadric error metric of Garland and Heckbert "Surface
+/// Simplification Using Quadric Error Metrics". Each step collapses a vertex onto one of its neighbours so
+/// no new vertices are made and every level is just a new index list into the same vertex buffer.
+/// Vertices on a uv / normal seam (a position shared by more than one vertex) or on the boundary of the
+/// mesh are never moved so the seams and outline are kept.
+/// @param[in] _indices the triangle list indices
+/// @param[in] _positions the position of each vertex
+/// @param[in] _positionIds an id for each vertex, vertices with the same id are at the same point
+/// (for a welded mesh this is the source vertex index)
+/// @param[in] _targetTriangles the triangle count wanted for each level, largest first
+/// @param[out] o_levels the index list for each level, this may have fewer levels than asked for if
+/// the mesh can't be simplified any more
+//----------------------------------------------------------------------------------------------------------------------
+extern void simplifyMesh(
+                         const std::vector<GLuint> &_indices,
+                         const std::vector<Vec3> &_positions,
+                         const std::vector<GLuint> &_positionIds,
+                         const std::vector<size_t> &_targetTriangles,
+                         std::vector< std::vector<GLuint> > &o_levels
+                        );
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,193 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NCCABINARYMESH_H__
+#define NCCABINARYMESH_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file NCCABinaryMesh.h
+/// @brief loader for the NCCA binary mesh format written by AbstractMesh::saveNCCABinaryMesh
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <stdint.h>
+#include <string>
+#include "AbstractMesh.h"
+#include "MemoryMappedFile.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the current version of the binary mesh format
+//----------------------------------------------------------------------------------------------------------------------
+const uint32_t NCCABINARY_VERSION=2;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief written in the byte order of the machine saving the file so the loader can detect a mismatch
+//----------------------------------------------------------------------------------------------------------------------
+const uint32_t NCCABINARY_ENDIAN=0x01020304;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the vertex data and index data blocks start on multiples of this many bytes
+//----------------------------------------------------------------------------------------------------------------------
+const uint32_t NCCABINARY_ALIGN=16;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the vertex layouts which may be stored in the file
+/// VERTDATA is the interleaved u,v,nx,ny,nz,x,y,z float format used by createVAO
+//----------------------------------------------------------------------------------------------------------------------
+enum NCCABINARYFORMAT{VERTDATA=0};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the header at the start of an NCCA binary mesh file, every field is 4 bytes so the
+/// layout is the same for every compiler. The vertex and index blocks follow at the given offsets
+/// and can be passed straight to glBufferData from a mapped file.
+//----------------------------------------------------------------------------------------------------------------------
+struct NCCABinaryMeshHeader
+{
+  /// @brief the magic number "ngl::bin" (not null terminated)
+  char m_magic[8];
+  /// @brief NCCABINARY_ENDIAN in the byte order of the writer
+  uint32_t m_endian;
+  /// @brief the file version, the original unversioned format is 1
+  uint32_t m_version;
+  /// @brief the size of this header in bytes
+  uint32_t m_headerSize;
+  /// @brief the GL draw mode (usually GL_TRIANGLES)
+  uint32_t m_drawMode;
+  /// @brief the vertex layout one of NCCABINARYFORMAT
+  uint32_t m_vertexFormat;
+  /// @brief the size of one vertex in bytes
+  uint32_t m_vertexStride;
+  /// @brief the number of vertices in the vertex block
+  uint32_t m_numVertices;
+  /// @brief offset of the vertex block from the start of the file
+  uint32_t m_vertexOffset;
+  /// @brief GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  uint32_t m_indexType;
+  /// @brief the number of indices in the index block
+  uint32_t m_numIndices;
+  /// @brief offset of the index block from the start of the file
+  uint32_t m_indexOffset;
+  /// @brief the number of vertices in the source mesh
+  uint32_t m_numSourceVerts;
+  /// @brief the number of normals in the source mesh
+  uint32_t m_numSourceNormals;
+  /// @brief the number of texture cords in the source mesh
+  uint32_t m_numSourceTexCords;
+  /// @brief the number of faces in the source mesh
+  uint32_t m_numSourceFaces;
+  /// @brief the minimum extents of the mesh
+  float m_min[3];
+  /// @brief the maximum extents of the mesh
+  float m_max[3];
+  /// @brief the center (average vertex) of the mesh
+  float m_center[3];
+  /// @brief the bounding sphere center
+  float m_sphereCenter[3];
+  /// @brief the bounding sphere radius
+  float m_sphereRadius;
+  /// @brief offset of the BVH block (see MeshBVH::write) from the start of the file, 0 if there isn't one.
+  /// Files saved before the BVH was added have 0 here so no version change was needed
+  uint32_t m_bvhOffset;
+  /// @brief the size of the BVH block in bytes
+  uint32_t m_bvhSize;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class NCCABinaryMesh "include/ngl/NCCABinaryMesh.h"
+/// @brief loads a mesh saved with AbstractMesh::saveNCCABinaryMesh. The file is memory mapped and the
+/// vertex and index blocks are handed directly to GL when the VAO is created, so loading is just a page in
+/// of the file. Our content pipeline converts the Obj once and the runtime only ever loads the binary.
+/// Only the packed GPU data is stored so the vert / normal / face lists of the mesh are empty, the BVH is
+/// read from the file so intersectRay, closestPoint and sphereOverlap still work.
+/// @author Jonathan Macey
+/// @version 2.0
+/// @date 12/11/12 re-written as a versioned mmap format with a loader
+//----------------------------------------------------------------------------------------------------------------------
+class NCCABinaryMesh : public AbstractMesh
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief default ctor
+  //----------------------------------------------------------------------------------------------------------------------
+  NCCABinaryMesh();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor to load a file
+  /// @param[in] _fname the name of the file to load
+  //----------------------------------------------------------------------------------------------------------------------
+  NCCABinaryMesh(
+                 const std::string &_fname
+                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor to load a file and texture
+  /// @param[in] _fname the name of the file to load
+  /// @param[in] _texName the name of the texture file
+  //----------------------------------------------------------------------------------------------------------------------
+  NCCABinaryMesh(
+                 const std::string &_fname,
+                 const std::string &_texName
+                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief map the file and check the header, the data is not touched until createVAO
+  /// @param[in] _fname the name of the file to load
+  /// @param[in] _calcBB if true the BBox is created from the stored extents
+  /// @param[in] _numThreads not used as there is no parsing to do
+  /// @returns true if the file is a valid binary mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  bool load(
+            const std::string &_fname,
+            bool _calcBB=true,
+            unsigned int _numThreads=1
+           );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief upload the mapped data to a VAO then release the mapping
+  /// @param[in] _indexed ignored, the file decides if the data is indexed
+  /// @param[in] _format ignored, the file decides the vertex layout
+  //----------------------------------------------------------------------------------------------------------------------
+  void createVAO(
+                 bool _indexed=false,
+                 VERTEXFORMAT _format=VERTEX_FLOAT
+                );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief create a new VAO directly from the mapped file data, this is used by createVAO and
+  /// VAOPrimitives::loadBinary
+  /// @param[in] _drawMode the mode used to draw the VAO
+  /// @returns the new VAO or 0 if no file is mapped
+  //----------------------------------------------------------------------------------------------------------------------
+  VertexArrayObject *createVAOFromFile(
+                                       GLenum _drawMode
+                                      ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief accessor for the header of the loaded file
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const NCCABinaryMeshHeader &getHeader() const {return m_header;}
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the default values
+  //----------------------------------------------------------------------------------------------------------------------
+  void init();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the mapped file, closed once the data is on the GPU
+  //----------------------------------------------------------------------------------------------------------------------
+  MemoryMappedFile m_file;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a copy of the file header
+  //----------------------------------------------------------------------------------------------------------------------
+  NCCABinaryMeshHeader m_header;
+};
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
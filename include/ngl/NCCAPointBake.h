@@ -23,16 +23,93 @@
 // must include types.h first for ngl::Real and GLEW if required
 #include "Types.h"
 
-#include <iostream>
+#include <stdint.h>
 #include <vector>
 #include <string>
 
-#include "Vector.h"
-#include "Obj.h"
+#include "MemoryMappedFile.h"
 
-#include <QtXml/QtXml>
 namespace ngl
 {
+class AbstractMesh;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the current version of the binary point bake format
+//----------------------------------------------------------------------------------------------------------------------
+const uint32_t NCCAPOINTBAKE_VERSION=1;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief written in the byte order of the machine saving the file so the loader can detect a mismatch
+//----------------------------------------------------------------------------------------------------------------------
+const uint32_t NCCAPOINTBAKE_ENDIAN=0x01020304;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the frame data starts on a multiple of this many bytes
+//----------------------------------------------------------------------------------------------------------------------
+const uint32_t NCCAPOINTBAKE_ALIGN=16;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the ways the frames may be stored, POINTBAKE_FLOAT is the raw x,y,z floats and POINTBAKE_QUANTISED
+/// keyframes and deltas of 16 bit positions relative to the bounds of the whole bake
+//----------------------------------------------------------------------------------------------------------------------
+enum POINTBAKEFORMAT{POINTBAKE_FLOAT=0,POINTBAKE_QUANTISED=1};
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the encoding of one frame of a POINTBAKE_QUANTISED bake, a key holds the unsigned short positions
+/// and a delta the signed difference from a prediction. The frame after a key is predicted to be the key, later
+/// frames to carry on moving as they did over the two frames before (2*q1-q0), so smooth motion gives deltas
+/// small enough for bytes. The sums wrap as unsigned shorts so 16 bit deltas are always exact
+//----------------------------------------------------------------------------------------------------------------------
+enum POINTBAKEFRAME{POINTBAKE_KEY=0,POINTBAKE_DELTA8=1,POINTBAKE_DELTA16=2};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the header at the start of a binary point bake file, every field is 4 bytes so the layout is the
+/// same for every compiler. The mesh name follows the header and the frames are one block of
+/// m_numFrames*m_numVerts x,y,z floats at m_dataOffset, frame 0 first, so a frame is a contiguous run of
+/// m_numVerts*3 floats which can be read straight from a mapped file.
+//----------------------------------------------------------------------------------------------------------------------
+struct NCCAPointBakeHeader
+{
+  /// @brief the magic number "ngl::pbk" (not null terminated)
+  char m_magic[8];
+  /// @brief NCCAPOINTBAKE_ENDIAN in the byte order of the writer
+  uint32_t m_endian;
+  /// @brief the file version
+  uint32_t m_version;
+  /// @brief the size of this header in bytes
+  uint32_t m_headerSize;
+  /// @brief the number of verts in each frame
+  uint32_t m_numVerts;
+  /// @brief the number of frames stored
+  uint32_t m_numFrames;
+  /// @brief the start and end frames of the export
+  uint32_t m_startFrame;
+  uint32_t m_endFrame;
+  /// @brief the length of the mesh name which follows the header
+  uint32_t m_nameSize;
+  /// @brief offset of the frame data from the start of the file, for a quantised bake this is the frame table
+  uint32_t m_dataOffset;
+  /// @brief one of POINTBAKEFORMAT, files saved before compression was added stop here so are read
+  /// with these fields as 0 which is POINTBAKE_FLOAT, no version change was needed
+  uint32_t m_format;
+  /// @brief the number of frames from one key to the next
+  uint32_t m_keyInterval;
+  /// @brief a quantised position q is min+q*scale
+  float m_min[3];
+  float m_scale[3];
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief an entry in the frame table of a quantised bake, the frame is m_size bytes at m_offset from the start
+/// of the file stored as all the x values then all the y then all the z (planar so decoding is a straight
+/// run over each plane the compiler can vectorise)
+//----------------------------------------------------------------------------------------------------------------------
+struct NCCAPointBakeFrame
+{
+  /// @brief the offset of the frame split in two so every field is 4 bytes
+  uint32_t m_offsetLow;
+  uint32_t m_offsetHigh;
+  /// @brief one of POINTBAKEFRAME
+  uint32_t m_type;
+  /// @brief the size of the frame in bytes
+  uint32_t m_size;
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 /// @class NCCAPointBake  "include/NCCAPointBake.h"
 /// @brief Class to load and manipulate NCCAPointBake data, this will replace the Houdini Clip
@@ -54,12 +131,18 @@ namespace ngl
 </NCCAPointBake>
 @endverbatim
  **/
+/// The frames are held as one contiguous block of x,y,z floats (frame 0 verts 0-n then frame 1 etc). A binary
+/// bake is memory mapped rather than read so only the frames played are paged in, and a long cache costs no
+/// more memory than the frames around the one being shown. Once a mesh is attached its positions are read
+/// from an extra VAO stream which setMeshToFrame fills with a single glBufferSubData per frame.
+/// saveCompressedPointBake writes a quantised bake, about a quarter of the size, which is decoded a frame at a
+/// time as it plays. setMeshToTime blends between frames so a bake can be exported at a lower frame rate.
 /// @author Jonathan Macey
-/// @version 1.0
-/// @date Last Revision 2/09/10
+/// @version 2.0
+/// @date Last Revision 17/11/12 contiguous frame data, memory mapped binary format and VBO playback
 //----------------------------------------------------------------------------------------------------------------------
 
-class NGL_DLLEXPORT NCCAPointBake
+class NCCAPointBake
 {
 friend class AbstractMesh;
 public :
@@ -68,33 +151,37 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   NCCAPointBake();
   //----------------------------------------------------------------------------------------------------------------------
-  ///  @brief the dtor erases all clip data allocated and also destroys the Obj reference held in the clip
+  ///  @brief the dtor erases all clip data allocated and releases any mapped file
   //----------------------------------------------------------------------------------------------------------------------
   ~NCCAPointBake();
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief   ctor using a clip and an obj
-  /// @param[in] _fileName the name of the bake file to load
+  /// @param[in] _fileName the name of the bake file to load, this can be xml or binary
   //----------------------------------------------------------------------------------------------------------------------
   NCCAPointBake(
                  const std::string &_fileName
                 );
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief  Set the current Frame and map the clip for that frame to the obj
+  /// @brief  Set the current Frame and map the clip for that frame to the attached mesh
   /// @param[in] frame the frame to set
   //----------------------------------------------------------------------------------------------------------------------
   void setFrame(
                 const unsigned int frame
                );
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief  method to load a point baked file
+  /// @brief  method to load a point baked file, the file is mapped and read in one pass with each vertex parsed
+  /// straight into the frame data
   /// @param[in] _fileName the file to load
+  /// @param[in] _binaryName if given the frames are written to this binary file as they are parsed and it is
+  /// then loaded with loadBinaryPointBake, so only one frame is ever held in memory
   //----------------------------------------------------------------------------------------------------------------------
   bool loadPointBake(
-                      const std::string &_fileName
+                      const std::string &_fileName,
+                      const std::string &_binaryName=std::string()
                      );
 
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief  method to load a binary point baked file
+  /// @brief  method to load a binary point baked file, the file is mapped and frames are paged in as they are used
   /// @param[in] _fileName the file to load
   //----------------------------------------------------------------------------------------------------------------------
   bool loadBinaryPointBake(
@@ -111,10 +198,37 @@ public :
                            );
 
 
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  method to save a quantised binary point baked file. Every position is stored as 3 unsigned shorts
+  /// relative to the bounds of all the frames, the error is at most half of 1/65535 of the size of the bounds.
+  /// Every _keyInterval frames is a key with the full positions, the frames between store the change from the
+  /// frame before as bytes (or shorts if any vert moves too far)
+  /// @param[in] _fileName the file to save
+  /// @param[in] _keyInterval the number of frames from one key to the next, a bigger interval is smaller
+  /// but seeking to a frame may decode more deltas
+  //----------------------------------------------------------------------------------------------------------------------
+  bool saveCompressedPointBake(
+                               const std::string &_fileName,
+                               unsigned int _keyInterval=8
+                              );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  get the positions of a frame, a quantised bake is decoded and a fractional frame is blended
+  /// between the frames either side of it
+  /// @param[in] _frame the frame to get, clamped to the frames loaded
+  /// @param[out] o_data m_nVerts x,y,z values
+  /// @returns false if nothing is loaded
+  //----------------------------------------------------------------------------------------------------------------------
+  bool getFrame(
+                Real _frame,
+                Real *o_data
+               );
+
+
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  method to attach a mesh to the data
-  /// this method will check for basic vetex compatibility and then re-order the data
-  /// to match the VBO structure of the mesh
+  /// this method will check for basic vetex compatibility and then build the table mapping the
+  /// VBO vertices of the mesh to the baked verts. The VAO must have been created with VERTEX_FLOAT
+  /// positions, the normals are left as they were in the VAO
   /// @param[in] _mesh the mesh to attach
   /// @returns true is mesh can be attached else false
   //----------------------------------------------------------------------------------------------------------------------
@@ -123,11 +237,19 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  set the attached mesh to the current frame
   /// @param[in] _frame the frame to set the mesh to
-
+  //----------------------------------------------------------------------------------------------------------------------
   void setMeshToFrame(
                        const unsigned int _frame
                       );
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  set the attached mesh to a position between two frames, for playing a bake made at a lower
+  /// frame rate (for example frame*0.5 for a bake exported every other frame)
+  /// @param[in] _frame the frame to set the mesh to, the fraction blends with the next frame
+  //----------------------------------------------------------------------------------------------------------------------
+  void setMeshToTime(
+                     Real _frame
+                    );
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief  return the number of Frames loaded from the PointBake file
   /// @returns the number of frames
   //----------------------------------------------------------------------------------------------------------------------
@@ -137,26 +259,64 @@ public :
   /// @returns the number of verts
   //----------------------------------------------------------------------------------------------------------------------
   inline unsigned int getNumVerts() const {return m_nVerts;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  return how the loaded frames are stored
+  //----------------------------------------------------------------------------------------------------------------------
+  inline POINTBAKEFORMAT getFormat() const {return m_format;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  return the name of the mesh the data was exported from
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const std::string &getMeshName() const {return m_meshName;}
 
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  get a Raw data pointer to the un-sorted PointBake data
-  /// @returns a pointer to the data
+  /// @returns a pointer to the x,y,z of every vert for every frame or 0 if nothing is loaded or the bake is
+  /// quantised (use getFrame)
   //----------------------------------------------------------------------------------------------------------------------
-  inline  std::vector < std::vector<ngl::Vec3> > & getRawDataPointer()  {return m_data;}
+  inline const Real *getRawDataPointer() const {return m_data;}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  get a Raw data pointer to the un-sorted PointBake for a particular frame
 	/// @param[in] _f the frame to access
-  /// @returns a pointer to the data at frame _f
+  /// @returns a pointer to the x,y,z of each vert at frame _f
   //----------------------------------------------------------------------------------------------------------------------
-  std::vector<ngl::Vec3> & getRawDataPointerAtFrame(unsigned int _f);
+  const Real *getRawDataPointerAtFrame(unsigned int _f) const;
 
 
 protected :
+  //----------------------------------------------------------------------------------------------------------------------
+  ///  @brief release the loaded data
+  //----------------------------------------------------------------------------------------------------------------------
+  void clear();
   //----------------------------------------------------------------------------------------------------------------------
   ///  @brief method to create the vertorder container with the correct vertex order in place to match
-  /// that of the obj file
+  /// that of the VBO of the attached mesh
+  /// @returns false if the mesh uses a vert not in the bake
+  //----------------------------------------------------------------------------------------------------------------------
+  bool reorderVerts();
   //----------------------------------------------------------------------------------------------------------------------
-    void reorderVerts();
+  ///  @brief set up a binary file header for the loaded bake
+  /// @param[out] o_header the header
+  /// @param[in] _format the format the frames will be written in
+  //----------------------------------------------------------------------------------------------------------------------
+  void fillHeader(
+                  NCCAPointBakeHeader &o_header,
+                  POINTBAKEFORMAT _format
+                 ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  ///  @brief move m_state on to a frame of a quantised bake, from the nearest key before it unless m_state
+  /// is already at an earlier frame after that key
+  /// @param[in] _frame the frame to decode
+  //----------------------------------------------------------------------------------------------------------------------
+  void decodeFrame(
+                   unsigned int _frame
+                  );
+  //----------------------------------------------------------------------------------------------------------------------
+  ///  @brief upload frame data in baked order to the position stream of the attached mesh
+  /// @param[in] _data the x,y,z of each baked vert
+  //----------------------------------------------------------------------------------------------------------------------
+  void uploadFrame(
+                   const Real *_data
+                  );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief the number of frames in the clip file
   //----------------------------------------------------------------------------------------------------------------------
@@ -167,18 +327,55 @@ protected :
   unsigned int m_currFrame;
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  The actual data of the clip stored per vertex in sequence v0 - vn and then per frame frame
-  /// index is always frame 0- endframe despite the start / end values in the clip file
+  /// index is always frame 0- endframe despite the start / end values in the clip file. This is only used
+  /// for xml files, a binary file is read from m_file
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Real> m_frames;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  the mapped binary file
+  //----------------------------------------------------------------------------------------------------------------------
+  MemoryMappedFile m_file;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  the start of frame 0 either in m_frames or m_file, 0 for a quantised bake
+  //----------------------------------------------------------------------------------------------------------------------
+  const Real *m_data;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  how the frames are stored
+  //----------------------------------------------------------------------------------------------------------------------
+  POINTBAKEFORMAT m_format;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  the frame table of a quantised bake in m_file
+  //----------------------------------------------------------------------------------------------------------------------
+  const NCCAPointBakeFrame *m_frameTable;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  the dequantise transform of a quantised bake, a position is m_min+q*m_scale
+  //----------------------------------------------------------------------------------------------------------------------
+  Real m_min[3];
+  Real m_scale[3];
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  the quantised positions of m_stateFrame as planes of x, y and z, the frame before it for the
+  /// prediction and the frame after it when blending. Playing forward only applies one delta per frame
   //----------------------------------------------------------------------------------------------------------------------
-  std::vector < std::vector<ngl::Vec3> > m_data;
+  std::vector <uint16_t> m_state;
+  std::vector <uint16_t> m_previousState;
+  std::vector <uint16_t> m_nextState;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  false if m_stateFrame is a key so the next delta is predicted from m_state alone
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_hasPreviousState;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  the frame held in m_state or 0xffffffff if none
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_stateFrame;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief  a decoded or blended frame in baked order
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Real> m_decoded;
    //----------------------------------------------------------------------------------------------------------------------
   /// @brief  Number of verts in the actual clip
   //----------------------------------------------------------------------------------------------------------------------
   unsigned int m_nVerts;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief  use the QXml stream reader for ease
-  //----------------------------------------------------------------------------------------------------------------------
-  QXmlStreamReader *m_reader;
-  //----------------------------------------------------------------------------------------------------------------------
   /// @brief  the name of the mesh
   //----------------------------------------------------------------------------------------------------------------------
   std::string m_meshName;
@@ -195,6 +392,22 @@ protected :
   //----------------------------------------------------------------------------------------------------------------------
   ngl::AbstractMesh *m_mesh;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the baked vert used by each vertex of the mesh VBO
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <GLuint> m_vertOrder;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief true if the VBO has the verts in baked order so a frame can be uploaded with no re-ordering
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_directUpload;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a frame re-ordered to match the VBO, kept to save allocating one each frame
+  //----------------------------------------------------------------------------------------------------------------------
+  std::vector <Real> m_uploadFrame;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the position stream added to the VAO of the attached mesh
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint m_positionBuffer;
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief flag to indicate if we have a binary or xml based file loaded
   //----------------------------------------------------------------------------------------------------------------------
   bool m_binFile;
@@ -206,4 +419,3 @@ protected :
 #endif // end include guard
 
 //----------------------------------------------------------------------------------------------------------------------
-
@@ -31,20 +31,25 @@
 #include <vector>
 #include "Vec4.h"
 #include "AbstractMesh.h"
+#include "MemoryMappedFile.h"
 #include "BBox.h"
 #include <cmath>
 
 namespace ngl
 {
+// defined in Obj.cpp used by the parallel parser
+struct ObjChunk;
 //----------------------------------------------------------------------------------------------------------------------
 /// @class Obj "include/Obj.h"
 /// @brief used to load in an alias wave front obj format file and draw using open gl
-///  has been completly re-written to use boost::spirit parser, most of this code is a
-/// modified version of the OBJReader class from the cortex-vfx lib framework here
-/// http://code.google.com/p/cortex-vfx/
+///  the file is memory mapped and the records are scanned directly from the mapped data
+///  without copying each line, the original boost::spirit version was a modified version of
+///  the OBJReader class from the cortex-vfx lib framework here http://code.google.com/p/cortex-vfx/
 /// @author Jonathan Macey
-/// @version 4.0
+/// @version 5.0
 /// @date 22/10/09 updated to use boost::spirit parser framework
+/// Revision History : 12/11/12 replaced spirit parser with mmap based scanner as it was very slow on big meshes
+/// 14/11/12 added progressive streaming load
 /// @example AnimatedObj/AnimatedObj.cpp
 /// @example ObjViewer/ObjViewer.cpp
 //----------------------------------------------------------------------------------------------------------------------
@@ -57,7 +62,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief default constructor
   //----------------------------------------------------------------------------------------------------------------------
-    Obj(){;}
+    Obj() : m_streamPos(0),m_streamBlockSize(0),m_streamThreads(1){;}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  constructor to load an objfile as a parameter
   /// @param[in]  &_fname the name of the obj file to load
@@ -78,10 +83,13 @@ public :
   /// @brief  Method to load the file in
   /// @param[in]  _fname the name of the obj file to load
   /// @param[in] _calcBB if we only want to load data and not use GL then set this to false
+  /// @param[in] _numThreads the number of threads used to parse the file, 0 will use all cores, the
+  /// result is identical whatever the number of threads
   //----------------------------------------------------------------------------------------------------------------------
   bool load(
             const std::string& _fname,
-            bool _calcBB=true
+            bool _calcBB=true,
+            unsigned int _numThreads=1
            );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  method to save the obj
@@ -90,36 +98,83 @@ public :
   void save(
             const std::string& _fname
            ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief start a progressive load, the file is mapped and each call to streamStep parses the next
+  /// block of it and adds the new faces to the VAO as their own draw range, so the mesh can be drawn
+  /// while it is still loading rather than stalling the render loop until the whole file is done.
+  /// A GL context is needed for streamStep as it uploads the data
+  /// @param[in] _fname the name of the obj file to load
+  /// @param[in] _blockSize the approximate number of bytes of the file to parse per step
+  /// @param[in] _numThreads the number of threads used to parse each block, 0 will use all cores
+  /// @returns true if the file was opened
+  //----------------------------------------------------------------------------------------------------------------------
+  bool beginStream(
+                   const std::string &_fname,
+                   size_t _blockSize=1024*1024,
+                   unsigned int _numThreads=1
+                  );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief parse and upload the next block of a streamed file, this is usually called once per frame
+  /// @returns true if there is more to load, once false the mesh is complete and the BBox is set
+  //----------------------------------------------------------------------------------------------------------------------
+  bool streamStep();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief are we part way through a streamed load
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isStreaming() const {return m_streamFile.isOpen();}
 
 protected :
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief parser function to parse the vertex used by boost::spirit parser
-  /// @param[in] _begin the start of the string to parse
+  /// @brief count the records in each of the chunks in the range, used as a parallelFor body
+  /// @param[in,out] io_chunks the chunks of the file, the counts are filled in
+  /// @param[in] _begin the first chunk to process
+  /// @param[in] _end one past the last chunk to process
+  //----------------------------------------------------------------------------------------------------------------------
+  void countRecords(
+                    std::vector<ObjChunk> &io_chunks,
+                    size_t _begin,
+                    size_t _end
+                   ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief parse the v/vt/vn/f records of each of the chunks in the range into the mesh lists, which
+  /// must already be sized from the counts, used as a parallelFor body
+  /// @param[in,out] io_chunks the chunks of the file
+  /// @param[in] _begin the first chunk to process
+  /// @param[in] _end one past the last chunk to process
+  //----------------------------------------------------------------------------------------------------------------------
+  void parseChunks(
+                   std::vector<ObjChunk> &io_chunks,
+                   size_t _begin,
+                   size_t _end
+                  );
   //----------------------------------------------------------------------------------------------------------------------
-  void parseVertex(
-                   const char *_begin
-                   );
+  /// @brief parse a block of obj data (whole lines) appending it to the mesh lists, the block is split
+  /// into a chunk per thread which are counted and then parsed in parallel
+  /// @param[in] _begin the start of the block
+  /// @param[in] _end one past the end of the block
+  /// @param[in] _numThreads the number of threads to use, 0 will use all cores
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief parser function to parse the Norma used by boost::spirit parser
-  /// @param[in] _begin the start of the string to parse
+  void parseBlock(
+                  const char *_begin,
+                  const char *_end,
+                  unsigned int _numThreads
+                 );
   //----------------------------------------------------------------------------------------------------------------------
-  void parseNormal(
-                   const char *_begin
-                  );
+  /// @brief the file being streamed
+  //----------------------------------------------------------------------------------------------------------------------
+  MemoryMappedFile m_streamFile;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the start of the next block to stream
+  //----------------------------------------------------------------------------------------------------------------------
+  const char *m_streamPos;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief parser function to parse the text cord used by boost::spirit parser
-  /// @param[in] _begin the start of the string to parse
+  /// @brief the number of bytes to parse per streamStep
   //----------------------------------------------------------------------------------------------------------------------
-  void parseTextureCoordinate(
-                              const char * _begin
-                             );
+  size_t m_streamBlockSize;
   //----------------------------------------------------------------------------------------------------------------------
-  /// @brief parser function to parse the Face data used by boost::spirit parser
-  /// @param[in] _begin the start of the string to parse
+  /// @brief the number of threads used to parse each streamed block
   //----------------------------------------------------------------------------------------------------------------------
-  void parseFace(
-                 const char * _begin
-                );
+  unsigned int m_streamThreads;
 
 };
 
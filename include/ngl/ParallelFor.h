@@ -0,0 +1,59 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PARALLELFOR_H__
+#define PARALLELFOR_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ParallelFor.h
+/// @brief simple fork / join helper used to split mesh processing loops across cores
+//----------------------------------------------------------------------------------------------------------------------
+#include <cstddef>
+#include <boost/function.hpp>
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the signature of a loop body, it is called with a [begin,end) sub range of the loop
+//----------------------------------------------------------------------------------------------------------------------
+typedef boost::function<void (size_t _begin, size_t _end)> RangeFunction;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief get the number of threads to use when the user asks for 0 (auto)
+/// @returns the number of hardware threads or 1 if this can't be determined
+//----------------------------------------------------------------------------------------------------------------------
+extern unsigned int defaultThreadCount();
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief split the range [_begin,_end) into contiguous blocks and run _body on each block in its own
+/// thread, the calling thread runs the last block and the function returns once all blocks are done.
+/// Each block is a contiguous range so the body can write to its own part of an output array without
+/// any locking.
+/// @param[in] _begin the start of the range
+/// @param[in] _end one past the end of the range
+/// @param[in] _body the function to call for each block
+/// @param[in] _numThreads the number of threads to use, 0 will use defaultThreadCount()
+/// @param[in] _minBlock the smallest block worth giving to a thread, small ranges run serially
+//----------------------------------------------------------------------------------------------------------------------
+extern void parallelFor(
+                        size_t _begin,
+                        size_t _end,
+                        const RangeFunction &_body,
+                        unsigned int _numThreads=0,
+                        size_t _minBlock=1024
+                       );
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
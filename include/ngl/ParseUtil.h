@@ -0,0 +1,425 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PARSEUTIL_H__
+#define PARSEUTIL_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ParseUtil.h
+/// @brief small allocation free scanners for parsing ascii data held in memory (usually a MemoryMappedFile)
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @namespace ngl::parse
+/// @brief scanners working on a [begin,end) range of chars, none of these allocate memory or
+/// require the data to be null terminated (a mapped file isn't). Each function advances the
+/// pointer passed in past whatever was consumed.
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 12/11/12 Initial version
+//----------------------------------------------------------------------------------------------------------------------
+namespace parse
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief check for white space, new lines are not white space as most formats are line based
+//----------------------------------------------------------------------------------------------------------------------
+inline bool isSpace(
+                    const char _c
+                   )
+{
+  return _c==' ' || _c=='\t' || _c=='\r' || _c=='\v' || _c=='\f';
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief check for a decimal digit
+//----------------------------------------------------------------------------------------------------------------------
+inline bool isDigit(
+                    const char _c
+                   )
+{
+  return static_cast<unsigned char>(_c-'0') < 10;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief skip white space (but not new lines)
+/// @param[in] _p the current position
+/// @param[in] _end the end of the data
+/// @returns the first non white space char or _end
+//----------------------------------------------------------------------------------------------------------------------
+inline const char *skipSpace(
+                             const char *_p,
+                             const char *_end
+                            )
+{
+  while(_p<_end && isSpace(*_p))
+  {
+    ++_p;
+  }
+  return _p;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief find the end of the current line
+/// @param[in] _p the current position
+/// @param[in] _end the end of the data
+/// @returns the position of the '\n' or _end if this is the last line
+//----------------------------------------------------------------------------------------------------------------------
+inline const char *lineEnd(
+                           const char *_p,
+                           const char *_end
+                          )
+{
+  const char *nl=static_cast<const char *>(memchr(_p,'\n',_end-_p));
+  return nl==0 ? _end : nl;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief parse a signed integer
+/// @param[in,out] io_p the current position, advanced past the number on success
+/// @param[in] _end the end of the data
+/// @param[out] o_value the value parsed
+/// @returns true if a number was found
+//----------------------------------------------------------------------------------------------------------------------
+inline bool parseInt(
+                     const char *&io_p,
+                     const char *_end,
+                     int &o_value
+                    )
+{
+  const char *p=skipSpace(io_p,_end);
+  bool negative=false;
+  if(p<_end && (*p=='-' || *p=='+'))
+  {
+    negative= (*p=='-');
+    ++p;
+  }
+  if(p==_end || !isDigit(*p))
+  {
+    return false;
+  }
+  int value=0;
+  while(p<_end && isDigit(*p))
+  {
+    value=value*10+(*p-'0');
+    ++p;
+  }
+  o_value= negative ? -value : value;
+  io_p=p;
+  return true;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief parse a floating point number ([+-]digits[.digits][(e|E)[+-]digits]). Numbers with up to
+/// 19 significant digits and a small exponent (the vast majority of mesh data) are converted exactly
+/// using a single double multiply or divide, anything else falls back to strtod so the result is always
+/// correctly rounded.
+/// @param[in,out] io_p the current position, advanced past the number on success
+/// @param[in] _end the end of the data
+/// @param[out] o_value the value parsed
+/// @returns true if a number was found
+//----------------------------------------------------------------------------------------------------------------------
+inline bool parseReal(
+                      const char *&io_p,
+                      const char *_end,
+                      Real &o_value
+                     )
+{
+  static const double s_pow10[]={1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+                                 1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+  const char *p=skipSpace(io_p,_end);
+  const char *start=p;
+  bool negative=false;
+  if(p<_end && (*p=='-' || *p=='+'))
+  {
+    negative= (*p=='-');
+    ++p;
+  }
+  uint64_t mantissa=0;
+  int digits=0;
+  int exponent=0;
+  bool found=false;
+  // integer part, leading zeros are not significant
+  while(p<_end && isDigit(*p))
+  {
+    found=true;
+    if(digits<19)
+    {
+      mantissa=mantissa*10+(*p-'0');
+      if(mantissa!=0) { ++digits; }
+    }
+    else
+    {
+      ++exponent;
+    }
+    ++p;
+  }
+  if(p<_end && *p=='.')
+  {
+    ++p;
+    while(p<_end && isDigit(*p))
+    {
+      found=true;
+      if(digits<19)
+      {
+        mantissa=mantissa*10+(*p-'0');
+        if(mantissa!=0) { ++digits; }
+        --exponent;
+      }
+      ++p;
+    }
+  }
+  if(found == false)
+  {
+    return false;
+  }
+  if(p<_end && (*p=='e' || *p=='E'))
+  {
+    const char *e=p+1;
+    bool negExp=false;
+    if(e<_end && (*e=='-' || *e=='+'))
+    {
+      negExp= (*e=='-');
+      ++e;
+    }
+    // only consume the exponent if there are digits, "1e" is the number 1 followed by junk
+    if(e<_end && isDigit(*e))
+    {
+      int exp=0;
+      while(e<_end && isDigit(*e))
+      {
+        if(exp<10000) { exp=exp*10+(*e-'0'); }
+        ++e;
+      }
+      exponent+= negExp ? -exp : exp;
+      p=e;
+    }
+  }
+  double value;
+  if(digits<=15 && exponent>=-22 && exponent<=22)
+  {
+    // both the mantissa and the power of ten are exact doubles so one operation
+    // gives a correctly rounded result
+    value=static_cast<double>(mantissa);
+    if(exponent<0)
+    {
+      value/=s_pow10[-exponent];
+    }
+    else
+    {
+      value*=s_pow10[exponent];
+    }
+    if(negative)
+    {
+      value=-value;
+    }
+  }
+  else
+  {
+    // slow path copy to a terminated buffer for strtod, anything this long is rare
+    char buffer[128];
+    size_t len=p-start;
+    if(len>=sizeof(buffer))
+    {
+      len=sizeof(buffer)-1;
+    }
+    memcpy(buffer,start,len);
+    buffer[len]='\0';
+    value=strtod(buffer,0);
+  }
+  o_value=static_cast<Real>(value);
+  io_p=p;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a tag found by nextTag, the pointers are into the data being parsed so nothing is copied
+//----------------------------------------------------------------------------------------------------------------------
+struct XmlTag
+{
+  /// @brief the element name (not null terminated)
+  const char *m_name;
+  size_t m_nameSize;
+  /// @brief the attributes of the tag, from the end of the name up to m_end
+  const char *m_attributes;
+  /// @brief the closing '>' of the tag
+  const char *m_end;
+  /// @brief true for a </name> tag
+  bool m_close;
+  /// @brief true for a <name/> tag which has no content or closing tag
+  bool m_selfClosing;
+};
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief check for a char which can be part of an xml name
+//----------------------------------------------------------------------------------------------------------------------
+inline bool isXmlNameChar(
+                          const char _c
+                         )
+{
+  return (_c>='a' && _c<='z') || (_c>='A' && _c<='Z') || isDigit(_c) || _c=='_' || _c=='-' || _c==':' || _c=='.';
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief skip white space including new lines
+/// @param[in] _p the current position
+/// @param[in] _end the end of the data
+/// @returns the first non white space char or _end
+//----------------------------------------------------------------------------------------------------------------------
+inline const char *skipWhiteSpace(
+                                  const char *_p,
+                                  const char *_end
+                                 )
+{
+  while(_p<_end && (isSpace(*_p) || *_p=='\n'))
+  {
+    ++_p;
+  }
+  return _p;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief find the next element tag in xml data, this is the event loop of a SAX style parser. Declarations,
+/// comments and processing instructions are skipped, the text of an element is the data from io_p after an
+/// opening tag up to the next tag. Entities are not expanded and a '>' in an attribute value isn't
+/// supported, neither is needed for the data formats we read.
+/// @param[in,out] io_p the current position, advanced past the tag found
+/// @param[in] _end the end of the data
+/// @param[out] o_tag the tag found
+/// @returns false if there are no more tags
+//----------------------------------------------------------------------------------------------------------------------
+inline bool nextTag(
+                    const char *&io_p,
+                    const char *_end,
+                    XmlTag &o_tag
+                   )
+{
+  const char *p=io_p;
+  for(;;)
+  {
+    p=static_cast<const char *>(memchr(p,'<',_end-p));
+    if(p==0 || ++p==_end)
+    {
+      io_p=_end;
+      return false;
+    }
+    if(*p=='!' && _end-p>=3 && p[1]=='-' && p[2]=='-')
+    {
+      // a comment may contain '>' so look for the end marker
+      static const char s_endComment[]="-->";
+      p=std::search(p+3,_end,s_endComment,s_endComment+3);
+    }
+    else if(*p=='!' || *p=='?')
+    {
+      p=static_cast<const char *>(memchr(p,'>',_end-p));
+      p= p==0 ? _end : p;
+    }
+    else
+    {
+      break;
+    }
+  }
+  o_tag.m_close= *p=='/';
+  if(o_tag.m_close)
+  {
+    ++p;
+  }
+  o_tag.m_name=p;
+  while(p<_end && isXmlNameChar(*p))
+  {
+    ++p;
+  }
+  o_tag.m_nameSize=p-o_tag.m_name;
+  o_tag.m_attributes=p;
+  o_tag.m_end=static_cast<const char *>(memchr(p,'>',_end-p));
+  if(o_tag.m_end==0)
+  {
+    io_p=_end;
+    return false;
+  }
+  o_tag.m_selfClosing= o_tag.m_end[-1]=='/';
+  io_p=o_tag.m_end+1;
+  return true;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief check the name of a tag
+/// @param[in] _tag the tag to check
+/// @param[in] _name the name to compare with
+//----------------------------------------------------------------------------------------------------------------------
+inline bool isTag(
+                  const XmlTag &_tag,
+                  const char *_name
+                 )
+{
+  size_t size=strlen(_name);
+  return size==_tag.m_nameSize && memcmp(_tag.m_name,_name,size)==0;
+}
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief find the value of an attribute of a tag
+/// @param[in] _tag the tag to search
+/// @param[in] _name the attribute name
+/// @param[out] o_begin the start of the value (after the quote)
+/// @param[out] o_end one past the end of the value
+/// @returns true if the attribute was found
+//----------------------------------------------------------------------------------------------------------------------
+inline bool xmlAttribute(
+                         const XmlTag &_tag,
+                         const char *_name,
+                         const char *&o_begin,
+                         const char *&o_end
+                        )
+{
+  size_t size=strlen(_name);
+  const char *p=_tag.m_attributes;
+  const char *end=_tag.m_end;
+  for(;;)
+  {
+    p=skipWhiteSpace(p,end);
+    const char *name=p;
+    while(p<end && isXmlNameChar(*p))
+    {
+      ++p;
+    }
+    size_t nameSize=p-name;
+    p=skipWhiteSpace(p,end);
+    if(nameSize==0 || p==end || *p!='=')
+    {
+      return false;
+    }
+    p=skipWhiteSpace(p+1,end);
+    if(p==end || (*p!='"' && *p!='\''))
+    {
+      return false;
+    }
+    const char *value=p+1;
+    p=static_cast<const char *>(memchr(value,*p,end-value));
+    if(p==0)
+    {
+      return false;
+    }
+    if(nameSize==size && memcmp(name,_name,size)==0)
+    {
+      o_begin=value;
+      o_end=p;
+      return true;
+    }
+    ++p;
+  }
+}
+
+} // end parse namespace
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
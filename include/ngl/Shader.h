@@ -45,7 +45,7 @@ public :
   /// @param[in] _type the type of shader we are building
   //----------------------------------------------------------------------------------------------------------------------
   Shader(
-          std::string _name,
+          const std::string &_name,
           SHADERTYPE _type
         );
   //----------------------------------------------------------------------------------------------------------------------
@@ -62,14 +62,14 @@ public :
   /// @param _name the file name for the source we are loading
   //----------------------------------------------------------------------------------------------------------------------
   void load(
-            std::string _name
+            const std::string &_name
            );
   /// @brief load in shader source and attach it to the shader object from a Qt Resource bundle
   /// if source is already loaded it will re-load and re-attached
   /// @param _name the file name for the source we are loading
   //----------------------------------------------------------------------------------------------------------------------
   void loadFromQtResource(
-                          std::string _name
+                          const std::string &_name
                          );
   //----------------------------------------------------------------------------------------------------------------------
   void loadFromString(
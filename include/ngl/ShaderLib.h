@@ -63,14 +63,14 @@ public :
   /// @param _name the name of the ShaderProgram to link
   //----------------------------------------------------------------------------------------------------------------------
   void createShaderProgram(
-                           std::string _name
+                           const std::string &_name
                           );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief attatch a Shader to the ShaderProgram referenced by _name
   /// @param _name the name of the ShaderProgram to attach
   //----------------------------------------------------------------------------------------------------------------------
   void attachShader(
-                    std::string _name,
+                    const std::string &_name,
                     SHADERTYPE _type
                    );
   //----------------------------------------------------------------------------------------------------------------------
@@ -80,8 +80,8 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
 
   void attachShaderToProgram(
-                             std::string _program,
-                             std::string _shader
+                             const std::string &_program,
+                             const std::string &_shader
                             );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief get the Program ID of the GL Program by name
@@ -89,21 +89,21 @@ public :
   /// @returns the id of the program found or -1 on error
   //----------------------------------------------------------------------------------------------------------------------
   GLuint getProgramID(
-                      std::string _name
+                      const std::string &_name
                      );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief compile the shader from _name
   /// @param _name the name of the ShaderProgram to compile
   //----------------------------------------------------------------------------------------------------------------------
   void compileShader(
-                      std::string _name
+                      const std::string &_name
                     );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief link the program Object  from _name
   /// @param _name the name of the ShaderProgram to link
   //----------------------------------------------------------------------------------------------------------------------
   void linkProgramObject(
-                          std::string _name
+                          const std::string &_name
                         );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief toggle debug mode
@@ -114,13 +114,13 @@ public :
   /// @param _name the name of the ShaderProgram to use
   //----------------------------------------------------------------------------------------------------------------------
   void use(
-            std::string _name
+            const std::string &_name
           );
 
   void bindAttribute(
-                      std::string _programName,
+                      const std::string &_programName,
                       GLuint _index,
-                      std::string _attribName
+                      const std::string &_attribName
                     );
 
   ShaderProgram * operator[](const std::string &_name);
@@ -184,7 +184,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setShaderParamFromMatrix(
                                 const std::string &_paramName,
-                                ngl::Mat4 _p1
+                                const ngl::Mat4 &_p1
                                );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief set a shader param by name for 1 int param note that the shader
@@ -194,7 +194,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setRegisteredUniformFromMatrix(
                                         const std::string &_registeredUniformName,
-                                        ngl::Mat4 _p1
+                                        const ngl::Mat4 &_p1
                                        );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief set a shader param by name for 1 int param note that the shader
@@ -204,7 +204,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setShaderParamFromMat3x3(
                                 const std::string &_paramName,
-                                ngl::Mat3 _p1
+                                const ngl::Mat3 &_p1
                                );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief set the registered uniform from Max3x3
@@ -213,7 +213,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setRegisteredUniformFromMat3x3(
                                       const std::string &_paramName,
-                                      ngl::Mat3 _p1
+                                      const ngl::Mat3 &_p1
                                      );
 
 
@@ -225,7 +225,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setShaderParamFromVector(
                                 const std::string &_paramName,
-                                ngl::Vec4 _p1
+                                const ngl::Vec4 &_p1
                                );
 
   //----------------------------------------------------------------------------------------------------------------------
@@ -235,7 +235,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setRegisteredUniformVector(
                                   const std::string &_paramName,
-                                  ngl::Vec4 _p1
+                                  const ngl::Vec4 &_p1
                                  );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief set a shader param by name for 1 int param note that the shader
@@ -245,7 +245,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setShaderParamFromColour(
                                 const std::string &_paramName,
-                                ngl::Colour _p1
+                                const ngl::Colour &_p1
                                );
 
   //----------------------------------------------------------------------------------------------------------------------
@@ -255,7 +255,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setRegisteredUniformFromColour(
                                   const std::string &_paramName,
-                                  ngl::Colour _p1
+                                  const ngl::Colour &_p1
                                  );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief set the pre-registered uniform from an ngl::Vector
@@ -264,7 +264,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setRegisteredUniformVec3(
                                   const std::string &_paramName,
-                                  ngl::Vec3 _p1
+                                  const ngl::Vec3 &_p1
                                  );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief set the pre-registered uniform from an ngl::Vector
@@ -273,7 +273,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void setRegisteredUniformVec2(
                                   const std::string &_paramName,
-                                  ngl::Vec2 _p1
+                                  const ngl::Vec2 &_p1
                                  );
 
   //----------------------------------------------------------------------------------------------------------------------
@@ -405,8 +405,8 @@ public :
                             const std::string &_paramName
                            );
 	void loadShaderSource(
-												 std::string _shaderName,
-												 std::string _sourceFile
+												 const std::string &_shaderName,
+												 const std::string &_sourceFile
 												);
 
 
@@ -426,8 +426,8 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
 
   void registerUniform(
-                         std::string _shaderName,
-                         std::string _uniformName
+                         const std::string &_shaderName,
+                         const std::string &_uniformName
                       );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief will parse the shader source and find any uniforms it can and register them
@@ -435,12 +435,12 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
 
   void autoRegisterUniforms(
-                              std::string _shaderName
+                              const std::string &_shaderName
                            );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief debug print any registered uniforms
   //----------------------------------------------------------------------------------------------------------------------
-  void printRegisteredUniforms(std::string _shader) const;
+  void printRegisteredUniforms(const std::string &_shader) const;
 
 protected:
 
@@ -462,6 +462,10 @@ protected:
   ShaderProgram *m_nullProgram;
 
 	std::string m_currentShader;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the program for m_currentShader so setting a uniform doesn't need a map lookup
+  //----------------------------------------------------------------------------------------------------------------------
+  ShaderProgram *m_currentProgram;
 
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief  flag to indicate the debug state
@@ -44,7 +44,7 @@ public :
   /// @param _name the name of the Program Object
   //----------------------------------------------------------------------------------------------------------------------
   ShaderProgram(
-                std::string _name
+                const std::string &_name
                );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief dtor
@@ -77,7 +77,7 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   void bindAttribute(
 											GLuint index,
-											std::string _attribName
+											const std::string &_attribName
 										 );
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief link our program object with the attatched shaders
@@ -576,7 +576,7 @@ public :
   /// @param  _uniformName - the name of the uniform to register
   //----------------------------------------------------------------------------------------------------------------------
   void registerUniform(
-                        std::string _uniformName
+                        const std::string &_uniformName
                       );
 
   //----------------------------------------------------------------------------------------------------------------------
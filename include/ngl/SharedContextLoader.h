@@ -0,0 +1,211 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHAREDCONTEXTLOADER_H__
+#define SHAREDCONTEXTLOADER_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SharedContextLoader.h
+/// @brief a loader thread with its own GL context sharing objects with the render context
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <deque>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @class SharedContextLoader "include/ngl/SharedContextLoader.h"
+/// @brief runs GL jobs (glBufferData, glTexImage2D, glCompileShader etc) on a thread with a second EGL context
+/// created with the render context as its share_context, so heavy uploads overlap rendering. Each job is
+/// followed by an EGL_KHR_fence_sync fence and a glFlush (or a glFinish if the extension is missing), the
+/// render thread calls processCompleted once a frame to poll the fences and a job is only published as
+/// ready once its commands have completed. As GL only guarantees the new contents are seen by another
+/// context when an object is next bound, bind the objects after isReady returns true before using them.
+/// The jobs run in the order they are submitted.
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 14/11/12 created
+//----------------------------------------------------------------------------------------------------------------------
+class SharedContextLoader : private boost::noncopyable
+{
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a job to run on the loader thread with the loader context current
+  //----------------------------------------------------------------------------------------------------------------------
+  typedef boost::function<void ()> Job;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor creates the shared context and starts the loader thread, check isValid afterwards
+  /// @param[in] _display the display the render context was made on
+  /// @param[in] _config the config used for the render context, it needs EGL_PBUFFER_BIT for the 1x1 loader
+  /// surface unless EGL_KHR_surfaceless_context is supported
+  /// @param[in] _share the render context to share objects with
+  //----------------------------------------------------------------------------------------------------------------------
+  SharedContextLoader(
+                      EGLDisplay _display,
+                      EGLConfig _config,
+                      EGLContext _share
+                     );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief dtor finishes the queued jobs, stops the thread and destroys the loader context
+  //----------------------------------------------------------------------------------------------------------------------
+  ~SharedContextLoader();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief was the shared context created and made current on the loader thread, if not the jobs run
+  /// straight away on the calling thread
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isValid() const {return m_context != EGL_NO_CONTEXT;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief are fences used for the handshake, if not each job ends with a glFinish
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool usesFences() const {return m_createSync !=0;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue a job for the loader thread
+  /// @param[in] _job the job to run
+  /// @returns the id of the job to pass to isReady
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int submit(
+                      const Job &_job
+                     );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue a glBufferData, the buffer name is made now so it can be stored straight away
+  /// @param[in] _target the buffer target (GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER)
+  /// @param[in] _size the size of the data in bytes
+  /// @param[in] _data the data, this is copied so can be freed straight away
+  /// @param[out] o_id the id of the job to pass to isReady
+  /// @param[in] _usage the usage passed to glBufferData
+  /// @returns the buffer name
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint uploadBuffer(
+                      GLenum _target,
+                      size_t _size,
+                      const void *_data,
+                      unsigned int &o_id,
+                      GLenum _usage=GL_STATIC_DRAW
+                     );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue a glTexImage2D of tightly packed GL_UNSIGNED_BYTE pixels with linear filtering and mipmaps
+  /// @param[in] _format the pixel format (GL_RGB / GL_RGBA etc)
+  /// @param[in] _width the width of the image
+  /// @param[in] _height the height of the image
+  /// @param[in] _data the pixels, these are copied so can be freed straight away
+  /// @param[out] o_id the id of the job to pass to isReady
+  /// @returns the texture name
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint uploadTexture(
+                       GLenum _format,
+                       GLsizei _width,
+                       GLsizei _height,
+                       const void *_data,
+                       unsigned int &o_id
+                      );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief poll the fences of the finished jobs and publish the ones that have completed, call this
+  /// once a frame on the render thread
+  /// @returns the number of jobs published
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int processCompleted();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief block until every submitted job is ready
+  //----------------------------------------------------------------------------------------------------------------------
+  void finish();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief has a job completed and been published by processCompleted
+  /// @param[in] _id the id returned by submit / uploadBuffer / uploadTexture
+  //----------------------------------------------------------------------------------------------------------------------
+  bool isReady(
+               unsigned int _id
+              ) const;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the number of jobs not yet published
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int getNumPending() const;
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief a job that has run and the fence to wait for
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Fence
+  {
+    unsigned int m_id;
+    EGLSyncKHR m_sync;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the loader thread
+  //----------------------------------------------------------------------------------------------------------------------
+  void loaderLoop();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the display and the loader context and surface
+  //----------------------------------------------------------------------------------------------------------------------
+  EGLDisplay m_display;
+  EGLContext m_context;
+  EGLSurface m_surface;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the EGL_KHR_fence_sync entry points, 0 if not supported
+  //----------------------------------------------------------------------------------------------------------------------
+  PFNEGLCREATESYNCKHRPROC m_createSync;
+  PFNEGLDESTROYSYNCKHRPROC m_destroySync;
+  PFNEGLCLIENTWAITSYNCKHRPROC m_clientWaitSync;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the jobs waiting to run
+  //----------------------------------------------------------------------------------------------------------------------
+  std::deque<Job> m_jobs;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the jobs that have run waiting for their fences
+  //----------------------------------------------------------------------------------------------------------------------
+  std::deque<Fence> m_fences;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the next id to give out and the id of the first job not yet ready
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_nextID;
+  unsigned int m_firstPendingID;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the id of the next job the loader thread will run
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_runID;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief flag to stop the loader thread
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_quit;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set by the loader thread once it has tried to make its context current and if it managed to
+  //----------------------------------------------------------------------------------------------------------------------
+  bool m_started;
+  bool m_current;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief guards the queues and ids
+  //----------------------------------------------------------------------------------------------------------------------
+  mutable boost::mutex m_mutex;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief wakes the loader when there is work, and the ctor and finish when the loader has started or a job has run
+  //----------------------------------------------------------------------------------------------------------------------
+  boost::condition_variable m_wake;
+  boost::condition_variable m_ran;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the loader thread
+  //----------------------------------------------------------------------------------------------------------------------
+  boost::thread m_thread;
+};
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
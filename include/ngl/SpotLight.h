@@ -159,7 +159,7 @@ public:
   //----------------------------------------------------------------------------------------------------------------------
 
   void loadToShader(
-                    std::string _uniformName
+                    const std::string &_uniformName
                    )const;
   void setTransform(ngl::Mat4 &_t);
 
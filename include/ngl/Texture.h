@@ -84,6 +84,15 @@ public :
   //----------------------------------------------------------------------------------------------------------------------
   GLuint setTextureGL() const;
   //----------------------------------------------------------------------------------------------------------------------
+  /// @brief as setTextureGL but the texture is only allocated now and the pixels are uploaded over several
+  /// frames by UploadQueue::processFrame, the mipmaps are built once the last row is in
+  /// @param[out] o_uploadID if not null the UploadQueue id to pass to isUploaded
+  /// @returns the texture object id
+  //----------------------------------------------------------------------------------------------------------------------
+  GLuint setTextureGLDeferred(
+                              unsigned int *o_uploadID=0
+                             ) const;
+  //----------------------------------------------------------------------------------------------------------------------
   /// @brief set the texture object to be different texture in multitexture
   /// @param _id the texture id
   //----------------------------------------------------------------------------------------------------------------------
@@ -195,7 +195,7 @@ namespace ngl
       /// @param[in] _which which matrix mode to use
       //----------------------------------------------------------------------------------------------------------------------
       void loadMatrixToShader(
-                              std::string _param,
+                              const std::string &_param,
                               ACTIVEMATRIX _which=NORMAL
                              );
       //----------------------------------------------------------------------------------------------------------------------
@@ -204,7 +204,7 @@ namespace ngl
       /// @param[in] _which which matrix mode to use
       //----------------------------------------------------------------------------------------------------------------------
       void loadGlobalAndCurrentMatrixToShader(
-                                              std::string _param,
+                                              const std::string &_param,
                                               ACTIVEMATRIX _which=NORMAL
                                              );
       //----------------------------------------------------------------------------------------------------------------------
@@ -213,7 +213,7 @@ namespace ngl
       /// @param[in] _which which matrix mode to use
       //----------------------------------------------------------------------------------------------------------------------
       void loadGlobalMatrixToShader(
-                                    std::string _param,
+                                    const std::string &_param,
                                     ACTIVEMATRIX _which=NORMAL
                                    );
       ngl::Mat4 & getGlobalMatrix(){return m_globalMatrix;}
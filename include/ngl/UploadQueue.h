@@ -0,0 +1,193 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef UPLOADQUEUE_H__
+#define UPLOADQUEUE_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file UploadQueue.h
+/// @brief spreads large buffer and texture uploads over several frames
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <deque>
+#include <vector>
+#include "Singleton.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the numbers for one call of UploadQueue::processFrame
+//----------------------------------------------------------------------------------------------------------------------
+struct UploadStats
+{
+  /// @brief the bytes given to GL this frame
+  size_t m_bytesUploaded;
+  /// @brief the number of glBufferSubData / glTexSubImage2D calls this frame
+  unsigned int m_slices;
+  /// @brief the number of uploads finished this frame
+  unsigned int m_completed;
+  /// @brief the time spent uploading in milli seconds
+  float m_timeMs;
+  /// @brief the bytes still waiting after this frame
+  size_t m_backlogBytes;
+  /// @brief the uploads still waiting after this frame
+  unsigned int m_backlogItems;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class UploadQueue "include/ngl/UploadQueue.h"
+/// @brief a singleton queue of buffer and texture uploads. The GL storage is allocated when the upload is
+/// queued and the data is copied in with glBufferSubData / glTexSubImage2D slices, processFrame is called
+/// once a frame on the render thread and stops when either the byte or time budget is used up. The uploads
+/// are done in the order they are queued so an upload is finished once isUploaded returns true.
+/// @author Jonathan Macey
+/// @version 1.0
+/// @date 12/11/12 created
+//----------------------------------------------------------------------------------------------------------------------
+class UploadQueue : public Singleton<UploadQueue>
+{
+  friend class Singleton<UploadQueue>;
+public :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue an upload to a buffer, the buffer is allocated with glBufferData now
+  /// @param[in] _target the buffer target (GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER)
+  /// @param[in] _buffer the buffer id
+  /// @param[in] _size the size of the data in bytes
+  /// @param[in] _data the data, this is copied so can be freed straight away
+  /// @param[in] _usage the usage passed to glBufferData
+  /// @returns the id of the upload to pass to isUploaded
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int queueBuffer(
+                           GLenum _target,
+                           GLuint _buffer,
+                           size_t _size,
+                           const void *_data,
+                           GLenum _usage=GL_STATIC_DRAW
+                          );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief queue an upload to level 0 of a 2D texture, the texture is allocated with glTexImage2D now and
+  /// uploaded in whole rows
+  /// @param[in] _texture the texture id
+  /// @param[in] _format the pixel format (GL_RGB / GL_RGBA etc)
+  /// @param[in] _width the width of the image
+  /// @param[in] _height the height of the image
+  /// @param[in] _data the tightly packed GL_UNSIGNED_BYTE pixels, this is copied
+  /// @param[in] _mipmap if true glGenerateMipmap is called once the last row is uploaded
+  /// @returns the id of the upload to pass to isUploaded, a zero sized texture has nothing to upload
+  /// and is marked done by the next processFrame
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int queueTexture(
+                            GLuint _texture,
+                            GLenum _format,
+                            GLsizei _width,
+                            GLsizei _height,
+                            const void *_data,
+                            bool _mipmap=true
+                           );
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief upload the next slices within the budget, call this once per frame on the render thread
+  /// @returns the stats for this call (also available from getFrameStats)
+  //----------------------------------------------------------------------------------------------------------------------
+  const UploadStats &processFrame();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief upload everything now ignoring the budget
+  //----------------------------------------------------------------------------------------------------------------------
+  void flush();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief has an upload finished
+  /// @param[in] _id the id returned by queueBuffer / queueTexture
+  //----------------------------------------------------------------------------------------------------------------------
+  inline bool isUploaded(unsigned int _id) const {return _id < m_firstPendingID;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the most bytes uploaded per frame (0 for no limit), the default is 1MB
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setByteBudget(size_t _bytes){m_byteBudget=_bytes;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the most time spent per frame in milli seconds (0 for no limit), the default is 2ms
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setTimeBudget(float _ms){m_timeBudget=_ms;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the size of each glBufferSubData / glTexSubImage2D call, the default is 64K
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setSliceSize(size_t _bytes){m_sliceSize= _bytes > 0 ? _bytes : 1;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the stats from the last processFrame
+  //----------------------------------------------------------------------------------------------------------------------
+  inline const UploadStats &getFrameStats() const {return m_stats;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the bytes waiting to be uploaded
+  //----------------------------------------------------------------------------------------------------------------------
+  inline size_t getBacklogBytes() const {return m_backlogBytes;}
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the number of uploads waiting
+  //----------------------------------------------------------------------------------------------------------------------
+  inline unsigned int getBacklogItems() const {return m_jobs.size();}
+
+private :
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief ctor
+  //----------------------------------------------------------------------------------------------------------------------
+  UploadQueue();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief one queued upload
+  //----------------------------------------------------------------------------------------------------------------------
+  struct Upload
+  {
+    /// @brief GL_TEXTURE_2D for a texture else the buffer target
+    GLenum m_target;
+    GLuint m_id;
+    GLenum m_format;
+    GLsizei m_width;
+    GLsizei m_height;
+    bool m_mipmap;
+    /// @brief the bytes uploaded so far
+    size_t m_offset;
+    std::vector<unsigned char> m_data;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief upload one slice of the first upload in the queue
+  /// @returns the number of bytes uploaded
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t uploadSlice();
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the uploads in order
+  //----------------------------------------------------------------------------------------------------------------------
+  std::deque<Upload> m_jobs;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the id of the first upload in m_jobs and the next id to give out
+  //----------------------------------------------------------------------------------------------------------------------
+  unsigned int m_firstPendingID;
+  unsigned int m_nextID;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the budgets
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t m_byteBudget;
+  float m_timeBudget;
+  size_t m_sliceSize;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the bytes still to upload
+  //----------------------------------------------------------------------------------------------------------------------
+  size_t m_backlogBytes;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the last frame stats
+  //----------------------------------------------------------------------------------------------------------------------
+  UploadStats m_stats;
+};
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
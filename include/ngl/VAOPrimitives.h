@@ -21,6 +21,7 @@
 #include "Types.h"
 #include "Singleton.h"
 #include "VertexArrayObject.h"
+#include "VertexQuantiser.h"
 #include <vector>
 #include <iostream>
 #include <string>
@@ -66,6 +67,24 @@ public :
              const std::string &_name
             );
 	//----------------------------------------------------------------------------------------------------------------------
+  /// @brief set the vertex layout used for the primitives created after this call, the default is VERTEX_FLOAT
+  /// @param[in] _format the vertex format
+  //----------------------------------------------------------------------------------------------------------------------
+  inline void setVertexFormat(
+                              const VERTEXFORMAT _format
+                             )
+                             {
+                               m_vertexFormat=_format;
+                             }
+	//----------------------------------------------------------------------------------------------------------------------
+  /// @brief get the matrix to turn the quantised positions of a primitive back into model space, use
+  /// getDequantiseTransform(_name)*model as the model matrix. Primitives stored as floats return the identity
+  /// @param[in] _name the name of the primitive
+  //----------------------------------------------------------------------------------------------------------------------
+  Mat4 getDequantiseTransform(
+                              const std::string &_name
+                             ) const;
+	//----------------------------------------------------------------------------------------------------------------------
   /// @brief create a triangulated Sphere as a vbo with auto generated texture cords
   /// @param[in] _name the name of the object created used when drawing
   /// @param[in] _radius the sphere radius
@@ -170,7 +189,7 @@ public :
                              );
 
 	//----------------------------------------------------------------------------------------------------------------------
-  /// @brief load a VBO from a binary file created from Obj2VBO program
+  /// @brief load a VBO from a binary file saved with AbstractMesh::saveNCCABinaryMesh
   /// @param[in] _name the name of the VBO to be stored as ref to this object
   /// @param[in] _fName the name of the file to load.
   /// @param[in] _type the draw mode type
@@ -185,6 +204,14 @@ public :
   /// don't want the default primitives
   //----------------------------------------------------------------------------------------------------------------------
   void clear();
+	//----------------------------------------------------------------------------------------------------------------------
+  /// @brief create the built in models (teapot, cube etc), this is done by the ctor as VERTEX_FLOAT but can be
+  /// called again after clear or to replace them in another format, use getDequantiseTransform for quantised ones
+  /// @param[in] _format the vertex layout to upload the models as
+  //----------------------------------------------------------------------------------------------------------------------
+  void createDefaultVAOs(
+                         const VERTEXFORMAT _format=VERTEX_FLOAT
+                        );
 
 
 private :
@@ -192,6 +219,14 @@ private :
 	///  a map to store the VAO by name
 	//----------------------------------------------------------------------------------------------------------------------
 	std::map <std::string,VertexArrayObject *> m_createdVAOs;
+	//----------------------------------------------------------------------------------------------------------------------
+	///  the dequantise matrix for each primitive created with VERTEX_QUANTISED
+	//----------------------------------------------------------------------------------------------------------------------
+	std::map <std::string,Mat4> m_dequantise;
+	//----------------------------------------------------------------------------------------------------------------------
+	///  the vertex layout for new primitives
+	//----------------------------------------------------------------------------------------------------------------------
+	VERTEXFORMAT m_vertexFormat;
 
 	//----------------------------------------------------------------------------------------------------------------------
 	/// @brief default constructor
@@ -204,29 +239,28 @@ private :
   /// @param[in] _name the name reference for the VBO lookup
   /// @param[in] _data a pointer to the data to load
   /// @param[in] _Size the size of the array of data to load
+  /// @param[in] _format the vertex layout to upload the data as
   //----------------------------------------------------------------------------------------------------------------------
   void createVAOFromHeader(
                            const std::string &_name,
                            Real const *_data,
-                           const unsigned int _Size
+                           const unsigned int _Size,
+                           const VERTEXFORMAT _format
                           );
 
-	//----------------------------------------------------------------------------------------------------------------------
-  /// @brief create the default VAO's this is done by the ctor anyway but can be called
-  /// if the clear method is called. Note you will need to incude VAOHeaders in the client side
-  //----------------------------------------------------------------------------------------------------------------------
-  void createDefaultVAOs();
 	//----------------------------------------------------------------------------------------------------------------------
   /// @brief the method to actually create the VAO from the various other methods
   /// Note this is used in conjunction with the vertData struct
   /// @param[in] _name the name to store in the map of the VBO
   /// @param[in] _data the raw data packed into the vertData structure
   /// @param[in] _mode the mode to draw
+  /// @param[in] _format the vertex layout to upload the data as
   //----------------------------------------------------------------------------------------------------------------------
   void createVAO(
                  const std::string &_name,
                  const std::vector <vertData> &_data,
-                 const GLenum _mode
+                 const GLenum _mode,
+                 const VERTEXFORMAT _format=VERTEX_FLOAT
                 );
 	//----------------------------------------------------------------------------------------------------------------------
   /// @brief create the elements of a circle this is borrowed from freeglut
@@ -280,6 +280,7 @@ public:
   /// @brief accesor to the m_openGL matrix returns the address of the 0th element
   //----------------------------------------------------------------------------------------------------------------------
   inline Real* openGL(){return &m_openGL[0];}
+  inline const Real* openGL() const {return &m_openGL[0];}
   //----------------------------------------------------------------------------------------------------------------------
   /// @brief insertion operator to print out the Vec2
   /// @param[in] _output the stream to write to
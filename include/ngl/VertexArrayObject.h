@@ -24,7 +24,9 @@
 
 // must include types.h first for ngl::Real and GLEW if required
 #include "Types.h"
+#include "GLStateCache.h"
 #include <vector>
+#include <utility>
 #include <iostream>
 //----------------------------------------------------------------------------------------------------------------------
 /// @file VertexArrayObject.h
@@ -40,7 +42,13 @@ namespace ngl
 
 //----------------------------------------------------------------------------------------------------------------------
 /// @class VertexArrayObject "include/VertexArrayObject.h"
-/// @brief a class to encapsulate an OpenGL VAO
+/// @brief a class to encapsulate an OpenGL VAO. Where the driver has GL_OES_vertex_array_object each buffer
+/// gets a real VAO, the attribute pointers and index buffer are recorded into it at the first draw after
+/// they change and a draw is then one glBindVertexArrayOES plus the draw call. Without the extension the
+/// layout last set is remembered and the attributes are only respecified when a different VAO or buffer
+/// is drawn. bind and unbind make no GL calls, the GL VAO is left bound after a draw so the next draw of
+/// the same VAO needs no bind at all, code outside this class which binds GL_ELEMENT_ARRAY_BUFFER or
+/// changes vertex attribute state must call resetBinding first
 //----------------------------------------------------------------------------------------------------------------------
 
 class VertexAttribute
@@ -52,18 +60,31 @@ class VertexAttribute
 														GLenum _type,
 														GLsizei _stride,
 														unsigned int _dataOffset,
-														bool _normalise=GL_FALSE
+														bool _normalise=GL_FALSE,
+														GLuint _buffer=0
 													 );
 
-		~VertexAttribute(){glDisableVertexAttribArray(m_id);}
-		void bind()const
+		/// @brief the attribute location
+		inline GLuint getID() const {return m_id;}
+		/// @brief set the attribute pointer, attributes from a stream buffer bind their own buffer and
+		/// then put _vbo back for the next attribute
+		/// @param _vbo the buffer being drawn
+		void bind(GLuint _vbo=0)const
 		{
+			if(m_buffer !=0)
+			{
+				GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER,m_buffer);
+			}
 			glVertexAttribPointer(m_id,m_size,m_type,m_normalise,m_stride,((float *)NULL + (m_dataOffset)));
-			glEnableVertexAttribArray(m_id);
+			GLStateCache::instance()->enableVertexAttribArray(m_id);
+			if(m_buffer !=0)
+			{
+				GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER,_vbo);
+			}
 		}
 	  void unbind()const
 	  {
-			 glDisableVertexAttribArray(m_id);
+			 GLStateCache::instance()->disableVertexAttribArray(m_id);
 		 }
 	private :
 		#pragma pack(push,1)
@@ -73,9 +94,21 @@ class VertexAttribute
 		GLsizei m_stride;
 		unsigned int m_dataOffset;
 		bool m_normalise;
+		/// @brief the stream buffer the attribute reads from or 0 for the buffer being drawn
+		GLuint m_buffer;
 		#pragma pack(pop)
 };
 
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the vertices written by VertexArrayObject::appendData, pass to drawRange to draw them
+//----------------------------------------------------------------------------------------------------------------------
+struct DynamicRange
+{
+	/// @brief the first vertex written
+	GLuint m_first;
+	/// @brief the number of vertices written
+	GLuint m_count;
+};
 
 
 
@@ -133,6 +166,19 @@ public:
 							  GLenum _mode=GL_STATIC_DRAW
 							);
 	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief as setData but the buffer is only allocated now and the data is copied in over several frames by
+	/// UploadQueue::processFrame, don't draw the VAO until UploadQueue::isUploaded returns true for the id
+	/// @param _size the size of the raw data passed
+	/// @param _data the actual data to set for the VOA, this is copied so can be freed straight away
+	/// @param _mode the draw mode hint used by GL
+	/// @returns the UploadQueue id for the upload
+	//----------------------------------------------------------------------------------------------------------------------
+	unsigned int setDataDeferred(
+															 unsigned int _size,
+															 const GLfloat &_data,
+															 GLenum _mode=GL_STATIC_DRAW
+															);
+	//----------------------------------------------------------------------------------------------------------------------
 	/// @brief allocate our data using raw face values (for example tri's) data, attributes must be bound to match at
 	/// a different level of code (usually in the client as part of the shader loading, see VAO examples for more details
 	/// This value uses an index array to point to series of data to store
@@ -151,6 +197,107 @@ public:
 											GLenum _mode=GL_STATIC_DRAW
 
 										 );
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief as above but using 16 bit indices so up to 65536 vertices can be indexed
+	/// @param _size the size of the raw data passed
+	/// @param _data the actual data to set for the VOA
+	/// @param _indexSize the number of indices passed
+	/// @param _indexData the actual data to set for the VOA indexes
+	/// @param _mode the draw mode hint used by GL
+	//----------------------------------------------------------------------------------------------------------------------
+	void setIndexedData(
+											unsigned int _size,
+											const GLfloat &_data,
+											unsigned int _indexSize,
+											const GLushort &_indexData,
+											GLenum _mode=GL_STATIC_DRAW
+										 );
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief as above but using 32 bit indices, GLES 2 only supports these with the
+	/// GL_OES_element_index_uint extension so check for it before using this
+	/// @param _size the size of the raw data passed
+	/// @param _data the actual data to set for the VOA
+	/// @param _indexSize the number of indices passed
+	/// @param _indexData the actual data to set for the VOA indexes
+	/// @param _mode the draw mode hint used by GL
+	//----------------------------------------------------------------------------------------------------------------------
+	void setIndexedData(
+											unsigned int _size,
+											const GLfloat &_data,
+											unsigned int _indexSize,
+											const GLuint &_indexData,
+											GLenum _mode=GL_STATIC_DRAW
+										 );
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief add indexed data of any size, the smallest index type that works is picked. Up to 65536 vertices
+	/// use 16 bit indices, more use 32 bit ones if the driver has GL_OES_element_index_uint else the
+	/// primitives are split into buffers of at most 65536 vertices each drawn with its own index count.
+	/// Split vertices are copied into every buffer that uses them, so streams (which follow the vertices of
+	/// the first buffer) and drawRange only work if getNumBuffers is 1 afterwards
+	/// @param _vertexSize the size in bytes of one vertex
+	/// @param _numVerts the number of vertices in _data
+	/// @param _data the vertices
+	/// @param _indexSize the number of indices passed
+	/// @param _indexData the indices
+	/// @param _mode the draw mode hint used by GL
+	/// @returns the number of buffers added, 0 if _indexSize is 0 or an index is not less than _numVerts
+	//----------------------------------------------------------------------------------------------------------------------
+	unsigned int setIndexedDataAuto(
+																	unsigned int _vertexSize,
+																	unsigned int _numVerts,
+																	const GLfloat &_data,
+																	unsigned int _indexSize,
+																	const GLuint &_indexData,
+																	GLenum _mode=GL_STATIC_DRAW
+																 );
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief re-upload parts of a buffer. If the ranges cover half the buffer or more it is all re-specified with
+	/// glBufferData (which orphans the old storage rather than waiting for draws using it), else with
+	/// GL_OES_mapbuffer and more than one range the buffer is mapped once and every range copied in, else
+	/// each range is a glBufferSubData
+	/// @param _index the buffer (0 for the first setData call etc)
+	/// @param _size the size in bytes of the whole buffer
+	/// @param _data the new contents of the whole buffer, only the ranges are read unless it is all re-specified
+	/// @param _ranges the byte offset and size of each range to upload
+	//----------------------------------------------------------------------------------------------------------------------
+	void updateData(
+									unsigned int _index,
+									unsigned int _size,
+									const GLvoid *_data,
+									const std::vector< std::pair<unsigned int,unsigned int> > &_ranges
+								 );
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief make the first buffer a dynamic ring buffer for geometry which changes every frame, it is
+	/// allocated once and appendData writes each batch after the last with glBufferSubData. When a batch
+	/// doesn't fit the buffer is orphaned with glBufferData(NULL) and writing starts again at the front, the
+	/// driver keeps the old storage alive for draws still in flight so the CPU never waits for the GPU.
+	/// Set the attribute pointers as usual (with a 0 offset) and draw each batch with drawRange
+	/// @param _size the size in bytes of the ring, a few frames worth of data is a good size
+	//----------------------------------------------------------------------------------------------------------------------
+	void setDynamicData(
+											unsigned int _size
+										 );
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief write vertices into the ring made by setDynamicData
+	/// @param _vertexSize the size in bytes of one vertex, this must match the attribute stride
+	/// @param _numVerts the number of vertices in _data
+	/// @param _data the vertices
+	/// @returns the range to pass to drawRange, it stays valid until a later appendData call wraps the ring
+	//----------------------------------------------------------------------------------------------------------------------
+	DynamicRange appendData(
+													unsigned int _vertexSize,
+													unsigned int _numVerts,
+													const GLfloat &_data
+												 );
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief start the next appendData at the front of a fresh (orphaned) ring, ranges already returned are
+	/// still drawable until the next appendData
+	//----------------------------------------------------------------------------------------------------------------------
+	void orphanDynamicData();
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief how many times the ring has been orphaned, a number which grows every frame means the ring is too small
+	//----------------------------------------------------------------------------------------------------------------------
+	inline unsigned int getNumOrphans() const {return m_dynamicOrphans;}
 	//----------------------------------------------------------------------------------------------------------------------
 		/// @brief allocate our data
 		/// @param _size the size of the raw data passed (not counting sizeof(GL_FLOAT))
@@ -170,14 +317,72 @@ public:
 																	bool _normalise=GL_FALSE
 																);
 	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief add an extra attribute stream, this is a separate buffer holding more attributes for the same
+	/// vertices as the first setData / setIndexedData buffer, it is not drawn on its own. Use
+	/// setStreamAttributePointer to read attributes from it
+	/// @param _size the size of the raw data passed
+	/// @param _data the actual data for the stream
+	/// @param _mode the draw mode hint used by GL
+	/// @returns the stream index
+	//----------------------------------------------------------------------------------------------------------------------
+	unsigned int setStreamData(
+														 unsigned int _size,
+														 const GLfloat &_data,
+														 GLenum _mode=GL_STATIC_DRAW
+														);
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief as setVertexAttributePointer but reading from a buffer added with setStreamData
+	/// @param _stream the stream index returned by setStreamData
+	//----------------------------------------------------------------------------------------------------------------------
+	void setStreamAttributePointer(
+																 unsigned int _stream,
+																 GLuint _id,
+																 GLint _size,
+																 GLenum _type,
+																 GLsizei _stride,
+																 unsigned int _dataOffset,
+																 bool _normalise=GL_FALSE
+																);
+	//----------------------------------------------------------------------------------------------------------------------
 	/// @brief draw the VOA
 	//----------------------------------------------------------------------------------------------------------------------
 	void draw() const;
 	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief draw part of the first buffer, this is used to draw one LOD when several index lists are
+	/// packed into one index buffer
+	/// @param _first the first index (or vertex if not indexed) to draw
+	/// @param _count the number of indices to draw
+	//----------------------------------------------------------------------------------------------------------------------
+	void drawRange(
+								 GLuint _first,
+								 GLuint _count
+								) const;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief draw vertices written by appendData
+	/// @param _range the range returned by appendData
+	//----------------------------------------------------------------------------------------------------------------------
+	inline void drawRange(
+												const DynamicRange &_range
+											 ) const
+											 {
+												 drawRange(_range.m_first,_range.m_count);
+											 }
+	//----------------------------------------------------------------------------------------------------------------------
 	/// @brief set the number of faces to draw
 	/// @param _n the number of indices to draw in glDrawArray (param 3 count)
 	//----------------------------------------------------------------------------------------------------------------------
 	inline void setNumIndices(GLuint _n){m_indicesCount=_n;}
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief set the number of indices to draw for a single buffer, each call to setData / setIndexedData adds
+	/// a buffer which is drawn in turn so this lets each one be a different sized draw range
+	/// @param _index the buffer (0 for the first setData call etc)
+	/// @param _n the number of indices to draw, 0 will use the value from setNumIndices
+	//----------------------------------------------------------------------------------------------------------------------
+	inline void setBufferNumIndices(unsigned int _index,GLuint _n){m_bufferIndicesCount[_index]=_n;}
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief get the number of buffers added with setData / setIndexedData
+	//----------------------------------------------------------------------------------------------------------------------
+	inline unsigned int getNumBuffers() const {return m_vbos.size();}
 	inline void setDrawMode(GLenum _mode){m_drawMode=_mode;}
 	/// @brief get the VBO id for the data mapped at index _index
 	/// basically this will be the vbo for the setData called, so if it has been called
@@ -185,6 +390,33 @@ public:
 	/// @param[in] _index the index to get the id for
 	/// @returns 0 if not found else the vbo id
 	GLuint getVBOid(unsigned int _index );
+	/// @brief get the buffer id of a stream added with setStreamData
+	/// @param[in] _stream the stream index returned by setStreamData
+	/// @returns 0 if not found else the buffer id
+	inline GLuint getStreamID(unsigned int _stream) const {return _stream<m_streams.size() ? m_streams[_stream] : 0;}
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief bind GL VAO 0 and forget the cached attribute layout, call this before binding
+	/// GL_ELEMENT_ARRAY_BUFFER or enabling / setting vertex attributes outside this class
+	//----------------------------------------------------------------------------------------------------------------------
+	static void resetBinding();
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief allow or stop the use of GL_OES_vertex_array_object, this is mainly to test the fallback
+	/// or to work round broken drivers and must be called before any VAO is drawn
+	/// @param _use true to use the extension when the driver has it
+	//----------------------------------------------------------------------------------------------------------------------
+	static void setUseExtension(bool _use);
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief are GL VAOs being used, this is only valid once a VAO has been created
+	//----------------------------------------------------------------------------------------------------------------------
+	inline static bool usesExtension() {return s_useExtension;}
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief does the driver have GL_OES_element_index_uint, this is only valid once a VAO has been created
+	//----------------------------------------------------------------------------------------------------------------------
+	inline static bool supportsUintIndices() {return s_uintIndices;}
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief does the driver have GL_OES_mapbuffer, this is only valid once a VAO has been created
+	//----------------------------------------------------------------------------------------------------------------------
+	inline static bool supportsMapBuffer() {return s_mapBuffer !=0;}
 protected :
 	//----------------------------------------------------------------------------------------------------------------------
 	/// @brief the draw mode of the VAO e.g. GL_TRIANGLES
@@ -195,13 +427,58 @@ protected :
 	//----------------------------------------------------------------------------------------------------------------------
 	GLenum m_indicesCount;
 	//----------------------------------------------------------------------------------------------------------------------
-	/// @brief the id of the VAO allocated by OpenGL
+	/// @brief the id of the VAO allocated by OpenGL for the first buffer, 0 without the extension
+	//----------------------------------------------------------------------------------------------------------------------
+	mutable GLuint m_id;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the GL VAO for each buffer, made at the first draw
 	//----------------------------------------------------------------------------------------------------------------------
-	GLuint m_id;
+	mutable std::vector <GLuint> m_vaoIDs;
 	std::vector <GLuint> m_vbos;
 	std::vector <GLuint> m_ibos;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the extra attribute stream buffers added with setStreamData
+	//----------------------------------------------------------------------------------------------------------------------
+	std::vector <GLuint> m_streams;
 	std::vector <VertexAttribute>m_attributes;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the number of indices to draw for each buffer, 0 uses m_indicesCount
+	//----------------------------------------------------------------------------------------------------------------------
+	std::vector <GLuint> m_bufferIndicesCount;
 
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the type of the index data (GL_UNSIGNED_BYTE or GL_UNSIGNED_SHORT)
+	//----------------------------------------------------------------------------------------------------------------------
+	GLenum m_indexType;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief upload the vertex and index buffers for the setIndexedData methods
+	/// @param _size the size of the raw data passed
+	/// @param _data the actual data to set for the VOA
+	/// @param _indexBytes the size in bytes of the index data
+	/// @param _indexData the index data
+	/// @param _indexType the GL type of the index data
+	/// @param _mode the draw mode hint used by GL
+	//----------------------------------------------------------------------------------------------------------------------
+	void setIndexedBuffers(
+												 unsigned int _size,
+												 const GLfloat &_data,
+												 unsigned int _indexBytes,
+												 const GLvoid *_indexData,
+												 GLenum _indexType,
+												 GLenum _mode
+												);
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the size in bytes of the dynamic ring, 0 if setDynamicData hasn't been called
+	//----------------------------------------------------------------------------------------------------------------------
+	unsigned int m_dynamicSize;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief where the next appendData writes in the ring
+	//----------------------------------------------------------------------------------------------------------------------
+	unsigned int m_dynamicOffset;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the number of times the ring has been orphaned
+	//----------------------------------------------------------------------------------------------------------------------
+	unsigned int m_dynamicOrphans;
 	//----------------------------------------------------------------------------------------------------------------------
 	/// @brief flag to indicate if we have allocated the data to the VAO
 	//----------------------------------------------------------------------------------------------------------------------
@@ -215,6 +492,56 @@ protected :
 	//----------------------------------------------------------------------------------------------------------------------
 	bool m_bound;
 	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief set when buffers or attributes are added so the GL VAOs are recorded again at the next draw
+	//----------------------------------------------------------------------------------------------------------------------
+	mutable bool m_dirty;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief make the attribute state for buffer _index current, binding its GL VAO or respecifying the
+	/// attributes if the cached layout is for another VAO or buffer
+	/// @param _index the buffer to draw
+	//----------------------------------------------------------------------------------------------------------------------
+	void bindBuffer(
+									unsigned int _index
+								 ) const;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief make any missing GL VAOs and record the buffers and attributes into all of them
+	//----------------------------------------------------------------------------------------------------------------------
+	void record() const;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief mark the VAO as changed so the next draw records / respecifies the attributes
+	//----------------------------------------------------------------------------------------------------------------------
+	void setDirty();
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief look for GL_OES_vertex_array_object and GL_OES_mapbuffer and load their entry points and look
+	/// for GL_OES_element_index_uint, done once by the first ctor
+	//----------------------------------------------------------------------------------------------------------------------
+	static void checkExtension();
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief has checkExtension run, should the extension be used, and may it be used (setUseExtension)
+	//----------------------------------------------------------------------------------------------------------------------
+	static bool s_extensionChecked;
+	static bool s_useExtension;
+	static bool s_allowExtension;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief does the driver have GL_OES_element_index_uint
+	//----------------------------------------------------------------------------------------------------------------------
+	static bool s_uintIndices;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the GL_OES_mapbuffer entry points or 0 if the driver doesn't have it
+	//----------------------------------------------------------------------------------------------------------------------
+	static PFNGLMAPBUFFEROESPROC s_mapBuffer;
+	static PFNGLUNMAPBUFFEROESPROC s_unmapBuffer;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief the GL_OES_vertex_array_object entry points, GLStateCache has the bind one
+	//----------------------------------------------------------------------------------------------------------------------
+	static PFNGLGENVERTEXARRAYSOESPROC s_genVertexArrays;
+	static PFNGLDELETEVERTEXARRAYSOESPROC s_deleteVertexArrays;
+	//----------------------------------------------------------------------------------------------------------------------
+	/// @brief without the extension, the VAO and buffer whose attributes are set
+	//----------------------------------------------------------------------------------------------------------------------
+	static const VertexArrayObject *s_layoutOwner;
+	static unsigned int s_layoutBuffer;
+	//----------------------------------------------------------------------------------------------------------------------
 	/// @brief hide the ctor as we want to create static factory only
 	//----------------------------------------------------------------------------------------------------------------------
 	VertexArrayObject(GLenum _mode);
@@ -0,0 +1,90 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef VERTEXQUANTISER_H__
+#define VERTEXQUANTISER_H__
+//----------------------------------------------------------------------------------------------------------------------
+/// @file VertexQuantiser.h
+/// @brief the compressed 16 byte vertex format and the functions to convert the float u,v,nx,ny,nz,x,y,z
+/// vertex data used by the meshes and primitives to it
+//----------------------------------------------------------------------------------------------------------------------
+// must include types.h first for ngl::Real and GLEW if required
+#include "Types.h"
+#include <vector>
+#include "Mat4.h"
+#include "Vec4.h"
+#include "VertexArrayObject.h"
+
+namespace ngl
+{
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the vertex layouts createVAO can upload
+/// VERTEX_FLOAT is the 32 byte u,v,nx,ny,nz,x,y,z float format
+/// VERTEX_QUANTISED is the 16 byte QuantisedVertData format
+//----------------------------------------------------------------------------------------------------------------------
+enum VERTEXFORMAT{VERTEX_FLOAT=0,VERTEX_QUANTISED=1};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a compressed vertex, the position is a normalised short relative to the bounds of the mesh, the
+/// normal a normalised byte and the uv a normalised unsigned short. The w values are padding so each
+/// attribute starts on a 4 byte boundary (VertexAttribute offsets are in floats)
+//----------------------------------------------------------------------------------------------------------------------
+struct QuantisedVertData
+{
+  GLshort x;
+  GLshort y;
+  GLshort z;
+  GLshort w;
+  GLbyte nx;
+  GLbyte ny;
+  GLbyte nz;
+  GLbyte nw;
+  GLushort u;
+  GLushort v;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief quantise interleaved float vertex data. The positions are scaled by the same amount on each axis so
+/// the dequantise matrix is a uniform scale and translate, this means it can be folded into the model matrix
+/// without changing the normal matrix. The GL will give the shader positions in the range -1 to 1 so use
+/// dequantise*model as the model matrix.
+/// UVs in the range 0-1 are stored directly, else they are stored relative to their bounds and the shader
+/// must use uv*o_uvTransform.xy+o_uvTransform.zw
+/// @param[in] _data the vertex data as u,v,nx,ny,nz,x,y,z floats
+/// @param[in] _numVerts the number of vertices in _data
+/// @param[out] o_data the quantised vertices
+/// @param[out] o_uvTransform if not null set to the uv scale (x,y) and offset (z,w)
+/// @returns the dequantise matrix
+//----------------------------------------------------------------------------------------------------------------------
+extern Mat4 quantiseVertData(
+                             const GLfloat *_data,
+                             size_t _numVerts,
+                             std::vector<QuantisedVertData> &o_data,
+                             Vec4 *o_uvTransform=0
+                            );
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief set the vertex attributes for a VAO holding QuantisedVertData, the attributes are the same as
+/// the float format (0 position, 1 uv, 2 normal)
+/// @param[in] _vao the bound VAO to set the attributes for
+//----------------------------------------------------------------------------------------------------------------------
+extern void setQuantisedVertDataAttributes(
+                                           VertexArrayObject *_vao
+                                          );
+
+} // end ngl namespace
+
+#endif
+//----------------------------------------------------------------------------------------------------------------------
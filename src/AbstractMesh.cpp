@@ -15,9 +15,19 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
 #include <list>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
 #include "AbstractMesh.h"
+#include "NCCABinaryMesh.h"
 #include "Util.h"
+#include "ParallelFor.h"
+#include "MeshOptimiser.h"
+#include "VertexQuantiser.h"
+#include "MeshSimplifier.h"
+#include "Camera.h"
 //----------------------------------------------------------------------------------------------------------------------
 /// @file AbstractMesh.cpp
 /// @brief a series of classes used to define an abstract 3D mesh of Faces, Vertex Normals and TexCords
@@ -55,6 +65,43 @@ void AbstractMesh::scale(
 
 
 
+//----------------------------------------------------------------------------------------------------------------------
+AbstractMesh::AbstractMesh()
+{
+  m_nVerts=m_nNorm=m_nTex=m_nFaces=0;
+  m_indexSize=m_meshSize=0;
+  m_vaoMesh=0;
+  m_vbo=false;
+  m_vao=false;
+  m_vaoIndexed=false;
+  m_vboMapped=false;
+  m_texture=false;
+  m_textureID=0;
+  m_maxX=m_maxY=m_maxZ=0.0;
+  m_minX=m_minY=m_minZ=0.0;
+  m_ext=0;
+  m_dataPackType=0;
+  m_bufferPackSize=0;
+  m_vboDrawType=GL_STATIC_DRAW;
+  m_loaded=false;
+  m_sphereRadius=0.0;
+  m_optimiseIndices=true;
+  m_optimiseOverdraw=true;
+  memset(&m_cacheStatsBefore,0,sizeof(VertexCacheStats));
+  memset(&m_cacheStatsAfter,0,sizeof(VertexCacheStats));
+  m_vertexFormat=VERTEX_FLOAT;
+  m_uvTransform.set(1.0f,1.0f,0.0f,0.0f);
+  m_lodLevels=0;
+  m_lodRatio=0.5f;
+  m_lod=0;
+  m_vaoPrepared=false;
+  m_vaoPreparedIndexed=false;
+  m_generateNormals=true;
+  m_normalWeight=NORMAL_ANGLE;
+  m_creaseAngle=180.0f;
+  m_generateTangents=false;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 AbstractMesh::~AbstractMesh()
 {
@@ -63,13 +110,16 @@ AbstractMesh::~AbstractMesh()
     m_verts.erase(m_verts.begin(),m_verts.end());
     m_norm.erase(m_norm.begin(),m_norm.end());
     m_tex.erase(m_tex.begin(),m_tex.end());
-    m_face.erase(m_face.begin(),m_face.end());
+    m_faceOffset.clear();
+    m_faceVert.clear();
+    m_faceNorm.clear();
+    m_faceTex.clear();
     m_indices.erase(m_indices.begin(),m_indices.end());
     m_outIndices.erase(m_outIndices.begin(),m_outIndices.end());
 
     if(m_vbo)
     {
-      glDeleteBuffers(1,&m_vboBuffers);
+      GLStateCache::instance()->deleteBuffers(1,&m_vboBuffers);
       if(m_vaoMesh!=0)
       {
         //delete m_vaoMesh;
@@ -101,7 +151,7 @@ bool AbstractMesh::isTriangular()
 {
  for(unsigned int i=0; i<m_nFaces; ++i)
 	{
-		if (m_face[i].m_numVerts >3)
+		if (getFaceNumVerts(i) >3)
 		{
 			return false;
 		}
@@ -110,8 +160,98 @@ bool AbstractMesh::isTriangular()
 }
 
 
-// Code from Rob Bateman (www.robthebloke.org)
-// checks if v/n/t exist as a combination in the indices array. If it does, re-use that
+const unsigned IndexRef::NOINDEX;
+
+//----------------------------------------------------------------------------------------------------------------------
+// marks an unused slot in the weld table
+static const GLuint s_emptySlot=0xffffffff;
+
+//----------------------------------------------------------------------------------------------------------------------
+IndexRefTable::IndexRefTable(
+                             size_t _expected
+                            )
+{
+  m_count=0;
+  // keep the table at most half full so the probe sequences stay short
+  size_t capacity=16;
+  while(capacity<_expected*2)
+  {
+    capacity<<=1;
+  }
+  m_slots.assign(capacity,s_emptySlot);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t IndexRefTable::hash(
+                           const IndexRef &_ref
+                          )
+{
+  // mix each of the indices with a different large prime then spread the bits with a multiply
+  uint32_t h=_ref.m_v*73856093u ^ _ref.m_n*19349663u ^ _ref.m_t*83492791u;
+  h^=h>>16;
+  h*=0x85ebca6bu;
+  h^=h>>13;
+  return h;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void IndexRefTable::rehash(
+                           size_t _capacity,
+                           const std::vector<IndexRef> &_indices
+                          )
+{
+  m_slots.assign(_capacity,s_emptySlot);
+  size_t mask=_capacity-1;
+  for(size_t i=0; i<_indices.size(); ++i)
+  {
+    size_t slot=hash(_indices[i]) & mask;
+    while(m_slots[slot] != s_emptySlot)
+    {
+      slot=(slot+1) & mask;
+    }
+    m_slots[slot]=static_cast<GLuint>(i);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool IndexRefTable::insert(
+                           const IndexRef &_ref,
+                           std::vector<IndexRef> &io_indices,
+                           GLuint &o_index
+                          )
+{
+  if((m_count+1)*2 > m_slots.size())
+  {
+    rehash(m_slots.size()*2,io_indices);
+  }
+  size_t mask=m_slots.size()-1;
+  size_t slot=hash(_ref) & mask;
+  while(m_slots[slot] != s_emptySlot)
+  {
+    // if v/n/t already exist, re-use...
+    if(io_indices[m_slots[slot]] == _ref)
+    {
+      o_index=m_slots[slot];
+      return true;
+    }
+    slot=(slot+1) & mask;
+  }
+  o_index=static_cast<GLuint>(io_indices.size());
+  m_slots[slot]=o_index;
+  io_indices.push_back(_ref);
+  ++m_count;
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void IndexRefTable::clear()
+{
+  m_count=0;
+  m_slots.assign(16,s_emptySlot);
+}
+
+// Originally code from Rob Bateman (www.robthebloke.org) which searched the whole list
+// now uses a hash table. checks if v/n/t exist as a combination in the indices array. If it does, re-use that
 // index and insert into the out_indices array. If the v/n/t combo has not been used before,
 // generate a new vertex index....
 //
@@ -120,27 +260,1021 @@ bool AbstractMesh::addIndex(
                             const unsigned _v,
                             const unsigned _n,
                             const unsigned _t,
+                            IndexRefTable &io_table,
                             std::vector<IndexRef>& io_indices,
                             std::vector<GLuint>& io_outIndices
+                           ) const
+{
+  GLuint index;
+  bool found=io_table.insert(IndexRef(_v,_n,_t),io_indices,index);
+  io_outIndices.push_back(index);
+  return found;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+IndexRef AbstractMesh::faceCorner(
+                                  unsigned long int _face,
+                                  unsigned int _corner
+                                 ) const
+{
+  GLuint c=m_faceOffset[_face]+_corner;
+  return IndexRef(m_faceVert[c],m_faceNorm[c],m_faceTex[c]);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+std::vector <Face> AbstractMesh::getFaceList() const
+{
+  std::vector <Face> faces(m_nFaces);
+  for(unsigned long int i=0; i<m_nFaces; ++i)
+  {
+    Face &f=faces[i];
+    f.m_numVerts=getFaceNumVerts(i);
+    f.m_textureCoord=false;
+    for(GLuint c=m_faceOffset[i]; c<m_faceOffset[i+1]; ++c)
+    {
+      f.m_vert.push_back(m_faceVert[c]);
+      if(m_faceNorm[c] != IndexRef::NOINDEX)
+      {
+        f.m_norm.push_back(m_faceNorm[c]);
+      }
+      if(m_faceTex[c] != IndexRef::NOINDEX)
+      {
+        f.m_tex.push_back(m_faceTex[c]);
+        f.m_textureCoord=true;
+      }
+    }
+  }
+  return faces;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the 2D cross product of (_b-_a) and (_c-_b), positive if the corner at _b turns left
+static inline Real turn(
+                        Real _ax, Real _ay,
+                        Real _bx, Real _by,
+                        Real _cx, Real _cy
+                       )
+{
+  return (_bx-_ax)*(_cy-_by)-(_by-_ay)*(_cx-_bx);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// is the point _p inside (or on the edge of) the counter clockwise triangle _a _b _c
+static inline bool pointInTriangle(
+                                   Real _px, Real _py,
+                                   Real _ax, Real _ay,
+                                   Real _bx, Real _by,
+                                   Real _cx, Real _cy
+                                  )
+{
+  return turn(_ax,_ay,_bx,_by,_px,_py) >= 0 &&
+         turn(_bx,_by,_cx,_cy,_px,_py) >= 0 &&
+         turn(_cx,_cy,_ax,_ay,_px,_py) >= 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::triangulate(
+                               unsigned int _numThreads
+                              )
+{
+  m_faceTriStart.clear();
+  m_triangles.clear();
+  m_drawTriangleOrder.clear();
+  triangulateRange(0,_numThreads);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::triangulateRange(
+                                    unsigned long int _firstFace,
+                                    unsigned int _numThreads
+                                   )
+{
+  // a face of n verts gives n-2 triangles so we can work out where each face goes first
+  // then each thread can write its faces without any locking
+  m_faceTriStart.resize(m_nFaces+1);
+  GLuint numTris=m_faceTriStart[_firstFace];
+  for(unsigned long int i=_firstFace; i<m_nFaces; ++i)
+  {
+    m_faceTriStart[i]=numTris;
+    unsigned int n=getFaceNumVerts(i);
+    numTris+= n>=3 ? n-2 : 0;
+  }
+  m_faceTriStart[m_nFaces]=numTris;
+  m_triangles.resize(numTris*3,IndexRef(0,IndexRef::NOINDEX,IndexRef::NOINDEX));
+  parallelFor(_firstFace,m_nFaces,boost::bind(&AbstractMesh::triangulateFaces,this,_1,_2),_numThreads,256);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::triangulateFaces(
+                                    size_t _begin,
+                                    size_t _end
+                                   )
+{
+  // scratch space re-used for each concave face in this block
+  std::vector<Real> x;
+  std::vector<Real> y;
+  std::vector<unsigned int> remaining;
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    const GLuint *vert=&m_faceVert[0]+m_faceOffset[i];
+    unsigned int n=getFaceNumVerts(i);
+    IndexRef *out=&m_triangles[0]+m_faceTriStart[i]*3;
+    if(n<3)
+    {
+      continue;
+    }
+    // a face using a vertex we don't have (a bad index or one not yet streamed in) can't be
+    // projected so it is just fanned
+    bool fan= n==3;
+    for(unsigned int j=0; j<n && fan==false; ++j)
+    {
+      fan= vert[j] >= m_verts.size();
+    }
+    if(fan)
+    {
+      for(unsigned int j=1; j<n-1; ++j)
+      {
+        *out++=faceCorner(i,0); *out++=faceCorner(i,j); *out++=faceCorner(i,j+1);
+      }
+      continue;
+    }
+    // get the face normal using Newell's method then drop the largest axis to give a 2D polygon
+    Vec3 normal(0,0,0);
+    for(unsigned int j=0; j<n; ++j)
+    {
+      const Vec3 &c=m_verts[vert[j]];
+      const Vec3 &nx=m_verts[vert[(j+1)%n]];
+      normal.m_x+=(c.m_y-nx.m_y)*(c.m_z+nx.m_z);
+      normal.m_y+=(c.m_z-nx.m_z)*(c.m_x+nx.m_x);
+      normal.m_z+=(c.m_x-nx.m_x)*(c.m_y+nx.m_y);
+    }
+    Real ax=fabs(normal.m_x);
+    Real ay=fabs(normal.m_y);
+    Real az=fabs(normal.m_z);
+    x.resize(n);
+    y.resize(n);
+    for(unsigned int j=0; j<n; ++j)
+    {
+      const Vec3 &c=m_verts[vert[j]];
+      // swap the axes when the normal is negative so the polygon is always counter clockwise
+      if(az>=ax && az>=ay)
+      {
+        x[j]= normal.m_z>=0 ? c.m_x : c.m_y; y[j]= normal.m_z>=0 ? c.m_y : c.m_x;
+      }
+      else if(ax>=ay)
+      {
+        x[j]= normal.m_x>=0 ? c.m_y : c.m_z; y[j]= normal.m_x>=0 ? c.m_z : c.m_y;
+      }
+      else
+      {
+        x[j]= normal.m_y>=0 ? c.m_z : c.m_x; y[j]= normal.m_y>=0 ? c.m_x : c.m_z;
+      }
+    }
+    bool convex=true;
+    for(unsigned int j=0; j<n && convex; ++j)
+    {
+      unsigned int p=(j+n-1)%n;
+      unsigned int nx=(j+1)%n;
+      convex=turn(x[p],y[p],x[j],y[j],x[nx],y[nx]) >= 0;
+    }
+    if(convex)
+    {
+      // fan from the first corner
+      for(unsigned int j=1; j<n-1; ++j)
+      {
+        *out++=faceCorner(i,0); *out++=faceCorner(i,j); *out++=faceCorner(i,j+1);
+      }
+      continue;
+    }
+    // ear clipping, remove a convex corner which has no other corner inside its triangle until
+    // only one triangle is left
+    remaining.resize(n);
+    for(unsigned int j=0; j<n; ++j)
+    {
+      remaining[j]=j;
+    }
+    unsigned int j=0;
+    unsigned int tested=0;
+    while(remaining.size()>3)
+    {
+      unsigned int m=remaining.size();
+      unsigned int p=remaining[(j+m-1)%m];
+      unsigned int c=remaining[j];
+      unsigned int nx=remaining[(j+1)%m];
+      bool ear=turn(x[p],y[p],x[c],y[c],x[nx],y[nx]) > 0;
+      for(unsigned int k=0; k<m && ear; ++k)
+      {
+        unsigned int r=remaining[k];
+        if(r!=p && r!=c && r!=nx)
+        {
+          ear=!pointInTriangle(x[r],y[r],x[p],y[p],x[c],y[c],x[nx],y[nx]);
+        }
+      }
+      // if no ear is found the face is degenerate or self intersecting so just clip the corner
+      // anyway, this still gives n-2 triangles
+      if(ear || tested>=m)
+      {
+        *out++=faceCorner(i,p); *out++=faceCorner(i,c); *out++=faceCorner(i,nx);
+        remaining.erase(remaining.begin()+j);
+        j= j>0 ? j-1 : 0;
+        tested=0;
+      }
+      else
+      {
+        j=(j+1)%m;
+        ++tested;
+      }
+    }
+    *out++=faceCorner(i,remaining[0]); *out++=faceCorner(i,remaining[1]); *out++=faceCorner(i,remaining[2]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::calcNormals(
+                               NORMALWEIGHT _weight,
+                               Real _creaseAngle,
+                               unsigned int _numThreads
+                              )
+{
+  m_normalWeight=_weight;
+  m_creaseAngle=_creaseAngle;
+  size_t numCorners=m_faceVert.size();
+  size_t numVerts=m_verts.size();
+  // the face of each corner and the corners of each vertex (a counting sort of the corners by vertex)
+  m_cornerFace.resize(numCorners);
+  for(unsigned long int f=0; f<m_nFaces; ++f)
+  {
+    std::fill(m_cornerFace.begin()+m_faceOffset[f],m_cornerFace.begin()+m_faceOffset[f+1],GLuint(f));
+  }
+  m_vertCornerStart.assign(numVerts+1,0);
+  for(size_t c=0; c<numCorners; ++c)
+  {
+    if(m_faceVert[c] < numVerts)
+    {
+      ++m_vertCornerStart[m_faceVert[c]+1];
+    }
+  }
+  for(size_t v=0; v<numVerts; ++v)
+  {
+    m_vertCornerStart[v+1]+=m_vertCornerStart[v];
+  }
+  m_vertCorners.resize(m_vertCornerStart[numVerts]);
+  std::vector<GLuint> fill(m_vertCornerStart.begin(),m_vertCornerStart.end()-1);
+  for(size_t c=0; c<numCorners; ++c)
+  {
+    if(m_faceVert[c] < numVerts)
+    {
+      m_vertCorners[fill[m_faceVert[c]]++]=c;
+    }
+  }
+  m_faceNormals.resize(m_nFaces);
+  m_cornerNormalWeights.resize(numCorners);
+  parallelFor(0,m_nFaces,boost::bind(&AbstractMesh::calcFaceNormals,this,_1,_2,(const GLuint *)0),_numThreads,256);
+  std::vector<Vec3> cornerNormals(numCorners,Vec3(0.0f,0.0f,0.0f));
+  parallelFor(0,numVerts,boost::bind(&AbstractMesh::calcVertexNormals,this,_1,_2,(const GLuint *)0,&cornerNormals),_numThreads,256);
+  m_faceNorm.resize(numCorners);
+  m_norm.clear();
+  if(_creaseAngle >= 180.0f)
+  {
+    // every corner of a vertex has the same normal so the normals line up with the vertices
+    m_norm.resize(numVerts,Vec3(0.0f,0.0f,0.0f));
+    for(size_t v=0; v<numVerts; ++v)
+    {
+      if(m_vertCornerStart[v] != m_vertCornerStart[v+1])
+      {
+        m_norm[v]=cornerNormals[m_vertCorners[m_vertCornerStart[v]]];
+      }
+    }
+    for(size_t c=0; c<numCorners; ++c)
+    {
+      m_faceNorm[c]= m_faceVert[c] < numVerts ? m_faceVert[c] : IndexRef::NOINDEX;
+    }
+  }
+  else
+  {
+    // corners which smoothed with the same faces get exactly the same sum so share a normal
+    m_norm.reserve(numVerts);
+    std::fill(m_faceNorm.begin(),m_faceNorm.end(),IndexRef::NOINDEX);
+    for(size_t v=0; v<numVerts; ++v)
+    {
+      size_t first=m_norm.size();
+      for(GLuint i=m_vertCornerStart[v]; i<m_vertCornerStart[v+1]; ++i)
+      {
+        GLuint c=m_vertCorners[i];
+        size_t n=first;
+        while(n<m_norm.size() && m_norm[n] != cornerNormals[c])
+        {
+          ++n;
+        }
+        if(n == m_norm.size())
+        {
+          m_norm.push_back(cornerNormals[c]);
+        }
+        m_faceNorm[c]=n;
+      }
+    }
+  }
+  m_nNorm=m_norm.size();
+  // the triangles and welded vertices hold the old normal indices
+  m_triangles.clear();
+  m_faceTriStart.clear();
+  m_indices.clear();
+  m_outIndices.clear();
+  m_lodIndices.clear();
+  m_drawTriangleOrder.clear();
+  m_vaoPrepared=false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::updateNormals(
+                                 const std::vector<GLuint> &_changedVerts,
+                                 std::vector<GLuint> *o_changedNormals,
+                                 unsigned int _numThreads
+                                )
+{
+  if(m_cornerFace.size() != m_faceVert.size() || m_vertCornerStart.size() != m_verts.size()+1)
+  {
+    calcNormals(m_normalWeight,m_creaseAngle,_numThreads);
+    if(o_changedNormals !=0)
+    {
+      o_changedNormals->resize(m_norm.size());
+      for(size_t i=0; i<m_norm.size(); ++i)
+      {
+        (*o_changedNormals)[i]=i;
+      }
+    }
+    return;
+  }
+  // the faces using the moved vertices change shape
+  std::vector<GLuint> faces;
+  for(size_t i=0; i<_changedVerts.size(); ++i)
+  {
+    GLuint v=_changedVerts[i];
+    for(GLuint c=m_vertCornerStart[v]; c<m_vertCornerStart[v+1]; ++c)
+    {
+      faces.push_back(m_cornerFace[m_vertCorners[c]]);
+    }
+  }
+  std::sort(faces.begin(),faces.end());
+  faces.erase(std::unique(faces.begin(),faces.end()),faces.end());
+  // and every vertex of those faces needs its normal redone
+  std::vector<GLuint> verts;
+  for(size_t i=0; i<faces.size(); ++i)
+  {
+    for(GLuint c=m_faceOffset[faces[i]]; c<m_faceOffset[faces[i]+1]; ++c)
+    {
+      if(m_faceVert[c] < m_verts.size())
+      {
+        verts.push_back(m_faceVert[c]);
+      }
+    }
+  }
+  std::sort(verts.begin(),verts.end());
+  verts.erase(std::unique(verts.begin(),verts.end()),verts.end());
+  if(faces.size() !=0)
+  {
+    parallelFor(0,faces.size(),boost::bind(&AbstractMesh::calcFaceNormals,this,_1,_2,&faces[0]),_numThreads,256);
+  }
+  if(verts.size() !=0)
+  {
+    parallelFor(0,verts.size(),boost::bind(&AbstractMesh::calcVertexNormals,this,_1,_2,&verts[0],(std::vector<Vec3> *)0),_numThreads,256);
+  }
+  if(o_changedNormals !=0)
+  {
+    o_changedNormals->clear();
+    for(size_t i=0; i<verts.size(); ++i)
+    {
+      for(GLuint c=m_vertCornerStart[verts[i]]; c<m_vertCornerStart[verts[i]+1]; ++c)
+      {
+        o_changedNormals->push_back(m_faceNorm[m_vertCorners[c]]);
+      }
+    }
+    std::sort(o_changedNormals->begin(),o_changedNormals->end());
+    o_changedNormals->erase(std::unique(o_changedNormals->begin(),o_changedNormals->end()),o_changedNormals->end());
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::calcFaceNormals(
+                                   size_t _begin,
+                                   size_t _end,
+                                   const GLuint *_faces
+                                  )
+{
+  size_t numVerts=m_verts.size();
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    size_t f= _faces !=0 ? _faces[i] : i;
+    GLuint first=m_faceOffset[f];
+    unsigned int n=getFaceNumVerts(f);
+    const GLuint *vert=&m_faceVert[0]+first;
+    Vec3 *weight=&m_cornerNormalWeights[0]+first;
+    bool valid= n>=3;
+    for(unsigned int j=0; j<n && valid==true; ++j)
+    {
+      valid= vert[j] < numVerts;
+    }
+    if(valid == false)
+    {
+      m_faceNormals[f].set(0.0f,0.0f,0.0f);
+      std::fill(weight,weight+n,Vec3(0.0f,0.0f,0.0f));
+      continue;
+    }
+    // Newell's method gives twice the area along the normal and works for any planar polygon
+    Real x=0.0f,y=0.0f,z=0.0f;
+    for(unsigned int j=0; j<n; ++j)
+    {
+      const Vec3 &c=m_verts[vert[j]];
+      const Vec3 &nx=m_verts[vert[(j+1)%n]];
+      x+=(c.m_y-nx.m_y)*(c.m_z+nx.m_z);
+      y+=(c.m_z-nx.m_z)*(c.m_x+nx.m_x);
+      z+=(c.m_x-nx.m_x)*(c.m_y+nx.m_y);
+    }
+    Real len=sqrt(x*x+y*y+z*z);
+    if(len == 0.0f)
+    {
+      m_faceNormals[f].set(0.0f,0.0f,0.0f);
+      std::fill(weight,weight+n,Vec3(0.0f,0.0f,0.0f));
+      continue;
+    }
+    m_faceNormals[f].set(x/len,y/len,z/len);
+    for(unsigned int j=0; j<n; ++j)
+    {
+      Real w=0.5f*len;
+      if(m_normalWeight == NORMAL_ANGLE)
+      {
+        const Vec3 &c=m_verts[vert[j]];
+        const Vec3 &prev=m_verts[vert[(j+n-1)%n]];
+        const Vec3 &nx=m_verts[vert[(j+1)%n]];
+        Real ax=prev.m_x-c.m_x, ay=prev.m_y-c.m_y, az=prev.m_z-c.m_z;
+        Real bx=nx.m_x-c.m_x, by=nx.m_y-c.m_y, bz=nx.m_z-c.m_z;
+        Real cx=ay*bz-az*by, cy=az*bx-ax*bz, cz=ax*by-ay*bx;
+        // atan2 of |a x b| and a.b is accurate for small and near 180 degree corners
+        w=atan2(sqrt(cx*cx+cy*cy+cz*cz),ax*bx+ay*by+az*bz);
+      }
+      weight[j].set(m_faceNormals[f].m_x*w,m_faceNormals[f].m_y*w,m_faceNormals[f].m_z*w);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::calcVertexNormals(
+                                     size_t _begin,
+                                     size_t _end,
+                                     const GLuint *_verts,
+                                     std::vector<Vec3> *o_cornerNormals
+                                    )
+{
+  bool smooth= m_creaseAngle >= 180.0f;
+  Real cosCrease=cos(radians(m_creaseAngle));
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    size_t v= _verts !=0 ? _verts[i] : i;
+    const GLuint *corners=&m_vertCorners[0]+m_vertCornerStart[v];
+    GLuint numCorners=m_vertCornerStart[v+1]-m_vertCornerStart[v];
+    for(GLuint j=0; j<numCorners; ++j)
+    {
+      // all the corners of a smooth vertex are the same so only the first is summed
+      Real x=0.0f,y=0.0f,z=0.0f;
+      if(smooth == false || j == 0)
+      {
+        const Vec3 &faceNormal=m_faceNormals[m_cornerFace[corners[j]]];
+        for(GLuint k=0; k<numCorners; ++k)
+        {
+          const Vec3 &other=m_faceNormals[m_cornerFace[corners[k]]];
+          if(smooth == true || k == j ||
+             faceNormal.m_x*other.m_x+faceNormal.m_y*other.m_y+faceNormal.m_z*other.m_z >= cosCrease)
+          {
+            const Vec3 &w=m_cornerNormalWeights[corners[k]];
+            x+=w.m_x; y+=w.m_y; z+=w.m_z;
+          }
+        }
+        Real len=sqrt(x*x+y*y+z*z);
+        if(len != 0.0f)
+        {
+          x/=len; y/=len; z/=len;
+        }
+        else
+        {
+          // opposing faces cancel out so fall back to the face normal
+          x=faceNormal.m_x; y=faceNormal.m_y; z=faceNormal.m_z;
+        }
+      }
+      else
+      {
+        const Vec3 &n= o_cornerNormals !=0 ? (*o_cornerNormals)[corners[0]] : m_norm[m_faceNorm[corners[0]]];
+        x=n.m_x; y=n.m_y; z=n.m_z;
+      }
+      if(o_cornerNormals !=0)
+      {
+        (*o_cornerNormals)[corners[j]].set(x,y,z);
+      }
+      else if(m_faceNorm[corners[j]] != IndexRef::NOINDEX)
+      {
+        m_norm[m_faceNorm[corners[j]]].set(x,y,z);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the shared data for the two parallel passes of calcTangents
+//----------------------------------------------------------------------------------------------------------------------
+struct TangentPass
+{
+  const std::vector<Vec3> *m_verts;
+  const std::vector<Vec3> *m_norm;
+  const std::vector<Vec3> *m_tex;
+  const IndexRef *m_refs;
+  const GLuint *m_tris;
+  // the corners of each vertex, vertex i has m_vertCorners[m_vertStart[i] .. m_vertStart[i+1]-1]
+  std::vector<GLuint> m_vertStart;
+  std::vector<GLuint> m_vertCorners;
+  // the weighted tangent and sign of each triangle corner
+  std::vector<Vec3> m_cornerTangent;
+  std::vector<Real> m_cornerSign;
+  std::vector<Vec3> m_cornerNormal;
+  Vec4 *m_out;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// the per triangle pass of calcTangents
+static void tangentTriangles(
+                             TangentPass *_pass,
+                             size_t _begin,
+                             size_t _end
+                            )
+{
+  const std::vector<Vec3> &verts=*_pass->m_verts;
+  const std::vector<Vec3> &norm=*_pass->m_norm;
+  const std::vector<Vec3> &tex=*_pass->m_tex;
+  for(size_t t=_begin; t<_end; ++t)
+  {
+    const IndexRef *r[3]={&_pass->m_refs[_pass->m_tris[t*3]],&_pass->m_refs[_pass->m_tris[t*3+1]],&_pass->m_refs[_pass->m_tris[t*3+2]]};
+    bool valid=true;
+    for(int k=0; k<3; ++k)
+    {
+      _pass->m_cornerTangent[t*3+k].set(0.0f,0.0f,0.0f);
+      _pass->m_cornerSign[t*3+k]=0.0f;
+      _pass->m_cornerNormal[t*3+k].set(0.0f,0.0f,0.0f);
+      valid=valid && r[k]->m_v < verts.size() && r[k]->m_t != IndexRef::NOINDEX && r[k]->m_t < tex.size();
+    }
+    if(valid == false)
+    {
+      continue;
+    }
+    const Vec3 &p0=verts[r[0]->m_v];
+    const Vec3 &p1=verts[r[1]->m_v];
+    const Vec3 &p2=verts[r[2]->m_v];
+    Real e1x=p1.m_x-p0.m_x, e1y=p1.m_y-p0.m_y, e1z=p1.m_z-p0.m_z;
+    Real e2x=p2.m_x-p0.m_x, e2y=p2.m_y-p0.m_y, e2z=p2.m_z-p0.m_z;
+    Real du1=tex[r[1]->m_t].m_x-tex[r[0]->m_t].m_x, dv1=tex[r[1]->m_t].m_y-tex[r[0]->m_t].m_y;
+    Real du2=tex[r[2]->m_t].m_x-tex[r[0]->m_t].m_x, dv2=tex[r[2]->m_t].m_y-tex[r[0]->m_t].m_y;
+    Real det=du1*dv2-du2*dv1;
+    if(fabs(det) < 1e-12f)
+    {
+      // no uv area so no tangent direction
+      continue;
+    }
+    // the directions of increasing u (tangent) and v (bitangent) across the triangle
+    Real tx=(e1x*dv2-e2x*dv1)/det, ty=(e1y*dv2-e2y*dv1)/det, tz=(e1z*dv2-e2z*dv1)/det;
+    Real bx=(e2x*du1-e1x*du2)/det, by=(e2y*du1-e1y*du2)/det, bz=(e2z*du1-e1z*du2)/det;
+    Real fx=e1y*e2z-e1z*e2y, fy=e1z*e2x-e1x*e2z, fz=e1x*e2y-e1y*e2x;
+    for(int k=0; k<3; ++k)
+    {
+      // the vertex normal or the face normal if there isn't one
+      Real nx=fx, ny=fy, nz=fz;
+      if(r[k]->m_n != IndexRef::NOINDEX && r[k]->m_n < norm.size())
+      {
+        nx=norm[r[k]->m_n].m_x; ny=norm[r[k]->m_n].m_y; nz=norm[r[k]->m_n].m_z;
+      }
+      Real len=sqrt(nx*nx+ny*ny+nz*nz);
+      if(len == 0.0f)
+      {
+        continue;
+      }
+      nx/=len; ny/=len; nz/=len;
+      Real d=nx*tx+ny*ty+nz*tz;
+      Real px=tx-nx*d, py=ty-ny*d, pz=tz-nz*d;
+      len=sqrt(px*px+py*py+pz*pz);
+      if(len == 0.0f)
+      {
+        continue;
+      }
+      // weight by the angle of the corner so splitting a face doesn't change the result
+      const Vec3 &c=verts[r[k]->m_v];
+      const Vec3 &a=verts[r[(k+1)%3]->m_v];
+      const Vec3 &b=verts[r[(k+2)%3]->m_v];
+      Real ax=a.m_x-c.m_x, ay=a.m_y-c.m_y, az=a.m_z-c.m_z;
+      Real cx=b.m_x-c.m_x, cy=b.m_y-c.m_y, cz=b.m_z-c.m_z;
+      Real sx=ay*cz-az*cy, sy=az*cx-ax*cz, sz=ax*cy-ay*cx;
+      Real angle=atan2(sqrt(sx*sx+sy*sy+sz*sz),ax*cx+ay*cy+az*cz);
+      _pass->m_cornerTangent[t*3+k].set(px/len*angle,py/len*angle,pz/len*angle);
+      _pass->m_cornerNormal[t*3+k].set(nx,ny,nz);
+      // the bitangent sign is which side of n x t the v direction is
+      Real side=(ny*pz-nz*py)*bx+(nz*px-nx*pz)*by+(nx*py-ny*px)*bz;
+      _pass->m_cornerSign[t*3+k]= side < 0.0f ? -angle : angle;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the per vertex pass of calcTangents
+static void tangentVertices(
+                            TangentPass *_pass,
+                            size_t _begin,
+                            size_t _end
                            )
 {
-	size_t size=io_indices.size();
+  for(size_t v=_begin; v<_end; ++v)
+  {
+    Real tx=0.0f,ty=0.0f,tz=0.0f,sign=0.0f;
+    Real nx=0.0f,ny=0.0f,nz=1.0f;
+    for(GLuint i=_pass->m_vertStart[v]; i<_pass->m_vertStart[v+1]; ++i)
+    {
+      GLuint c=_pass->m_vertCorners[i];
+      const Vec3 &t=_pass->m_cornerTangent[c];
+      tx+=t.m_x; ty+=t.m_y; tz+=t.m_z;
+      sign+=_pass->m_cornerSign[c];
+      if(_pass->m_cornerSign[c] != 0.0f)
+      {
+        const Vec3 &n=_pass->m_cornerNormal[c];
+        nx=n.m_x; ny=n.m_y; nz=n.m_z;
+      }
+    }
+    // make sure the sum is still at right angles to the normal
+    Real d=nx*tx+ny*ty+nz*tz;
+    tx-=nx*d; ty-=ny*d; tz-=nz*d;
+    Real len=sqrt(tx*tx+ty*ty+tz*tz);
+    if(len == 0.0f)
+    {
+      // no uvs (or they cancel) so any tangent at right angles to the normal will do
+      if(fabs(nx) < 0.9f)
+      {
+        tx=0.0f; ty=-nz; tz=ny;
+      }
+      else
+      {
+        tx=nz; ty=0.0f; tz=-nx;
+      }
+      len=sqrt(tx*tx+ty*ty+tz*tz);
+    }
+    _pass->m_out[v].set(tx/len,ty/len,tz/len,sign < 0.0f ? -1.0f : 1.0f);
+  }
+}
 
-	for(size_t i=0;i<size;++i)
-	{
-		// if v/n/t already exist, re-use...
-		if(io_indices[i].m_v == _v && io_indices[i].m_n == _n && io_indices[i].m_t == _t)
-		{
-			io_outIndices.push_back((GLuint)i);
-			return true;
-		}
-	}
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::calcTangents(
+                                bool _indexed,
+                                unsigned int _numThreads
+                               )
+{
+  if(m_faceTriStart.size() != m_nFaces+1)
+  {
+    triangulate(_numThreads);
+  }
+  // the tangents are summed over the welded vertices, for the non indexed layout we weld a copy
+  // and expand the result back out to the triangle corners
+  std::vector<IndexRef> uniqueRefs;
+  std::vector<GLuint> tris;
+  if(_indexed == true && m_outIndices.size() == 0)
+  {
+    weldVertices();
+  }
+  if(_indexed == false)
+  {
+    IndexRefTable table(m_triangles.size()/6);
+    tris.reserve(m_triangles.size());
+    for(size_t i=0; i<m_triangles.size(); ++i)
+    {
+      const IndexRef &r=m_triangles[i];
+      addIndex(r.m_v,r.m_n,r.m_t,table,uniqueRefs,tris);
+    }
+  }
+  const std::vector<IndexRef> &refs= _indexed == true ? m_indices : uniqueRefs;
+  const std::vector<GLuint> &indices= _indexed == true ? m_outIndices : tris;
+  size_t numVerts=refs.size();
+  size_t numCorners=indices.size();
+  std::vector<Vec4> tangents(numVerts);
+  if(numVerts == 0 || numCorners == 0)
+  {
+    m_tangents.clear();
+    return;
+  }
+  TangentPass pass;
+  pass.m_verts=&m_verts;
+  pass.m_norm=&m_norm;
+  pass.m_tex=&m_tex;
+  pass.m_refs=&refs[0];
+  pass.m_tris=&indices[0];
+  pass.m_out=&tangents[0];
+  pass.m_cornerTangent.resize(numCorners);
+  pass.m_cornerSign.resize(numCorners);
+  pass.m_cornerNormal.resize(numCorners);
+  // the corners of each vertex as a counting sort
+  pass.m_vertStart.assign(numVerts+1,0);
+  for(size_t c=0; c<numCorners; ++c)
+  {
+    ++pass.m_vertStart[indices[c]+1];
+  }
+  for(size_t v=0; v<numVerts; ++v)
+  {
+    pass.m_vertStart[v+1]+=pass.m_vertStart[v];
+  }
+  pass.m_vertCorners.resize(numCorners);
+  std::vector<GLuint> fill(pass.m_vertStart.begin(),pass.m_vertStart.end()-1);
+  for(size_t c=0; c<numCorners; ++c)
+  {
+    pass.m_vertCorners[fill[indices[c]]++]=c;
+  }
+  parallelFor(0,numCorners/3,boost::bind(tangentTriangles,&pass,_1,_2),_numThreads,256);
+  parallelFor(0,numVerts,boost::bind(tangentVertices,&pass,_1,_2),_numThreads,256);
+  if(_indexed == true)
+  {
+    m_tangents.swap(tangents);
+  }
+  else
+  {
+    m_tangents.resize(numCorners);
+    for(size_t c=0; c<numCorners; ++c)
+    {
+      m_tangents[c]=tangents[tris[c]];
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned long int AbstractMesh::getTriangleFace(
+                                                unsigned long int _triangle
+                                               ) const
+{
+  // if the index buffer has been re-ordered find where the triangle came from
+  if(m_drawTriangleOrder.size() == m_triangles.size()/3 && _triangle < m_drawTriangleOrder.size())
+  {
+    _triangle=m_drawTriangleOrder[_triangle];
+  }
+  // the first face starting after the triangle is one past the face we want
+  std::vector<GLuint>::const_iterator it=std::upper_bound(m_faceTriStart.begin(),m_faceTriStart.end(),_triangle);
+  return (it-m_faceTriStart.begin())-1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::buildBVH()
+{
+  if(m_nFaces == 0 || m_verts.size() == 0)
+  {
+    // a binary mesh only has the BVH stored in the file
+    if(m_bvh.isBuilt() == false)
+    {
+      std::cerr<<"no mesh data to build a BVH from\n";
+    }
+    return;
+  }
+  if(m_faceTriStart.size() != m_nFaces+1)
+  {
+    triangulate();
+  }
+  std::vector<Vec3> corners;
+  std::vector<GLuint> faces;
+  corners.reserve(m_triangles.size());
+  faces.reserve(m_triangles.size()/3);
+  size_t numVerts=m_verts.size();
+  for(unsigned long int f=0; f<m_nFaces; ++f)
+  {
+    for(GLuint t=m_faceTriStart[f]; t<m_faceTriStart[f+1]; ++t)
+    {
+      // triangles with a bad index or a vertex not streamed in yet are left out so can't be picked
+      const IndexRef *tri=&m_triangles[t*3];
+      if(tri[0].m_v >= numVerts || tri[1].m_v >= numVerts || tri[2].m_v >= numVerts)
+      {
+        continue;
+      }
+      corners.push_back(m_verts[tri[0].m_v]);
+      corners.push_back(m_verts[tri[1].m_v]);
+      corners.push_back(m_verts[tri[2].m_v]);
+      faces.push_back(f);
+    }
+  }
+  m_bvh.build(corners,faces);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const MeshBVH &AbstractMesh::getBVH()
+{
+  if(m_bvh.isBuilt() == false)
+  {
+    buildBVH();
+  }
+  return m_bvh;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool AbstractMesh::intersectRay(
+                                const Vec3 &_origin,
+                                const Vec3 &_dir,
+                                BVHHit &o_hit,
+                                Real _maxT
+                               )
+{
+  return getBVH().intersectRay(_origin,_dir,o_hit,_maxT);
+}
 
-	io_outIndices.push_back( (GLuint) io_indices.size() );
-	io_indices.push_back(IndexRef(_v,_n,_t));
-	return false;
+//----------------------------------------------------------------------------------------------------------------------
+bool AbstractMesh::closestPoint(
+                                const Vec3 &_point,
+                                BVHHit &o_hit,
+                                Real _maxDistance
+                               )
+{
+  return getBVH().closestPoint(_point,o_hit,_maxDistance);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::sphereOverlap(
+                                 const Vec3 &_center,
+                                 Real _radius,
+                                 std::vector<GLuint> &o_faces
+                                )
+{
+  getBVH().sphereOverlap(_center,_radius,o_faces);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::weldVertices()
+{
+  if(m_faceTriStart.size() != m_nFaces+1)
+  {
+    triangulate();
+  }
+  m_drawTriangleOrder.clear();
+  m_lodIndices.clear();
+  weldTriangles(m_indices,m_outIndices);
+  m_indexSize=m_indices.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::weldTriangles(
+                                 std::vector<IndexRef> &o_indices,
+                                 std::vector<GLuint> &o_outIndices
+                                ) const
+{
+  o_indices.clear();
+  o_outIndices.clear();
+  o_outIndices.reserve(m_triangles.size());
+  // most closed meshes have about half as many unique vertices as triangles
+  IndexRefTable table(m_triangles.size()/6);
+  for(size_t i=0; i<m_triangles.size(); ++i)
+  {
+    const IndexRef &r=m_triangles[i];
+    addIndex(r.m_v,r.m_n,r.m_t,table,o_indices,o_outIndices);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::generateLODs(
+                                unsigned int _numLevels,
+                                Real _ratio
+                               )
+{
+  if(m_outIndices.size() == 0)
+  {
+    weldVertices();
+  }
+  if(m_sphereRadius == 0.0f)
+  {
+    // selectLOD needs the bounding sphere
+    calcBoundingSphere();
+  }
+  size_t numVerts=m_indices.size();
+  std::vector<Vec3> positions(numVerts,Vec3(0,0,0));
+  std::vector<GLuint> positionIds(numVerts);
+  for(size_t i=0; i<numVerts; ++i)
+  {
+    // the welded vertices with the same source vertex are the two sides of a seam
+    positionIds[i]=m_indices[i].m_v;
+    if(m_indices[i].m_v < m_verts.size())
+    {
+      positions[i]=m_verts[m_indices[i].m_v];
+    }
+  }
+  std::vector<size_t> targets(_numLevels);
+  Real target=m_outIndices.size()/3;
+  for(unsigned int l=0; l<_numLevels; ++l)
+  {
+    target*=_ratio;
+    targets[l]=size_t(target);
+  }
+  simplifyMesh(m_outIndices,positions,positionIds,targets,m_lodIndices);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int AbstractMesh::selectLOD(
+                                     const Camera &_cam,
+                                     const Mat4 &_transform,
+                                     Real _fullDetailSize
+                                    ) const
+{
+  if(m_lodCount.size() <= 1)
+  {
+    return 0;
+  }
+  Vec4 center=Vec4(m_sphereCenter.m_x,m_sphereCenter.m_y,m_sphereCenter.m_z,1.0f)*_transform;
+  // the radius grows with the largest scale in the transform
+  Real scale=std::max(Vec3(_transform.m_00,_transform.m_01,_transform.m_02).length(),
+             std::max(Vec3(_transform.m_10,_transform.m_11,_transform.m_12).length(),
+                      Vec3(_transform.m_20,_transform.m_21,_transform.m_22).length()));
+  Real size=_cam.getProjectedSphereSize(Vec3(center.m_x,center.m_y,center.m_z),m_sphereRadius*scale);
+  // keep about the same number of triangles per pixel, as the area covered falls with the square
+  // of the size so does the number of triangles we need
+  Real relative=size/_fullDetailSize;
+  Real wanted=m_lodCount[0]/3*relative*relative;
+  unsigned int lod=0;
+  while(lod+1 < m_lodCount.size() && m_lodCount[lod+1]/3 >= wanted)
+  {
+    ++lod;
+  }
+  return lod;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::optimiseIndices(
+                                   bool _overdraw
+                                  )
+{
+  if(m_outIndices.size() == 0)
+  {
+    weldVertices();
+  }
+  optimiseIndexLists(_overdraw,m_indices,m_outIndices,m_drawTriangleOrder,m_lodIndices,m_cacheStatsBefore,m_cacheStatsAfter);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::optimiseIndexLists(
+                                      bool _overdraw,
+                                      std::vector<IndexRef> &io_indices,
+                                      std::vector<GLuint> &io_outIndices,
+                                      std::vector<GLuint> &o_triangleOrder,
+                                      std::vector< std::vector<GLuint> > &io_lods,
+                                      VertexCacheStats &o_before,
+                                      VertexCacheStats &o_after
+                                     ) const
+{
+  size_t numVerts=io_indices.size();
+  o_before=analyseVertexCache(io_outIndices,numVerts);
+  // io_outIndices is still in m_triangles order at this point
+  std::vector<GLuint> order;
+  optimiseVertexCache(io_outIndices,numVerts,&order);
+  if(_overdraw == true)
+  {
+    std::vector<Vec3> positions(numVerts,Vec3(0,0,0));
+    for(size_t i=0; i<numVerts; ++i)
+    {
+      if(io_indices[i].m_v < m_verts.size())
+      {
+        positions[i]=m_verts[io_indices[i].m_v];
+      }
+    }
+    std::vector<GLuint> clusterOrder;
+    optimiseOverdraw(io_outIndices,positions,1.05f,&clusterOrder);
+    std::vector<GLuint> composed(order.size());
+    for(size_t t=0; t<order.size(); ++t)
+    {
+      composed[t]=order[clusterOrder[t]];
+    }
+    order.swap(composed);
+  }
+  // finally put the unique vertices in the order they are first drawn
+  std::vector<GLuint> vertexOrder;
+  optimiseVertexFetch(io_outIndices,numVerts,vertexOrder);
+  std::vector<IndexRef> indices;
+  indices.reserve(numVerts);
+  for(size_t i=0; i<numVerts; ++i)
+  {
+    indices.push_back(io_indices[vertexOrder[i]]);
+  }
+  io_indices.swap(indices);
+  o_triangleOrder.swap(order);
+  // the LODs share the vertices so they need the new numbering, they are only cache optimised
+  // as overdraw matters less for small objects
+  if(io_lods.size() !=0)
+  {
+    std::vector<GLuint> newIndex(numVerts);
+    for(size_t i=0; i<numVerts; ++i)
+    {
+      newIndex[vertexOrder[i]]=i;
+    }
+    for(size_t l=0; l<io_lods.size(); ++l)
+    {
+      std::vector<GLuint> &lod=io_lods[l];
+      for(size_t i=0; i<lod.size(); ++i)
+      {
+        lod[i]=newIndex[lod[i]];
+      }
+      optimiseVertexCache(lod,numVerts);
+    }
+  }
+  o_after=analyseVertexCache(io_outIndices,numVerts);
+}
 
 
   // a simple structure to hold our vertex data
@@ -156,103 +1290,53 @@ bool AbstractMesh::addIndex(
     GLfloat z;
   };
 
-
-
-void AbstractMesh::createVAO()
+//----------------------------------------------------------------------------------------------------------------------
+// pack a v/n/t triple into the interleaved vertex format, missing normals or tex cords
+// (for example only verts like Zbrush models) and bad vertex indices are set to 0
+static void packVertData(
+                         const std::vector<Vec3> &_verts,
+                         const std::vector<Vec3> &_norm,
+                         const std::vector<Vec3> &_tex,
+                         const IndexRef &_ref,
+                         VertData &o_d
+                        )
 {
-
-  // if we have already created a VBO just return.
-	if(m_vao == true)
+  if(_ref.m_v < _verts.size())
   {
-		std::cout<<"VAO exist so returning\n";
-		return;
+    o_d.x=_verts[_ref.m_v].m_x;
+    o_d.y=_verts[_ref.m_v].m_y;
+    o_d.z=_verts[_ref.m_v].m_z;
   }
-// else allocate space as build our VAO
-  m_dataPackType=0;
-	if(isTriangular())
-	{
-    m_dataPackType=GL_TRIANGLES;
-		std::cout <<"Doing Tri Data"<<std::endl;
-	}
-	// data is mixed of > quad so exit error
-	if(m_dataPackType == 0)
-	{
-		std::cerr<<"Can only create VBO from all Triangle or ALL Quad data at present"<<std::endl;
-		exit(EXIT_FAILURE);
-	}
-
-	// now we are going to process and pack the mesh into an ngl::VertexArrayObject
-  std::vector <VertData> vboMesh;
-  VertData d;
-	int loopFaceCount=3;
-
-
-	// loop for each of the faces
-	for(unsigned int i=0;i<m_nFaces;++i)
-	{
-		// now for each triangle in the face (remember we ensured tri above)
-		for(int j=0;j<loopFaceCount;++j)
-		{
-
-			// pack in the vertex data first
-			d.x=m_verts[m_face[i].m_vert[j]].m_x;
-			d.y=m_verts[m_face[i].m_vert[j]].m_y;
-			d.z=m_verts[m_face[i].m_vert[j]].m_z;
-			// now if we have norms of tex (possibly could not) pack them as well
-      if(m_nNorm >0 && m_nTex > 0)
-      {
-
-        d.nx=m_norm[m_face[i].m_norm[j]].m_x;
-        d.ny=m_norm[m_face[i].m_norm[j]].m_y;
-        d.nz=m_norm[m_face[i].m_norm[j]].m_z;
-
-				d.u=m_tex[m_face[i].m_tex[j]].m_x;
-				d.v=m_tex[m_face[i].m_tex[j]].m_y;
-
-      }
-      // now if neither are present (only verts like Zbrush models)
-      else if(m_nNorm ==0 && m_nTex==0)
-      {
-        d.nx=0;
-        d.ny=0;
-        d.nz=0;
-				d.u=0;
-				d.v=0;
-      }
-      // here we've got norms but not tex
-      else if(m_nNorm >0 && m_nTex==0)
-      {
-        d.nx=m_norm[m_face[i].m_norm[j]].m_x;
-        d.ny=m_norm[m_face[i].m_norm[j]].m_y;
-        d.nz=m_norm[m_face[i].m_norm[j]].m_z;
-				d.u=0;
-				d.v=0;
-      }
-      // here we've got tex but not norm least common
-      else if(m_nNorm ==0 && m_nTex>0)
-			{
-        d.nx=0;
-        d.ny=0;
-        d.nz=0;
-				d.u=m_tex[m_face[i].m_tex[j]].m_x;
-				d.v=m_tex[m_face[i].m_tex[j]].m_y;
-			}
-
-		vboMesh.push_back(d);
-		}
-	}
-
-  // first we grab an instance of our VOA
-  m_vaoMesh= ngl::VertexArrayObject::createVOA(m_dataPackType);
-	// next we bind it so it's active for setting data
-	m_vaoMesh->bind();
-  m_meshSize=vboMesh.size();
+  else
+  {
+    o_d.x=o_d.y=o_d.z=0.0f;
+  }
+  if(_ref.m_n != IndexRef::NOINDEX && _ref.m_n < _norm.size())
+  {
+    o_d.nx=_norm[_ref.m_n].m_x;
+    o_d.ny=_norm[_ref.m_n].m_y;
+    o_d.nz=_norm[_ref.m_n].m_z;
+  }
+  else
+  {
+    o_d.nx=o_d.ny=o_d.nz=0.0f;
+  }
+  if(_ref.m_t != IndexRef::NOINDEX && _ref.m_t < _tex.size())
+  {
+    o_d.u=_tex[_ref.m_t].m_x;
+    o_d.v=_tex[_ref.m_t].m_y;
+  }
+  else
+  {
+    o_d.u=o_d.v=0.0f;
+  }
+}
 
-	// now we have our data add it to the VAO, we need to tell the VAO the following
-	// how much (in bytes) data we are copying
-	// a pointer to the first element of data (in this case the address of the first element of the
-	// std::vector
-  m_vaoMesh->setData(m_meshSize*sizeof(VertData),vboMesh[0].u);
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::setVertDataAttributes(
+                                  VertexArrayObject *_vao
+                                 )
+{
 	// in this case we have packed our data in interleaved format as follows
 	// u,v,nx,ny,nz,x,y,z
 	// If you look at the shader we have the following attributes being used
@@ -262,16 +1346,190 @@ void AbstractMesh::createVAO()
 	// so we need to set the vertexAttributePointer so the correct size and type as follows
 	// vertex is attribute 0 with x,y,z(3) parts of type GL_FLOAT, our complete packed data is
 	// sizeof(vertData) and the offset into the data structure for the first x component is 5 (u,v,nx,ny,nz)..x
-  m_vaoMesh->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(VertData),5);
+  _vao->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(VertData),5);
 	// uv same as above but starts at 0 and is attrib 1 and only u,v so 2
-  m_vaoMesh->setVertexAttributePointer(1,2,GL_FLOAT,sizeof(VertData),0);
+  _vao->setVertexAttributePointer(1,2,GL_FLOAT,sizeof(VertData),0);
 	// normal same as vertex only starts at position 2 (u,v)-> nx
-  m_vaoMesh->setVertexAttributePointer(2,3,GL_FLOAT,sizeof(VertData),2);
+  _vao->setVertexAttributePointer(2,3,GL_FLOAT,sizeof(VertData),2);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::prepareVAO(
+                              bool _indexed
+                             )
+{
+  // without normals the lighting is broken so make some
+  if(m_generateNormals == true && m_nNorm == 0 && m_nFaces != 0)
+  {
+    calcNormals(m_normalWeight,m_creaseAngle);
+  }
+  triangulate();
+  if(_indexed == true)
+  {
+    weldVertices();
+    if(m_lodLevels !=0)
+    {
+      generateLODs(m_lodLevels,m_lodRatio);
+    }
+    if(m_optimiseIndices == true)
+    {
+      optimiseIndices(m_optimiseOverdraw);
+    }
+  }
+  // done last as optimiseIndices re-orders the vertices
+  if(m_generateTangents == true)
+  {
+    calcTangents(_indexed);
+  }
+  m_vaoPrepared=true;
+  m_vaoPreparedIndexed=_indexed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::createVAO(
+                             bool _indexed,
+                             VERTEXFORMAT _format
+                            )
+{
+
+  // if we have already created a VBO just return.
+	if(m_vao == true)
+  {
+		std::cout<<"VAO exist so returning\n";
+		return;
+  }
+// else allocate space as build our VAO
+  // any polygon is split into triangles so we always draw triangles
+  m_dataPackType=GL_TRIANGLES;
+  // this may have been done already on a loader thread
+  if(m_vaoPrepared == false || m_vaoPreparedIndexed != _indexed)
+  {
+    prepareVAO(_indexed);
+  }
+  m_vaoPrepared=false;
+  if(m_triangles.size() == 0)
+  {
+    std::cerr<<"mesh has no triangles so no VAO created\n";
+    return;
+  }
+  // first we grab an instance of our VOA
+  m_vaoMesh= ngl::VertexArrayObject::createVOA(m_dataPackType);
+  // GLES 2 only guarantees 16 bit indices, without GL_OES_element_index_uint bigger meshes are split
+  // into several buffers by setIndexedDataAuto
+  bool split= _indexed == true && m_indices.size() > 65536 && VertexArrayObject::supportsUintIndices() == false;
+  if(split == true && m_generateTangents == true)
+  {
+    // the tangent stream follows the vertices of one buffer so can't be split
+    std::cerr<<"too many unique vertices for 16 bit indices with tangents, using non indexed VAO\n";
+    _indexed=false;
+    split=false;
+  }
+  m_vaoIndexed=_indexed;
+	// next we bind it so it's active for setting data
+	m_vaoMesh->bind();
 
+  // the welded mesh has one vertex per unique v/n/t triple and an index per triangle corner,
+  // else we pack the mesh with each triangle corner in turn
+  const std::vector<IndexRef> &refs= _indexed == true ? m_indices : m_triangles;
+  std::vector <VertData> vboMesh(refs.size());
+  for(size_t i=0; i<refs.size(); ++i)
+  {
+    packVertData(m_verts,m_norm,m_tex,refs[i],vboMesh[i]);
+  }
+  // now we have our data add it to the VAO, we need to tell the VAO the following
+  // how much (in bytes) data we are copying
+  // a pointer to the first element of data (in this case the address of the first element of the
+  // std::vector
+  const GLfloat *data=&vboMesh[0].u;
+  unsigned int dataSize=vboMesh.size()*sizeof(VertData);
+  std::vector <QuantisedVertData> quantised;
+  m_vertexFormat=_format;
+  m_dequantise.identity();
+  m_uvTransform.set(1.0f,1.0f,0.0f,0.0f);
+  if(_format == VERTEX_QUANTISED)
+  {
+    m_dequantise=quantiseVertData(data,vboMesh.size(),quantised,&m_uvTransform);
+    // setData takes the float format so pass the bytes through as floats
+    data=reinterpret_cast<const GLfloat *>(&quantised[0]);
+    dataSize=quantised.size()*sizeof(QuantisedVertData);
+  }
+  m_bufferPackSize=(_format == VERTEX_QUANTISED ? sizeof(QuantisedVertData) : sizeof(VertData))/sizeof(GLfloat);
+  m_lodFirst.clear();
+  m_lodCount.clear();
+  m_lod=0;
+  if(_indexed == true)
+  {
+    // the LODs are packed after the base mesh in the one index buffer and drawn with drawRange
+    std::vector <GLuint> indices(m_outIndices.begin(),m_outIndices.end());
+    m_meshSize=indices.size();
+    m_lodFirst.push_back(0);
+    m_lodCount.push_back(m_meshSize);
+    if(split == true && m_lodIndices.size() !=0)
+    {
+      std::cerr<<"LODs need 32 bit indices for meshes this big so only the full mesh will be drawn\n";
+    }
+    for(size_t l=0; l<m_lodIndices.size() && split == false; ++l)
+    {
+      m_lodFirst.push_back(indices.size());
+      m_lodCount.push_back(m_lodIndices[l].size());
+      indices.insert(indices.end(),m_lodIndices[l].begin(),m_lodIndices[l].end());
+    }
+    m_vaoMesh->setIndexedDataAuto(dataSize/vboMesh.size(),vboMesh.size(),*data,indices.size(),indices[0]);
+  }
+  else
+  {
+    if(m_lodIndices.size() !=0)
+    {
+      std::cerr<<"LODs need an indexed VAO so only the full mesh will be drawn\n";
+    }
+    m_meshSize=vboMesh.size();
+    m_vaoMesh->setData(dataSize,*data);
+  }
+  if(_format == VERTEX_QUANTISED)
+  {
+    setQuantisedVertDataAttributes(m_vaoMesh);
+  }
+  else
+  {
+    setVertDataAttributes(m_vaoMesh);
+  }
+  if(m_generateTangents == true)
+  {
+    // the tangents were made for the indexed layout if we had to fall back to non indexed
+    if(m_tangents.size() != refs.size())
+    {
+      calcTangents(_indexed);
+    }
+    if(_format == VERTEX_QUANTISED)
+    {
+      std::vector<GLbyte> tangents(m_tangents.size()*4);
+      for(size_t i=0; i<m_tangents.size(); ++i)
+      {
+        tangents[i*4]=GLbyte(floor(m_tangents[i].m_x*127.0f+0.5f));
+        tangents[i*4+1]=GLbyte(floor(m_tangents[i].m_y*127.0f+0.5f));
+        tangents[i*4+2]=GLbyte(floor(m_tangents[i].m_z*127.0f+0.5f));
+        tangents[i*4+3]= m_tangents[i].m_w < 0.0f ? -127 : 127;
+      }
+      unsigned int stream=m_vaoMesh->setStreamData(tangents.size(),*reinterpret_cast<const GLfloat *>(&tangents[0]));
+      m_vaoMesh->setStreamAttributePointer(stream,3,4,GL_BYTE,4,0,true);
+    }
+    else
+    {
+      std::vector<GLfloat> tangents(m_tangents.size()*4);
+      for(size_t i=0; i<m_tangents.size(); ++i)
+      {
+        tangents[i*4]=m_tangents[i].m_x;
+        tangents[i*4+1]=m_tangents[i].m_y;
+        tangents[i*4+2]=m_tangents[i].m_z;
+        tangents[i*4+3]=m_tangents[i].m_w;
+      }
+      unsigned int stream=m_vaoMesh->setStreamData(tangents.size()*sizeof(GLfloat),tangents[0]);
+      m_vaoMesh->setStreamAttributePointer(stream,3,4,GL_FLOAT,4*sizeof(GLfloat),0);
+    }
+  }
 
 	// now we have set the vertex attributes we tell the VAO class how many indices to draw when
-	// glDrawArrays is called, in this case we use buffSize (but if we wished less of the sphere to be drawn we could
-	// specify less (in steps of 3))
+	// glDrawArrays / glDrawElements is called
   m_vaoMesh->setNumIndices(m_meshSize);
 	// finally we have finished for now so time to unbind the VAO
 	m_vaoMesh->unbind();
@@ -283,6 +1541,47 @@ void AbstractMesh::createVAO()
 
 
 
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::appendStreamFaces(
+                                     unsigned long int _firstFace,
+                                     unsigned int _numThreads
+                                    )
+{
+  triangulateRange(_firstFace,_numThreads);
+  // the new faces aren't in the BVH
+  m_bvh.clear();
+  size_t begin=m_faceTriStart[_firstFace]*3;
+  size_t end=m_triangles.size();
+  if(begin == end)
+  {
+    return;
+  }
+  std::vector <VertData> vboMesh(end-begin);
+  for(size_t i=begin; i<end; ++i)
+  {
+    packVertData(m_verts,m_norm,m_tex,m_triangles[i],vboMesh[i-begin]);
+  }
+  if(m_vao == false)
+  {
+    m_dataPackType=GL_TRIANGLES;
+    m_bufferPackSize=sizeof(VertData)/sizeof(GLfloat);
+    m_meshSize=0;
+    m_vaoMesh=VertexArrayObject::createVOA(m_dataPackType);
+    m_vao=true;
+  }
+  // each block is its own buffer and draw range in the VAO so it can be drawn straight away
+  m_vaoMesh->bind();
+  m_vaoMesh->setData(vboMesh.size()*sizeof(VertData),vboMesh[0].u);
+  if(m_vaoMesh->getNumBuffers() == 1)
+  {
+    setVertDataAttributes(m_vaoMesh);
+  }
+  m_vaoMesh->setBufferNumIndices(m_vaoMesh->getNumBuffers()-1,vboMesh.size());
+  m_meshSize+=vboMesh.size();
+  m_vaoMesh->setNumIndices(m_meshSize);
+  m_vaoMesh->unbind();
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void AbstractMesh::draw() const
 {
@@ -290,10 +1589,17 @@ void AbstractMesh::draw() const
   {
     if(m_texture == true)
     {
-      glBindTexture(GL_TEXTURE_2D,m_textureID);
+      GLStateCache::instance()->bindTexture(GL_TEXTURE_2D,m_textureID);
     }
     m_vaoMesh->bind();
-    m_vaoMesh->draw();
+    if(m_lod !=0)
+    {
+      m_vaoMesh->drawRange(m_lodFirst[m_lod],m_lodCount[m_lod]);
+    }
+    else
+    {
+      m_vaoMesh->draw();
+    }
     m_vaoMesh->unbind();
   }
 
@@ -303,34 +1609,156 @@ void AbstractMesh::draw() const
 //----------------------------------------------------------------------------------------------------------------------
 Real * AbstractMesh::mapVAOVerts()
 {
-	#warning not yet implemented
-	Real* ptr=0;
-/*
-	// bind our VBO data
-//
+  if(m_vao == false || m_vaoMesh->getNumBuffers() !=1 || m_vertexFormat != VERTEX_FLOAT)
+  {
+    std::cerr<<"only a VAO with one float format buffer can be mapped\n";
+    return 0;
+  }
+  if(m_vboMapped == true)
+  {
+    return &m_vaoMapped[0];
+  }
+  if(m_vaoShadow.size() == 0)
+  {
+    // the buffer can't be read back so pack the vertices again exactly as createVAO did, a VAO made some
+    // other way (e.g. read from a binary mesh) has nothing to pack it from
+    const std::vector<IndexRef> &refs= m_vaoIndexed == true ? m_indices : m_triangles;
+    GLint bufferSize=0;
+    GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER,m_vaoMesh->getVBOid(0));
+    glGetBufferParameteriv(GL_ARRAY_BUFFER,GL_BUFFER_SIZE,&bufferSize);
+    if(refs.empty() == true || m_bufferPackSize*sizeof(Real) != sizeof(VertData) ||
+       refs.size()*m_bufferPackSize*sizeof(Real) != size_t(bufferSize))
+    {
+      std::cerr<<"the VAO wasn't built from this mesh's vertices so can't be mapped\n";
+      return 0;
+    }
+    std::vector <VertData> vboMesh(refs.size());
+    for(size_t i=0; i<refs.size(); ++i)
+    {
+      packVertData(m_verts,m_norm,m_tex,refs[i],vboMesh[i]);
+    }
+    const Real *data=&vboMesh[0].u;
+    m_vaoShadow.assign(data,data+vboMesh.size()*sizeof(VertData)/sizeof(Real));
+    m_vaoMapped=m_vaoShadow;
+  }
   m_vaoMesh->bind();
-  //NGLCheckGLError("Abstract Mesh",__LINE__);
-  glBindBuffer(GL_ARRAY_BUFFER, m_vaoMesh->getVBOid(0));
-  //NGLCheckGLError("Abstract Mesh",__LINE__);
-  ptr = (float*)glMapBuffer(GL_ARRAY_BUFFER, GL_READ_WRITE);
-  //NGLCheckGLError("Abstract Mesh",__LINE__);
   m_vboMapped=true;
-	*/
-	return ptr;
+  return &m_vaoMapped[0];
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void AbstractMesh::unMapVAO()
+// ranges of changed vertices closer than this many bytes are uploaded as one, a glBufferSubData costs
+// about as much as copying this much more data
+static const unsigned int COALESCEGAP=512;
+// unchanged vertices are skipped this many at a time before comparing them one by one
+static const unsigned int DIFFBLOCK=64;
+
+//----------------------------------------------------------------------------------------------------------------------
+// the first vertex from _v on which differs in _a and _b, or _numVerts if none do
+static size_t nextChangedVertex(
+                                const Real *_a,
+                                const Real *_b,
+                                size_t _v,
+                                size_t _numVerts,
+                                unsigned int _stride
+                               )
 {
-	#warning not yet implemented
-	if(m_vboMapped==true)
-	{
-    //glUnmapBufferARB(GL_ARRAY_BUFFER); // unmap it after use
-    m_vboMapped=false;
-    m_vaoMesh->unbind();
+  const size_t blockBytes=DIFFBLOCK*_stride*sizeof(Real);
+  while(_v+DIFFBLOCK <= _numVerts && memcmp(_a+_v*_stride,_b+_v*_stride,blockBytes) == 0)
+  {
+    _v+=DIFFBLOCK;
+  }
+  while(_v < _numVerts && memcmp(_a+_v*_stride,_b+_v*_stride,_stride*sizeof(Real)) == 0)
+  {
+    ++_v;
+  }
+  return _v;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// add a byte range to a sorted list of upload ranges, joining it to the last one if the gap is small
+static void addUploadRange(
+                           std::vector< std::pair<unsigned int,unsigned int> > &io_ranges,
+                           unsigned int _offset,
+                           unsigned int _size
+                          )
+{
+  if(io_ranges.size() !=0 && _offset <= io_ranges.back().first+io_ranges.back().second+COALESCEGAP)
+  {
+    unsigned int end=std::max(io_ranges.back().first+io_ranges.back().second,_offset+_size);
+    io_ranges.back().second=end-io_ranges.back().first;
+  }
+  else
+  {
+    io_ranges.push_back(std::make_pair(_offset,_size));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::markVAOVertsDirty(
+                                     unsigned int _first,
+                                     unsigned int _count
+                                    )
+{
+  if(m_vboMapped == false)
+  {
+    std::cerr<<"markVAOVertsDirty called when the VAO isn't mapped\n";
+    return;
   }
+  m_vaoDirty.push_back(std::make_pair(_first,_count));
+}
 
+//----------------------------------------------------------------------------------------------------------------------
+void AbstractMesh::unMapVAO()
+{
+  if(m_vboMapped == false)
+  {
+    return;
+  }
+  m_vboMapped=false;
+  const unsigned int stride=m_bufferPackSize;
+  const unsigned int strideBytes=stride*sizeof(Real);
+  const size_t numVerts=m_vaoShadow.size()/stride;
+  const Real *mapped=&m_vaoMapped[0];
+  Real *shadow=&m_vaoShadow[0];
+  std::vector< std::pair<unsigned int,unsigned int> > ranges;
+  if(m_vaoDirty.size() !=0)
+  {
+    std::sort(m_vaoDirty.begin(),m_vaoDirty.end());
+    for(size_t i=0; i<m_vaoDirty.size(); ++i)
+    {
+      size_t first=std::min<size_t>(m_vaoDirty[i].first,numVerts);
+      size_t count=std::min<size_t>(m_vaoDirty[i].second,numVerts-first);
+      if(count !=0)
+      {
+        addUploadRange(ranges,first*strideBytes,count*strideBytes);
+      }
+    }
+    m_vaoDirty.clear();
+  }
+  else
+  {
+    // find the runs of changed vertices
+    for(size_t v=nextChangedVertex(mapped,shadow,0,numVerts,stride); v<numVerts; v=nextChangedVertex(mapped,shadow,v,numVerts,stride))
+    {
+      size_t end=v+1;
+      while(end < numVerts && memcmp(mapped+end*stride,shadow+end*stride,strideBytes) !=0)
+      {
+        ++end;
+      }
+      addUploadRange(ranges,v*strideBytes,(end-v)*strideBytes);
+      v=end;
+    }
+  }
+  // copy just what is uploaded so the shadow stays what GL holds
+  for(size_t i=0; i<ranges.size(); ++i)
+  {
+    memcpy(reinterpret_cast<unsigned char *>(shadow)+ranges[i].first,reinterpret_cast<const unsigned char *>(mapped)+ranges[i].first,ranges[i].second);
+  }
+  m_vaoMesh->updateData(0,m_vaoShadow.size()*sizeof(Real),mapped,ranges);
+  m_vaoMesh->unbind();
 }
+
 //----------------------------------------------------------------------------------------------------------------------
 void AbstractMesh::calcDimensions()
 {
@@ -368,73 +1796,144 @@ void AbstractMesh::calcDimensions()
 
 }
 
-void AbstractMesh::saveNCCABinaryMesh(
-                                       const std::string &_fname
+//----------------------------------------------------------------------------------------------------------------------
+// write zero bytes after _offset so the next block starts on an NCCABINARY_ALIGN boundary
+static void padToAlignment(
+                           std::fstream &io_file,
+                           uint32_t _offset
+                          )
+{
+  static const char zeros[NCCABINARY_ALIGN]={0};
+  uint32_t pad=(NCCABINARY_ALIGN-_offset%NCCABINARY_ALIGN)%NCCABINARY_ALIGN;
+  io_file.write(zeros,pad);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool AbstractMesh::saveNCCABinaryMesh(
+                                      const std::string &_fname,
+                                      bool _optimise
                                      )
 {
-// so basically we need to save all the state data from the abstract mesh
-// then map the vbo on the gpu and dump that in one go, this means we have to
-// call CreateVBO first the Save
+  // we save the welded mesh as created by createVAO(true) so it can be given straight to
+  // glBufferData when loaded, this is all done on the CPU so no GL context is needed
+  if(m_nFaces == 0 || m_verts.size() == 0)
+  {
+    std::cerr<<"no mesh data to save to "<<_fname<<"\n";
+    return false;
+  }
+  if(m_faceTriStart.size() != m_nFaces+1)
+  {
+    triangulate();
+  }
+  // saving mustn't change the mesh as a VAO may have been built from it, so the welded lists are only
+  // used if they are already what we want else the file gets its own
+  const std::vector<IndexRef> *vertRefs=&m_indices;
+  const std::vector<GLuint> *outIndices=&m_outIndices;
+  std::vector<IndexRef> savedIndices;
+  std::vector<GLuint> savedOutIndices;
+  bool optimised=m_drawTriangleOrder.size() !=0;
+  if(m_outIndices.size() != m_triangles.size() || optimised != _optimise)
+  {
+    weldTriangles(savedIndices,savedOutIndices);
+    if(_optimise == true)
+    {
+      std::vector<GLuint> order;
+      std::vector< std::vector<GLuint> > lods;
+      VertexCacheStats before;
+      VertexCacheStats after;
+      optimiseIndexLists(m_optimiseOverdraw,savedIndices,savedOutIndices,order,lods,before,after);
+    }
+    vertRefs=&savedIndices;
+    outIndices=&savedOutIndices;
+  }
+  std::vector <VertData> vboMesh(vertRefs->size());
+  for(size_t i=0; i<vertRefs->size(); ++i)
+  {
+    packVertData(m_verts,m_norm,m_tex,(*vertRefs)[i],vboMesh[i]);
+  }
+
+  NCCABinaryMeshHeader h;
+  memset(&h,0,sizeof(NCCABinaryMeshHeader));
+  memcpy(h.m_magic,"ngl::bin",8);
+  h.m_endian=NCCABINARY_ENDIAN;
+  h.m_version=NCCABINARY_VERSION;
+  h.m_headerSize=sizeof(NCCABinaryMeshHeader);
+  h.m_drawMode=GL_TRIANGLES;
+  h.m_vertexFormat=VERTDATA;
+  h.m_vertexStride=sizeof(VertData);
+  h.m_numVertices=vboMesh.size();
+  // 16 bit indices are always supported by GLES 2 so only use 32 bit when we have to
+  h.m_indexType= vboMesh.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  h.m_numIndices=outIndices->size();
+  uint32_t indexSize= h.m_indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+  uint32_t align=NCCABINARY_ALIGN;
+  h.m_vertexOffset=(h.m_headerSize+align-1)/align*align;
+  uint32_t vertEnd=h.m_vertexOffset+h.m_numVertices*h.m_vertexStride;
+  h.m_indexOffset=(vertEnd+align-1)/align*align;
+  uint32_t indexEnd=h.m_indexOffset+h.m_numIndices*indexSize;
+  // the BVH is stored so the loaded mesh can still be picked, it doesn't depend on the index order
+  if(m_bvh.isBuilt() == false)
+  {
+    buildBVH();
+  }
+  h.m_bvhOffset=(indexEnd+align-1)/align*align;
+  h.m_bvhSize=m_bvh.getDataSize();
+  h.m_numSourceVerts=m_nVerts;
+  h.m_numSourceNormals=m_nNorm;
+  h.m_numSourceTexCords=m_nTex;
+  h.m_numSourceFaces=m_nFaces;
+
+  // work out the bounds here rather than with calcDimensions as that creates a BBox which needs GL
+  Vec3 center(0,0,0);
+  Vec3 min=m_verts[0];
+  Vec3 max=m_verts[0];
+  for(size_t i=0; i<m_verts.size(); ++i)
+  {
+    const Vec3 &v=m_verts[i];
+    center+=v;
+    min.m_x=std::min(min.m_x,v.m_x); max.m_x=std::max(max.m_x,v.m_x);
+    min.m_y=std::min(min.m_y,v.m_y); max.m_y=std::max(max.m_y,v.m_y);
+    min.m_z=std::min(min.m_z,v.m_z); max.m_z=std::max(max.m_z,v.m_z);
+  }
+  center/=m_verts.size();
+  calcBoundingSphere();
+  h.m_min[0]=min.m_x; h.m_min[1]=min.m_y; h.m_min[2]=min.m_z;
+  h.m_max[0]=max.m_x; h.m_max[1]=max.m_y; h.m_max[2]=max.m_z;
+  h.m_center[0]=center.m_x; h.m_center[1]=center.m_y; h.m_center[2]=center.m_z;
+  h.m_sphereCenter[0]=m_sphereCenter.m_x;
+  h.m_sphereCenter[1]=m_sphereCenter.m_y;
+  h.m_sphereCenter[2]=m_sphereCenter.m_z;
+  h.m_sphereRadius=m_sphereRadius;
+
   std::fstream file;
   file.open(_fname.c_str(),std::ios::out | std::ios::binary);
   if (!file.is_open())
   {
     std::cerr<<"problems Opening File "<<_fname<<std::endl;
-    return;
+    return false;
   }
-  // lets write out our own Magic Number file ID
-  const std::string header("ngl::bin");
-  file.write(header.c_str(),header.length());
-  /// The number of vertices in the object
-  file.write(reinterpret_cast <char *>(&m_nVerts),sizeof(unsigned long int));
-  /// The number of normals in the object
-  file.write(reinterpret_cast <char *>(&m_nNorm),sizeof(unsigned long int));
-
-  /// the number of texture co-ordinates in the object
-  file.write(reinterpret_cast <char *>(&m_nTex),sizeof(unsigned long int));
-
-  /// the number of faces in the object
-  file.write(reinterpret_cast <char *>(&m_nFaces),sizeof(unsigned long int));
-  file.write(reinterpret_cast <char *>(&m_center.m_x),sizeof(ngl::Real));
-  file.write(reinterpret_cast <char *>(&m_center.m_y),sizeof(ngl::Real));
-  file.write(reinterpret_cast <char *>(&m_center.m_z),sizeof(ngl::Real));
-
-  file.write(reinterpret_cast <char *>(&m_texture),sizeof(bool));
-
-  file.write(reinterpret_cast <char *>(&m_maxX),sizeof(ngl::Real));
-  file.write(reinterpret_cast <char *>(&m_maxY),sizeof(ngl::Real));
-  file.write(reinterpret_cast <char *>(&m_maxZ),sizeof(ngl::Real));
-  file.write(reinterpret_cast <char *>(&m_minX),sizeof(ngl::Real));
-  file.write(reinterpret_cast <char *>(&m_minY),sizeof(ngl::Real));
-  file.write(reinterpret_cast <char *>(&m_minZ),sizeof(ngl::Real));
-
-  file.write(reinterpret_cast <char *>(&  m_dataPackType),sizeof(GLuint));
-  file.write(reinterpret_cast <char *>(&  m_indexSize),sizeof(unsigned int));
-  file.write(reinterpret_cast <char *>(&  m_bufferPackSize),sizeof(unsigned int));
-  /// now we can dump the data from the vbo
-  unsigned int size=m_indexSize*m_bufferPackSize*sizeof(GLfloat);
-  std::cout<<"size is"<<size<<std::endl;
-  file.write(reinterpret_cast <char *>(&size),sizeof(unsigned int));
-
-
-  Real *vboMem=this->mapVAOVerts();
-  file.write(reinterpret_cast<char *>(vboMem),size);
-
-  // now write the indices
-  // first the size
-  size=m_outIndices.size();
-  std::cout<<"Size of out indices ="<<size<<std::endl;
-  file.write(reinterpret_cast <char *>(&size),sizeof(unsigned int));
-  for( unsigned int i=0; i<size; ++i)
+  file.write(reinterpret_cast <const char *>(&h),sizeof(NCCABinaryMeshHeader));
+  padToAlignment(file,h.m_headerSize);
+  file.write(reinterpret_cast <const char *>(&vboMesh[0]),h.m_numVertices*h.m_vertexStride);
+  padToAlignment(file,vertEnd);
+  if(h.m_indexType == GL_UNSIGNED_SHORT)
   {
-    file.write(reinterpret_cast <char *>(&m_outIndices[i]),sizeof(unsigned int));
+    std::vector <GLushort> indices(outIndices->begin(),outIndices->end());
+    file.write(reinterpret_cast <const char *>(&indices[0]),indices.size()*indexSize);
   }
-
-
-
+  else
+  {
+    file.write(reinterpret_cast <const char *>(&(*outIndices)[0]),outIndices->size()*indexSize);
+  }
+  padToAlignment(file,indexEnd);
+  m_bvh.write(file);
+  bool ok=file.good();
   file.close();
-  this->unMapVAO();
-
+  if(ok == false)
+  {
+    std::cerr<<"error writing "<<_fname<<"\n";
+  }
+  return ok;
 }
 
 /// modified from example in Rick Parent book
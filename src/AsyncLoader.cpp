@@ -0,0 +1,286 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <boost/bind.hpp>
+#include "AsyncLoader.h"
+#include "VAOPrimitives.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AsyncLoader.cpp
+/// @brief implementation files for AsyncLoader class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+AsyncAsset::AsyncAsset(
+                       const std::string &_fname
+                      ) :
+                        m_fname(_fname),
+                        m_state(ASYNC_PENDING)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+ASYNCSTATE AsyncAsset::getState() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_state;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncAsset::setState(
+                          ASYNCSTATE _state
+                         )
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_state=_state;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+AsyncMesh::AsyncMesh(
+                     const std::string &_fname,
+                     bool _indexed,
+                     VERTEXFORMAT _format
+                    ) :
+                      AsyncAsset(_fname),
+                      m_indexed(_indexed),
+                      m_format(_format)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool AsyncMesh::loadData()
+{
+  // the BBox is created in createGL as it makes a VAO, the worker is already one of a pool so the
+  // parse only uses the one thread
+  if(m_mesh.load(m_fname,false,1) == false)
+  {
+    return false;
+  }
+  m_mesh.prepareVAO(m_indexed);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncMesh::createGL()
+{
+  m_mesh.calcDimensions();
+  m_mesh.createVAO(m_indexed,m_format);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncMesh::draw(
+                     const std::string &_placeholder
+                    ) const
+{
+  if(isReady() == true)
+  {
+    m_mesh.draw();
+  }
+  else if(_placeholder.empty() == false)
+  {
+    VAOPrimitives::instance()->draw(_placeholder);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+AsyncTexture::AsyncTexture(
+                           const std::string &_fname
+                          ) :
+                            AsyncAsset(_fname),
+                            m_id(0)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool AsyncTexture::loadData()
+{
+  return m_texture.loadImage(m_fname);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncTexture::createGL()
+{
+  m_id=m_texture.setTextureGL();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+AsyncLoader::AsyncLoader()
+{
+  m_pending=0;
+  m_numThreads=0;
+  m_started=false;
+  m_quit=false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+AsyncLoader::~AsyncLoader()
+{
+  shutdown();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncLoader::setNumThreads(
+                                unsigned int _numThreads
+                               )
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  if(m_started == true)
+  {
+    std::cerr<<"AsyncLoader threads already started, setNumThreads ignored\n";
+    return;
+  }
+  m_numThreads=_numThreads;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+AsyncMeshHandle AsyncLoader::loadMesh(
+                                      const std::string &_fname,
+                                      bool _indexed,
+                                      VERTEXFORMAT _format
+                                     )
+{
+  AsyncMeshHandle mesh(new AsyncMesh(_fname,_indexed,_format));
+  submit(mesh);
+  return mesh;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+AsyncTextureHandle AsyncLoader::loadTexture(
+                                            const std::string &_fname
+                                           )
+{
+  AsyncTextureHandle texture(new AsyncTexture(_fname));
+  submit(texture);
+  return texture;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncLoader::submit(
+                         const boost::shared_ptr<AsyncAsset> &_asset
+                        )
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  if(m_started == false)
+  {
+    unsigned int n=m_numThreads;
+    if(n == 0)
+    {
+      // leave a core for the render thread
+      unsigned int cores=boost::thread::hardware_concurrency();
+      n= cores > 1 ? cores-1 : 1;
+    }
+    for(unsigned int i=0; i<n; ++i)
+    {
+      m_workers.create_thread(boost::bind(&AsyncLoader::workerLoop,this));
+    }
+    m_started=true;
+    m_quit=false;
+  }
+  m_jobs.push_back(_asset);
+  ++m_pending;
+  m_wake.notify_one();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncLoader::workerLoop()
+{
+  for(;;)
+  {
+    boost::shared_ptr<AsyncAsset> asset;
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while(m_jobs.empty() == true && m_quit == false)
+      {
+        m_wake.wait(lock);
+      }
+      if(m_jobs.empty() == true)
+      {
+        return;
+      }
+      asset=m_jobs.front();
+      m_jobs.pop_front();
+    }
+    bool ok=asset->loadData();
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(ok == true)
+    {
+      asset->setState(ASYNC_LOADED);
+      m_completed.push_back(asset);
+    }
+    else
+    {
+      std::cerr<<"AsyncLoader failed to load "<<asset->getFileName()<<"\n";
+      asset->setState(ASYNC_FAILED);
+      --m_pending;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int AsyncLoader::processCompleted(
+                                           unsigned int _maxItems
+                                          )
+{
+  unsigned int done=0;
+  while(_maxItems == 0 || done < _maxItems)
+  {
+    boost::shared_ptr<AsyncAsset> asset;
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      if(m_completed.empty() == true)
+      {
+        break;
+      }
+      asset=m_completed.front();
+      m_completed.pop_front();
+    }
+    // the GL work is done without the lock so the workers can carry on
+    asset->createGL();
+    asset->setState(ASYNC_READY);
+    ++done;
+    boost::mutex::scoped_lock lock(m_mutex);
+    --m_pending;
+  }
+  return done;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int AsyncLoader::getNumPending() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_pending;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void AsyncLoader::shutdown()
+{
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(m_started == false)
+    {
+      return;
+    }
+    m_quit=true;
+  }
+  m_wake.notify_all();
+  m_workers.join_all();
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_started=false;
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
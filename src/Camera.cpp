@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <iostream>
+#include <limits>
 #include "Camera.h"
 #include "Util.h"
 #include "NGLassert.h"
@@ -566,20 +567,21 @@ void Camera::drawFrustum()
   points.push_back(m_fbl);
 
 
-  // now we create a VAO to store the data
-  ngl::VertexArrayObject *vao=ngl::VertexArrayObject::createVOA(GL_LINES);
-  // bind it so we can set values
+  // the lines are written into a ring shared by all cameras rather than a new VAO each call, 64 frustums
+  // fit before the ring is orphaned
+  static ngl::VertexArrayObject *vao=0;
+  if(vao == 0)
+  {
+    vao=ngl::VertexArrayObject::createVOA(GL_LINES);
+    vao->bind();
+    vao->setDynamicData(64*24*sizeof(Vec3));
+    // now we set the attribute pointer to be 0 (as this matches vertIn in our shader)
+    vao->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(Vec3),0);
+    vao->unbind();
+  }
   vao->bind();
-  // set the vertex data (4 for x,y,z)
-  vao->setData(points.size()*sizeof(Vec3),points[0].m_x);
-  // now we set the attribute pointer to be 0 (as this matches vertIn in our shader)
-  vao->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(Vec3),0);
-  // say how many indecis to be rendered
-  vao->setNumIndices(points.size());
-  vao->draw();
-  // now unbind
+  vao->drawRange(vao->appendData(sizeof(Vec3),points.size(),points[0].m_x));
   vao->unbind();
-  vao->removeVOA();
 
 }
 
@@ -626,6 +628,30 @@ CAMERAINTERCEPT Camera::isSphereInFrustum(
 	return result;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+Real Camera::getProjectedSphereSize(
+                                    const Vec3 &_center,
+                                    Real _radius
+                                   ) const
+{
+  // m_m[1][1] of the projection maps a view space height to the -1 to 1 viewport height
+  Real scale=m_projectionMatrix.m_m[1][1];
+  if(m_projectionMode == ORTHOGRAPHIC)
+  {
+    return _radius*scale;
+  }
+  Vec3 eye(m_eye.m_x,m_eye.m_y,m_eye.m_z);
+  Vec3 toCenter=_center-eye;
+  Real dist2=toCenter.dot(toCenter);
+  Real radius2=_radius*_radius;
+  if(dist2 <= radius2)
+  {
+    return std::numeric_limits<Real>::max();
+  }
+  // the tangent of the angle the sphere covers from the eye over the tangent of half the fov
+  return _radius*scale/sqrtf(dist2-radius2);
+}
+
 /*
 int Camera::boxInFrustum(AABox &b) {
 
@@ -41,6 +41,7 @@ EGLWindow::EGLWindow(EGLconfig *_config)
  m_display=0;
  m_context=0;
  m_surface=0;
+ m_loader=0;
 
  // now find the max display size (we will use this later to assert if the user
  // defined sizes are in the correct bounds
@@ -186,6 +187,9 @@ void EGLWindow::destroySurface()
 	if(m_activeSurface == true)
 	{
 		eglSwapBuffers(m_display, m_surface);
+		// the loader context shares with ours so must go first
+		delete m_loader;
+		m_loader=0;
 		// here we free up the context and display we made earlier
 		eglMakeCurrent( m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
 		eglDestroySurface( m_display, m_surface );
@@ -204,6 +208,25 @@ EGLWindow::~EGLWindow()
 	destroySurface();
 }
 
+SharedContextLoader *EGLWindow::createLoaderContext()
+{
+	if(m_activeSurface == false)
+	{
+		std::cerr<<"createLoaderContext called before the surface was made\n";
+		return 0;
+	}
+	if(m_loader == 0)
+	{
+		m_loader = new SharedContextLoader(m_display,m_config->getConfig(),m_context);
+		if(m_loader->isValid() == false)
+		{
+			delete m_loader;
+			m_loader=0;
+		}
+	}
+	return m_loader;
+}
+
 void EGLWindow::swapBuffers() const
 {
 	eglSwapBuffers(m_display, m_surface);
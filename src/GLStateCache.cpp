@@ -0,0 +1,413 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include "GLStateCache.h"
+#include "VertexArrayObject.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GLStateCache.cpp
+/// @brief implementation files for GLStateCache class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+// the bit for each capability GLES 2 has or -1
+static int capabilityBit(
+                         GLenum _cap
+                        )
+{
+  switch(_cap)
+  {
+    case GL_BLEND : return 0;
+    case GL_DEPTH_TEST : return 1;
+    case GL_CULL_FACE : return 2;
+    case GL_SCISSOR_TEST : return 3;
+    case GL_STENCIL_TEST : return 4;
+    case GL_POLYGON_OFFSET_FILL : return 5;
+    case GL_DITHER : return 6;
+    case GL_SAMPLE_ALPHA_TO_COVERAGE : return 7;
+    case GL_SAMPLE_COVERAGE : return 8;
+    default : return -1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+GLStateCache::GLStateCache()
+{
+  m_bindVertexArray=0;
+  forget();
+  resetCounters();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::invalidate()
+{
+  forget();
+  // the VAO fallback remembers which attribute pointers it set and they may have changed too
+  VertexArrayObject::resetBinding();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::forget()
+{
+  m_program=UNKNOWN;
+  m_vertexArray= m_bindVertexArray !=0 ? UNKNOWN : 0;
+  m_arrayBuffer=UNKNOWN;
+  m_elementBuffer=UNKNOWN;
+  m_activeTexture=UNKNOWN;
+  for(unsigned int i=0; i<MAXTEXTUREUNITS; ++i)
+  {
+    m_texture2D[i]=UNKNOWN;
+    m_textureCube[i]=UNKNOWN;
+  }
+  m_attributeKnown=0;
+  m_attributeEnabled=0;
+  m_capabilityKnown=0;
+  m_capabilityEnabled=0;
+  m_blendSrc=UNKNOWN;
+  m_blendDst=UNKNOWN;
+  m_depthFunc=UNKNOWN;
+  m_depthMask=UNKNOWN;
+  m_cullFace=UNKNOWN;
+  m_viewport[0]=m_viewport[1]=0;
+  m_viewport[2]=m_viewport[3]=-1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::useProgram(
+                              GLuint _program
+                             )
+{
+  if(count(STATE_PROGRAM,m_program != _program))
+  {
+    glUseProgram(_program);
+    m_program=_program;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::deleteProgram(
+                                 GLuint _program
+                                )
+{
+  // a current program is only deleted once it is no longer in use so the binding stays as it is but the
+  // name can be given out again
+  glDeleteProgram(_program);
+  if(m_program == _program)
+  {
+    m_program=UNKNOWN;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::bindVertexArray(
+                                   GLuint _array
+                                  )
+{
+  if(m_bindVertexArray == 0)
+  {
+    return;
+  }
+  if(count(STATE_VERTEXARRAY,m_vertexArray != _array))
+  {
+    m_bindVertexArray(_array);
+    m_vertexArray=_array;
+    // the element buffer and attribute enables are part of the VAO
+    m_elementBuffer=UNKNOWN;
+    m_attributeKnown=0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::bindBuffer(
+                              GLenum _target,
+                              GLuint _buffer
+                             )
+{
+  GLuint *bound= _target == GL_ARRAY_BUFFER ? &m_arrayBuffer : _target == GL_ELEMENT_ARRAY_BUFFER ? &m_elementBuffer : 0;
+  if(bound == 0)
+  {
+    count(STATE_BUFFER,true);
+    glBindBuffer(_target,_buffer);
+  }
+  else if(count(STATE_BUFFER,*bound != _buffer))
+  {
+    glBindBuffer(_target,_buffer);
+    *bound=_buffer;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::deleteBuffers(
+                                 GLsizei _n,
+                                 const GLuint *_buffers
+                                )
+{
+  glDeleteBuffers(_n,_buffers);
+  for(GLsizei i=0; i<_n; ++i)
+  {
+    if(m_arrayBuffer == _buffers[i])
+    {
+      m_arrayBuffer=0;
+    }
+    // only the bound VAO's element buffer is unbound, one in another VAO keeps the buffer alive
+    if(m_elementBuffer == _buffers[i])
+    {
+      m_elementBuffer=0;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::activeTexture(
+                                 GLenum _unit
+                                )
+{
+  if(count(STATE_ACTIVETEXTURE,m_activeTexture != _unit))
+  {
+    glActiveTexture(_unit);
+    m_activeTexture=_unit;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::bindTexture(
+                               GLenum _target,
+                               GLuint _texture
+                              )
+{
+  unsigned int unit=m_activeTexture-GL_TEXTURE0;
+  GLuint *bound=0;
+  if(m_activeTexture != UNKNOWN && unit < MAXTEXTUREUNITS)
+  {
+    bound= _target == GL_TEXTURE_2D ? &m_texture2D[unit] : _target == GL_TEXTURE_CUBE_MAP ? &m_textureCube[unit] : 0;
+  }
+  if(bound == 0)
+  {
+    count(STATE_TEXTURE,true);
+    glBindTexture(_target,_texture);
+  }
+  else if(count(STATE_TEXTURE,*bound != _texture))
+  {
+    glBindTexture(_target,_texture);
+    *bound=_texture;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::deleteTextures(
+                                  GLsizei _n,
+                                  const GLuint *_textures
+                                 )
+{
+  glDeleteTextures(_n,_textures);
+  for(GLsizei i=0; i<_n; ++i)
+  {
+    for(unsigned int u=0; u<MAXTEXTUREUNITS; ++u)
+    {
+      if(m_texture2D[u] == _textures[i])
+      {
+        m_texture2D[u]=0;
+      }
+      if(m_textureCube[u] == _textures[i])
+      {
+        m_textureCube[u]=0;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool GLStateCache::setAttribute(
+                                GLuint _index,
+                                bool _enabled
+                               )
+{
+  // with a GL VAO bound the enables belong to it and aren't shadowed
+  if(_index >= 32 || m_vertexArray !=0)
+  {
+    return count(STATE_ATTRIBUTE,true);
+  }
+  unsigned int bit=1u<<_index;
+  bool same= (m_attributeKnown & bit) !=0 && ((m_attributeEnabled & bit) !=0) == _enabled;
+  m_attributeKnown|=bit;
+  m_attributeEnabled= _enabled == true ? m_attributeEnabled | bit : m_attributeEnabled & ~bit;
+  return count(STATE_ATTRIBUTE,same == false);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::enableVertexAttribArray(
+                                           GLuint _index
+                                          )
+{
+  if(setAttribute(_index,true))
+  {
+    glEnableVertexAttribArray(_index);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::disableVertexAttribArray(
+                                            GLuint _index
+                                           )
+{
+  if(setAttribute(_index,false))
+  {
+    glDisableVertexAttribArray(_index);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool GLStateCache::setCapability(
+                                 GLenum _cap,
+                                 bool _enabled
+                                )
+{
+  int b=capabilityBit(_cap);
+  if(b < 0)
+  {
+    return count(STATE_CAPABILITY,true);
+  }
+  unsigned int bit=1u<<b;
+  bool same= (m_capabilityKnown & bit) !=0 && ((m_capabilityEnabled & bit) !=0) == _enabled;
+  m_capabilityKnown|=bit;
+  m_capabilityEnabled= _enabled == true ? m_capabilityEnabled | bit : m_capabilityEnabled & ~bit;
+  return count(STATE_CAPABILITY,same == false);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::enable(
+                          GLenum _cap
+                         )
+{
+  if(setCapability(_cap,true))
+  {
+    glEnable(_cap);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::disable(
+                           GLenum _cap
+                          )
+{
+  if(setCapability(_cap,false))
+  {
+    glDisable(_cap);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::blendFunc(
+                             GLenum _src,
+                             GLenum _dst
+                            )
+{
+  if(count(STATE_BLENDFUNC,m_blendSrc != _src || m_blendDst != _dst))
+  {
+    glBlendFunc(_src,_dst);
+    m_blendSrc=_src;
+    m_blendDst=_dst;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::depthFunc(
+                             GLenum _func
+                            )
+{
+  if(count(STATE_DEPTH,m_depthFunc != _func))
+  {
+    glDepthFunc(_func);
+    m_depthFunc=_func;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::depthMask(
+                             GLboolean _flag
+                            )
+{
+  GLuint flag= _flag ? 1 : 0;
+  if(count(STATE_DEPTH,m_depthMask != flag))
+  {
+    glDepthMask(_flag);
+    m_depthMask=flag;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::cullFace(
+                            GLenum _mode
+                           )
+{
+  if(count(STATE_CULLFACE,m_cullFace != _mode))
+  {
+    glCullFace(_mode);
+    m_cullFace=_mode;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::viewport(
+                            GLint _x,
+                            GLint _y,
+                            GLsizei _width,
+                            GLsizei _height
+                           )
+{
+  if(count(STATE_VIEWPORT,m_viewport[0] != _x || m_viewport[1] != _y || m_viewport[2] != _width || m_viewport[3] != _height))
+  {
+    glViewport(_x,_y,_width,_height);
+    m_viewport[0]=_x;
+    m_viewport[1]=_y;
+    m_viewport[2]=_width;
+    m_viewport[3]=_height;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned long GLStateCache::getTotalIssued() const
+{
+  unsigned long total=0;
+  for(int i=0; i<STATE_NUMCALLS; ++i)
+  {
+    total+=m_issued[i];
+  }
+  return total;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned long GLStateCache::getTotalElided() const
+{
+  unsigned long total=0;
+  for(int i=0; i<STATE_NUMCALLS; ++i)
+  {
+    total+=m_elided[i];
+  }
+  return total;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void GLStateCache::resetCounters()
+{
+  memset(m_issued,0,sizeof(m_issued));
+  memset(m_elided,0,sizeof(m_elided));
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
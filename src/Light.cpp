@@ -108,11 +108,16 @@ void Light::setAttenuation(
 
 
 void Light::loadToShader(
-                            std::string _uniformName
+                            const std::string &_uniformName
                            )const
 {
 
   ShaderLib *shader=ngl::ShaderLib::instance();
+  // each uniform name is built in the same string, reserved for the longest suffix so there is one allocation
+  std::string name;
+  name.reserve(_uniformName.size()+32);
+  name.append(_uniformName);
+  std::string::size_type base=name.size();
 /*
 /// struct Lights
 /// {
@@ -125,23 +130,23 @@ void Light::loadToShader(
   if(m_active==true)
   {
     ngl::Vec4 pos=m_transform*m_position;
-    shader->setShaderParam4f(_uniformName+".position",pos.m_x,pos.m_y,pos.m_z,float(m_lightMode));
-    shader->setShaderParam4f(_uniformName+".ambient",m_ambient.m_r,m_ambient.m_g,m_ambient.m_b,m_ambient.m_a);
-    shader->setShaderParam4f(_uniformName+".diffuse",m_diffuse.m_r,m_diffuse.m_g,m_diffuse.m_b,m_diffuse.m_a);
-    shader->setShaderParam4f(_uniformName+".specular",m_specular.m_r,m_specular.m_g,m_specular.m_b,m_specular.m_a);
-    shader->setShaderParam1f(_uniformName+".constantAttenuation",m_constantAtten);
-    shader->setShaderParam1f(_uniformName+".linearAttenuation",m_linearAtten);
-    shader->setShaderParam1f(_uniformName+".quadraticAttenuation",m_quadraticAtten);
-    shader->setShaderParam1f(_uniformName+".spotCosCutoff",m_cutoffAngle);
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".position"),pos.m_x,pos.m_y,pos.m_z,float(m_lightMode));
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".ambient"),m_ambient.m_r,m_ambient.m_g,m_ambient.m_b,m_ambient.m_a);
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".diffuse"),m_diffuse.m_r,m_diffuse.m_g,m_diffuse.m_b,m_diffuse.m_a);
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".specular"),m_specular.m_r,m_specular.m_g,m_specular.m_b,m_specular.m_a);
+    shader->setShaderParam1f(name.replace(base,std::string::npos,".constantAttenuation"),m_constantAtten);
+    shader->setShaderParam1f(name.replace(base,std::string::npos,".linearAttenuation"),m_linearAtten);
+    shader->setShaderParam1f(name.replace(base,std::string::npos,".quadraticAttenuation"),m_quadraticAtten);
+    shader->setShaderParam1f(name.replace(base,std::string::npos,".spotCosCutoff"),m_cutoffAngle);
 
   }
   else
   {
     // turn light off by setting 0 values
-    shader->setShaderParam4f(_uniformName+".position",0,0,0,float(m_lightMode));
-    shader->setShaderParam4f(_uniformName+".ambient",0,0,0,0);
-    shader->setShaderParam4f(_uniformName+".diffuse",0,0,0,0);
-    shader->setShaderParam4f(_uniformName+".specular",0,0,0,0);
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".position"),0,0,0,float(m_lightMode));
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".ambient"),0,0,0,0);
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".diffuse"),0,0,0,0);
+    shader->setShaderParam4f(name.replace(base,std::string::npos,".specular"),0,0,0,0);
   }
 }
 
@@ -121,11 +121,16 @@ std::cout<<"Load of "<<_fname <<" not yet implemented\n";
 
 
 void Material::loadToShader(
-                            std::string _uniformName
+                            const std::string &_uniformName
                            )const
 {
 
   ShaderLib *shader=ngl::ShaderLib::instance();
+  // each uniform name is built in the same string, reserved for the longest suffix so there is one allocation
+  std::string name;
+  name.reserve(_uniformName.size()+32);
+  name.append(_uniformName);
+  std::string::size_type base=name.size();
   /*
   so if we use one of our standard shaders for NGL we can load these values
   /// struct Material
@@ -138,10 +143,10 @@ void Material::loadToShader(
   */
 
 
-  shader->setShaderParam4f(_uniformName+".ambient",m_ambient.m_r,m_ambient.m_g,m_ambient.m_b,m_ambient.m_a);
-  shader->setShaderParam4f(_uniformName+".diffuse",m_diffuse.m_r,m_diffuse.m_g,m_diffuse.m_b,m_diffuse.m_a);
-  shader->setShaderParam4f(_uniformName+".specular",m_specular.m_r,m_specular.m_g,m_specular.m_b,m_specular.m_a);
-  shader->setShaderParam1f(_uniformName+".shininess", m_specularExponent);
+  shader->setShaderParam4f(name.replace(base,std::string::npos,".ambient"),m_ambient.m_r,m_ambient.m_g,m_ambient.m_b,m_ambient.m_a);
+  shader->setShaderParam4f(name.replace(base,std::string::npos,".diffuse"),m_diffuse.m_r,m_diffuse.m_g,m_diffuse.m_b,m_diffuse.m_a);
+  shader->setShaderParam4f(name.replace(base,std::string::npos,".specular"),m_specular.m_r,m_specular.m_g,m_specular.m_b,m_specular.m_a);
+  shader->setShaderParam1f(name.replace(base,std::string::npos,".shininess"), m_specularExponent);
 
  // std::cout<<"block id = "<<blockID<<"\n";
 
@@ -0,0 +1,133 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "MemoryMappedFile.h"
+#include <algorithm>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MemoryMappedFile.cpp
+/// @brief implementation files for MemoryMappedFile class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+MemoryMappedFile::MemoryMappedFile()
+{
+  m_data=0;
+  m_size=0;
+  m_open=false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MemoryMappedFile::MemoryMappedFile(
+                                   const std::string &_fname,
+                                   ACCESSHINT _hint
+                                  )
+{
+  m_data=0;
+  m_size=0;
+  m_open=false;
+  open(_fname,_hint);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MemoryMappedFile::~MemoryMappedFile()
+{
+  close();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MemoryMappedFile::open(
+                            const std::string &_fname,
+                            ACCESSHINT _hint
+                           )
+{
+  close();
+  int fd=::open(_fname.c_str(),O_RDONLY);
+  if(fd == -1)
+  {
+    std::cerr<<"FILE NOT FOUND !!!! "<<_fname<<"\n";
+    return false;
+  }
+  struct stat info;
+  if(fstat(fd,&info) == -1)
+  {
+    std::cerr<<"unable to stat file "<<_fname<<"\n";
+    ::close(fd);
+    return false;
+  }
+  m_size=static_cast<size_t>(info.st_size);
+  // mmap of zero bytes is an error, an empty file is still a valid (empty) file
+  if(m_size !=0)
+  {
+    void *ptr=mmap(0,m_size,PROT_READ,MAP_PRIVATE,fd,0);
+    if(ptr == MAP_FAILED)
+    {
+      std::cerr<<"unable to map file "<<_fname<<"\n";
+      ::close(fd);
+      m_size=0;
+      return false;
+    }
+    m_data=static_cast<const char *>(ptr);
+    switch(_hint)
+    {
+      case SEQUENTIAL : madvise(ptr,m_size,MADV_SEQUENTIAL); break;
+      case RANDOM : madvise(ptr,m_size,MADV_RANDOM); break;
+      default : break;
+    }
+  }
+  // the mapping holds its own reference to the file so we can close the descriptor now
+  ::close(fd);
+  m_open=true;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MemoryMappedFile::close()
+{
+  if(m_data !=0)
+  {
+    munmap(const_cast<char *>(m_data),m_size);
+  }
+  m_data=0;
+  m_size=0;
+  m_open=false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MemoryMappedFile::willNeed(
+                                size_t _offset,
+                                size_t _size
+                               ) const
+{
+  if(m_data == 0 || _offset >= m_size)
+  {
+    return;
+  }
+  _size=std::min(_size,m_size-_offset);
+  // madvise needs a page aligned start
+  size_t page=static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t start=_offset/page*page;
+  madvise(const_cast<char *>(m_data)+start,_offset+_size-start,MADV_WILLNEED);
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
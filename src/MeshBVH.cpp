@@ -0,0 +1,751 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "MeshBVH.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshBVH.cpp
+/// @brief implementation files for MeshBVH class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+// the number of SAH bins per axis
+static const unsigned int s_numBins=16;
+// the most packets in a leaf
+static const unsigned int s_maxLeafPackets=4;
+// below this depth SAH splits are used, after it the triangles are split in half so the depth (and the
+// traversal stack) is bounded however bad the input is
+static const unsigned int s_maxSAHDepth=48;
+static const unsigned int s_stackSize=128;
+
+//----------------------------------------------------------------------------------------------------------------------
+// 4 floats operated on together, gcc makes these NEON / SSE registers when the target has them and
+// splits them into scalar code when it doesn't
+typedef float float4 __attribute__ ((vector_size(16)));
+
+static inline float4 load4(
+                           const float *_p
+                          )
+{
+  // the packets are only 4 byte aligned in a vector so copy rather than cast
+  float4 v;
+  memcpy(&v,_p,sizeof(float4));
+  return v;
+}
+
+static inline float4 splat4(
+                            float _f
+                           )
+{
+  float4 v={_f,_f,_f,_f};
+  return v;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// orders build triangles by their centroid on one axis
+struct CentroidLess
+{
+  CentroidLess(int _axis) : m_axis(_axis){}
+  template <class T> bool operator()(const T &_a, const T &_b) const
+  {
+    return _a.m_centroid[m_axis] < _b.m_centroid[m_axis];
+  }
+  int m_axis;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// the surface area of a box
+static inline float boxArea(
+                            const Vec3 &_min,
+                            const Vec3 &_max
+                           )
+{
+  float dx=_max.m_x-_min.m_x;
+  float dy=_max.m_y-_min.m_y;
+  float dz=_max.m_z-_min.m_z;
+  return 2.0f*(dx*dy+dy*dz+dz*dx);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// grow a box to include another box
+static inline void growBox(
+                           Vec3 &io_min,
+                           Vec3 &io_max,
+                           const Vec3 &_min,
+                           const Vec3 &_max
+                          )
+{
+  io_min.m_x=std::min(io_min.m_x,_min.m_x); io_max.m_x=std::max(io_max.m_x,_max.m_x);
+  io_min.m_y=std::min(io_min.m_y,_min.m_y); io_max.m_y=std::max(io_max.m_y,_max.m_y);
+  io_min.m_z=std::min(io_min.m_z,_min.m_z); io_max.m_z=std::max(io_max.m_z,_max.m_z);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// an empty box which any growBox will replace
+static inline void emptyBox(
+                            Vec3 &o_min,
+                            Vec3 &o_max
+                           )
+{
+  o_min.set(1e30f,1e30f,1e30f);
+  o_max.set(-1e30f,-1e30f,-1e30f);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the packets needed for _n triangles, the SAH counts packets as that is what the leaves test
+static inline unsigned int packetCount(
+                                       size_t _n
+                                      )
+{
+  return (_n+3)/4;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the entry distance of a ray into a node, the ray misses if this is larger than _maxT
+static inline float rayBox(
+                           const BVHNode &_node,
+                           const float *_origin,
+                           const float *_invDir,
+                           float _maxT
+                          )
+{
+  float tmin=0.0f;
+  float tmax=_maxT;
+  for(int i=0; i<3; ++i)
+  {
+    float t0=(_node.m_min[i]-_origin[i])*_invDir[i];
+    float t1=(_node.m_max[i]-_origin[i])*_invDir[i];
+    if(t0 > t1)
+    {
+      std::swap(t0,t1);
+    }
+    tmin=std::max(tmin,t0);
+    tmax=std::min(tmax,t1);
+  }
+  return tmin <= tmax ? tmin : 1e30f;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the squared distance from a point to a node, 0 if inside
+static inline float pointBoxDistance2(
+                                      const BVHNode &_node,
+                                      const float *_p
+                                     )
+{
+  float d2=0.0f;
+  for(int i=0; i<3; ++i)
+  {
+    float d=std::max(std::max(_node.m_min[i]-_p[i],_p[i]-_node.m_max[i]),0.0f);
+    d2+=d*d;
+  }
+  return d2;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// divide guarding against the zero area triangles a mesh may have
+static inline float safeDivide(
+                               float _a,
+                               float _b
+                              )
+{
+  return _b !=0.0f ? _a/_b : 0.0f;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the closest point on a triangle by Voronoi regions, from Ericson "Real-Time Collision Detection" 5.1.5.
+// Lane _l of the packet is used and the squared distance returned with the barycentric cords in o_u,o_v
+static float closestOnTriangle(
+                               const BVHPacket &_packet,
+                               int _l,
+                               const float *_p,
+                               float &o_u,
+                               float &o_v
+                              )
+{
+  float ab[3],ac[3],ap[3];
+  for(int i=0; i<3; ++i)
+  {
+    ab[i]=_packet.m_e1[i][_l];
+    ac[i]=_packet.m_e2[i][_l];
+    ap[i]=_p[i]-_packet.m_v0[i][_l];
+  }
+  float d1=ab[0]*ap[0]+ab[1]*ap[1]+ab[2]*ap[2];
+  float d2=ac[0]*ap[0]+ac[1]*ap[1]+ac[2]*ap[2];
+  // b-p and c-p are written relative to a
+  float d3=d1-(ab[0]*ab[0]+ab[1]*ab[1]+ab[2]*ab[2]);
+  float d4=d2-(ac[0]*ab[0]+ac[1]*ab[1]+ac[2]*ab[2]);
+  float d5=d1-(ab[0]*ac[0]+ab[1]*ac[1]+ab[2]*ac[2]);
+  float d6=d2-(ac[0]*ac[0]+ac[1]*ac[1]+ac[2]*ac[2]);
+  float va=d3*d6-d5*d4;
+  float vb=d5*d2-d1*d6;
+  float vc=d1*d4-d3*d2;
+  if(d1 <= 0.0f && d2 <= 0.0f)
+  {
+    o_u=0.0f; o_v=0.0f;
+  }
+  else if(d3 >= 0.0f && d4 <= d3)
+  {
+    o_u=1.0f; o_v=0.0f;
+  }
+  else if(d6 >= 0.0f && d5 <= d6)
+  {
+    o_u=0.0f; o_v=1.0f;
+  }
+  else if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+  {
+    o_u=safeDivide(d1,d1-d3); o_v=0.0f;
+  }
+  else if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+  {
+    o_u=0.0f; o_v=safeDivide(d2,d2-d6);
+  }
+  else if(va <= 0.0f && d4-d3 >= 0.0f && d5-d6 >= 0.0f)
+  {
+    float w=safeDivide(d4-d3,(d4-d3)+(d5-d6));
+    o_u=1.0f-w; o_v=w;
+  }
+  else
+  {
+    float sum=va+vb+vc;
+    o_u=safeDivide(vb,sum); o_v=safeDivide(vc,sum);
+  }
+  float d2sum=0.0f;
+  for(int i=0; i<3; ++i)
+  {
+    float d=ap[i]-ab[i]*o_u-ac[i]*o_v;
+    d2sum+=d*d;
+  }
+  return d2sum;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+MeshBVH::MeshBVH()
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MeshBVH::clear()
+{
+  m_nodes.clear();
+  m_packets.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MeshBVH::build(
+                    const std::vector<Vec3> &_corners,
+                    const std::vector<GLuint> &_ids
+                   )
+{
+  clear();
+  size_t numTris=_ids.size();
+  if(numTris == 0 || _corners.size() != numTris*3)
+  {
+    return;
+  }
+  std::vector<BuildTriangle> tris(numTris);
+  for(size_t i=0; i<numTris; ++i)
+  {
+    BuildTriangle &t=tris[i];
+    emptyBox(t.m_min,t.m_max);
+    for(int c=0; c<3; ++c)
+    {
+      growBox(t.m_min,t.m_max,_corners[i*3+c],_corners[i*3+c]);
+    }
+    t.m_centroid.set((t.m_min.m_x+t.m_max.m_x)*0.5f,(t.m_min.m_y+t.m_max.m_y)*0.5f,(t.m_min.m_z+t.m_max.m_z)*0.5f);
+    t.m_index=i;
+  }
+  // a binary tree with n leaves has 2n-1 nodes
+  m_nodes.reserve(2*packetCount(numTris));
+  m_packets.reserve(packetCount(numTris)*2);
+  m_nodes.resize(1);
+  buildNode(0,tris,0,numTris,0,_corners,_ids);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MeshBVH::buildNode(
+                        size_t _node,
+                        std::vector<BuildTriangle> &io_tris,
+                        size_t _begin,
+                        size_t _end,
+                        unsigned int _depth,
+                        const std::vector<Vec3> &_corners,
+                        const std::vector<GLuint> &_ids
+                       )
+{
+  size_t n=_end-_begin;
+  Vec3 bmin,bmax,cmin,cmax;
+  emptyBox(bmin,bmax);
+  emptyBox(cmin,cmax);
+  for(size_t i=_begin; i<_end; ++i)
+  {
+    growBox(bmin,bmax,io_tris[i].m_min,io_tris[i].m_max);
+    growBox(cmin,cmax,io_tris[i].m_centroid,io_tris[i].m_centroid);
+  }
+  {
+    BVHNode &node=m_nodes[_node];
+    node.m_min[0]=bmin.m_x; node.m_min[1]=bmin.m_y; node.m_min[2]=bmin.m_z;
+    node.m_max[0]=bmax.m_x; node.m_max[1]=bmax.m_y; node.m_max[2]=bmax.m_z;
+  }
+
+  // look for the cheapest binned SAH split, the cost of a leaf or split is in packet tests
+  // with a node test costing the same as a packet
+  float leafCost=boxArea(bmin,bmax)*packetCount(n);
+  float bestCost=1e30f;
+  int bestAxis=-1;
+  unsigned int bestBin=0;
+  float cExtent[3]={cmax.m_x-cmin.m_x,cmax.m_y-cmin.m_y,cmax.m_z-cmin.m_z};
+  float cStart[3]={cmin.m_x,cmin.m_y,cmin.m_z};
+  // a deep branch means the SAH isn't finding good splits so just halve it from then on
+  if(n > 4 && _depth < s_maxSAHDepth)
+  {
+    for(int axis=0; axis<3; ++axis)
+    {
+      if(cExtent[axis] <= 0.0f)
+      {
+        continue;
+      }
+      float scale=s_numBins/cExtent[axis];
+      unsigned int count[s_numBins]={0};
+      Vec3 binMin[s_numBins],binMax[s_numBins];
+      for(unsigned int b=0; b<s_numBins; ++b)
+      {
+        emptyBox(binMin[b],binMax[b]);
+      }
+      for(size_t i=_begin; i<_end; ++i)
+      {
+        unsigned int b=std::min(s_numBins-1,(unsigned int)((io_tris[i].m_centroid[axis]-cStart[axis])*scale));
+        ++count[b];
+        growBox(binMin[b],binMax[b],io_tris[i].m_min,io_tris[i].m_max);
+      }
+      // sweep from the right to get the cost of each right hand side then from the left
+      float rightArea[s_numBins];
+      unsigned int rightCount[s_numBins];
+      Vec3 rmin,rmax;
+      emptyBox(rmin,rmax);
+      unsigned int rc=0;
+      for(unsigned int b=s_numBins-1; b>0; --b)
+      {
+        rc+=count[b];
+        if(count[b] !=0)
+        {
+          growBox(rmin,rmax,binMin[b],binMax[b]);
+        }
+        rightCount[b]=rc;
+        rightArea[b]= rc !=0 ? boxArea(rmin,rmax) : 0.0f;
+      }
+      Vec3 lmin,lmax;
+      emptyBox(lmin,lmax);
+      unsigned int lc=0;
+      for(unsigned int b=1; b<s_numBins; ++b)
+      {
+        lc+=count[b-1];
+        if(count[b-1] !=0)
+        {
+          growBox(lmin,lmax,binMin[b-1],binMax[b-1]);
+        }
+        if(lc == 0 || rightCount[b] == 0)
+        {
+          continue;
+        }
+        float cost=boxArea(lmin,lmax)*packetCount(lc)+rightArea[b]*packetCount(rightCount[b]);
+        if(cost < bestCost)
+        {
+          bestCost=cost;
+          bestAxis=axis;
+          bestBin=b;
+        }
+      }
+    }
+    bestCost+=boxArea(bmin,bmax);
+  }
+
+  size_t mid=_begin;
+  if(bestAxis >=0 && (bestCost < leafCost || n > s_maxLeafPackets*4))
+  {
+    float scale=s_numBins/cExtent[bestAxis];
+    for(size_t i=_begin; i<_end; ++i)
+    {
+      unsigned int b=std::min(s_numBins-1,(unsigned int)((io_tris[i].m_centroid[bestAxis]-cStart[bestAxis])*scale));
+      if(b < bestBin)
+      {
+        std::swap(io_tris[i],io_tris[mid++]);
+      }
+    }
+  }
+  else if(n > s_maxLeafPackets*4)
+  {
+    // every centroid is in the same place or the tree is too deep so split by count along the longest axis
+    int axis=0;
+    Vec3 extent=bmax-bmin;
+    if(extent.m_y > extent[axis]) axis=1;
+    if(extent.m_z > extent[axis]) axis=2;
+    mid=_begin+n/2;
+    std::nth_element(io_tris.begin()+_begin,io_tris.begin()+mid,io_tris.begin()+_end,CentroidLess(axis));
+  }
+
+  if(mid == _begin || mid == _end)
+  {
+    // make a leaf, the triangles are copied into packets of 4 with the unused lanes empty
+    BVHNode &node=m_nodes[_node];
+    node.m_first=m_packets.size();
+    node.m_count=packetCount(n);
+    for(size_t i=0; i<n; i+=4)
+    {
+      m_packets.push_back(BVHPacket());
+      BVHPacket &p=m_packets.back();
+      memset(&p,0,sizeof(BVHPacket));
+      for(unsigned int l=0; l<4; ++l)
+      {
+        if(i+l >= n)
+        {
+          p.m_id[l]=NOID;
+          continue;
+        }
+        GLuint t=io_tris[_begin+i+l].m_index;
+        const Vec3 &v0=_corners[t*3];
+        const Vec3 &v1=_corners[t*3+1];
+        const Vec3 &v2=_corners[t*3+2];
+        for(int c=0; c<3; ++c)
+        {
+          p.m_v0[c][l]=v0[c];
+          p.m_e1[c][l]=v1[c]-v0[c];
+          p.m_e2[c][l]=v2[c]-v0[c];
+        }
+        p.m_id[l]=_ids[t];
+      }
+    }
+    return;
+  }
+  // the children are made next to each other so only the first is stored
+  size_t first=m_nodes.size();
+  m_nodes.resize(first+2);
+  m_nodes[_node].m_first=first;
+  m_nodes[_node].m_count=0;
+  buildNode(first,io_tris,_begin,mid,_depth+1,_corners,_ids);
+  buildNode(first+1,io_tris,mid,_end,_depth+1,_corners,_ids);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MeshBVH::intersectRay(
+                           const Vec3 &_origin,
+                           const Vec3 &_dir,
+                           BVHHit &o_hit,
+                           Real _maxT
+                          ) const
+{
+  if(isBuilt() == false)
+  {
+    return false;
+  }
+  float origin[3]={_origin.m_x,_origin.m_y,_origin.m_z};
+  float dir[3]={_dir.m_x,_dir.m_y,_dir.m_z};
+  float invDir[3];
+  for(int i=0; i<3; ++i)
+  {
+    // a tiny value rather than 0 keeps the slab test free of 0*inf
+    invDir[i]=1.0f/(fabs(dir[i]) > 1e-20f ? dir[i] : 1e-20f);
+  }
+  const float4 ox=splat4(origin[0]), oy=splat4(origin[1]), oz=splat4(origin[2]);
+  const float4 dx=splat4(dir[0]), dy=splat4(dir[1]), dz=splat4(dir[2]);
+
+  float best=_maxT;
+  bool hit=false;
+  uint32_t stack[s_stackSize];
+  float stackT[s_stackSize];
+  unsigned int top=0;
+  if(rayBox(m_nodes[0],origin,invDir,best) < best)
+  {
+    stack[top]=0; stackT[top++]=0.0f;
+  }
+  while(top > 0)
+  {
+    --top;
+    if(stackT[top] >= best)
+    {
+      continue;
+    }
+    const BVHNode &node=m_nodes[stack[top]];
+    if(node.m_count == 0)
+    {
+      float t0=rayBox(m_nodes[node.m_first],origin,invDir,best);
+      float t1=rayBox(m_nodes[node.m_first+1],origin,invDir,best);
+      uint32_t c0=node.m_first, c1=node.m_first+1;
+      if(t1 < t0)
+      {
+        std::swap(t0,t1);
+        std::swap(c0,c1);
+      }
+      // the far child goes on first so the near one is visited next
+      if(t1 < best) {stack[top]=c1; stackT[top++]=t1;}
+      if(t0 < best) {stack[top]=c0; stackT[top++]=t0;}
+      continue;
+    }
+    for(uint32_t p=node.m_first; p<node.m_first+node.m_count; ++p)
+    {
+      // Moller Trumbore on the 4 triangles at once
+      const BVHPacket &packet=m_packets[p];
+      float4 e1x=load4(packet.m_e1[0]), e1y=load4(packet.m_e1[1]), e1z=load4(packet.m_e1[2]);
+      float4 e2x=load4(packet.m_e2[0]), e2y=load4(packet.m_e2[1]), e2z=load4(packet.m_e2[2]);
+      float4 px=dy*e2z-dz*e2y;
+      float4 py=dz*e2x-dx*e2z;
+      float4 pz=dx*e2y-dy*e2x;
+      float4 det=e1x*px+e1y*py+e1z*pz;
+      float4 tx=ox-load4(packet.m_v0[0]), ty=oy-load4(packet.m_v0[1]), tz=oz-load4(packet.m_v0[2]);
+      float4 qx=ty*e1z-tz*e1y;
+      float4 qy=tz*e1x-tx*e1z;
+      float4 qz=tx*e1y-ty*e1x;
+      float4 u=tx*px+ty*py+tz*pz;
+      float4 v=dx*qx+dy*qy+dz*qz;
+      float4 t=e2x*qx+e2y*qy+e2z*qz;
+      // the divide is left to the lanes that pass so a zero det (and the empty lanes) cost nothing
+      float dets[4],us[4],vs[4],ts[4];
+      memcpy(dets,&det,sizeof(dets));
+      memcpy(us,&u,sizeof(us));
+      memcpy(vs,&v,sizeof(vs));
+      memcpy(ts,&t,sizeof(ts));
+      for(int l=0; l<4; ++l)
+      {
+        if(fabs(dets[l]) < 1e-12f)
+        {
+          continue;
+        }
+        float inv=1.0f/dets[l];
+        float lu=us[l]*inv;
+        float lv=vs[l]*inv;
+        float lt=ts[l]*inv;
+        if(lu >= 0.0f && lv >= 0.0f && lu+lv <= 1.0f && lt >= 0.0f && lt < best)
+        {
+          best=lt;
+          hit=true;
+          o_hit.m_t=lt;
+          o_hit.m_u=lu;
+          o_hit.m_v=lv;
+          o_hit.m_id=packet.m_id[l];
+        }
+      }
+    }
+  }
+  if(hit == true)
+  {
+    o_hit.m_point.set(origin[0]+dir[0]*best,origin[1]+dir[1]*best,origin[2]+dir[2]*best);
+  }
+  return hit;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MeshBVH::closestPoint(
+                           const Vec3 &_point,
+                           BVHHit &o_hit,
+                           Real _maxDistance
+                          ) const
+{
+  if(isBuilt() == false)
+  {
+    return false;
+  }
+  float p[3]={_point.m_x,_point.m_y,_point.m_z};
+  float best2=_maxDistance*_maxDistance;
+  bool found=false;
+  const BVHPacket *bestPacket=0;
+  int bestLane=0;
+  uint32_t stack[s_stackSize];
+  float stackD2[s_stackSize];
+  unsigned int top=0;
+  stack[top]=0; stackD2[top++]=pointBoxDistance2(m_nodes[0],p);
+  while(top > 0)
+  {
+    --top;
+    if(stackD2[top] >= best2)
+    {
+      continue;
+    }
+    const BVHNode &node=m_nodes[stack[top]];
+    if(node.m_count == 0)
+    {
+      float d0=pointBoxDistance2(m_nodes[node.m_first],p);
+      float d1=pointBoxDistance2(m_nodes[node.m_first+1],p);
+      uint32_t c0=node.m_first, c1=node.m_first+1;
+      if(d1 < d0)
+      {
+        std::swap(d0,d1);
+        std::swap(c0,c1);
+      }
+      if(d1 < best2) {stack[top]=c1; stackD2[top++]=d1;}
+      if(d0 < best2) {stack[top]=c0; stackD2[top++]=d0;}
+      continue;
+    }
+    for(uint32_t pk=node.m_first; pk<node.m_first+node.m_count; ++pk)
+    {
+      const BVHPacket &packet=m_packets[pk];
+      for(int l=0; l<4 && packet.m_id[l] != NOID; ++l)
+      {
+        float u,v;
+        float d2=closestOnTriangle(packet,l,p,u,v);
+        if(d2 < best2)
+        {
+          best2=d2;
+          found=true;
+          bestPacket=&packet;
+          bestLane=l;
+          o_hit.m_u=u;
+          o_hit.m_v=v;
+        }
+      }
+    }
+  }
+  if(found == true)
+  {
+    const BVHPacket &packet=*bestPacket;
+    int l=bestLane;
+    o_hit.m_t=sqrtf(best2);
+    o_hit.m_id=packet.m_id[l];
+    o_hit.m_point.set(
+                      packet.m_v0[0][l]+packet.m_e1[0][l]*o_hit.m_u+packet.m_e2[0][l]*o_hit.m_v,
+                      packet.m_v0[1][l]+packet.m_e1[1][l]*o_hit.m_u+packet.m_e2[1][l]*o_hit.m_v,
+                      packet.m_v0[2][l]+packet.m_e1[2][l]*o_hit.m_u+packet.m_e2[2][l]*o_hit.m_v
+                     );
+  }
+  return found;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MeshBVH::sphereOverlap(
+                            const Vec3 &_center,
+                            Real _radius,
+                            std::vector<GLuint> &o_ids
+                           ) const
+{
+  o_ids.clear();
+  if(isBuilt() == false)
+  {
+    return;
+  }
+  float p[3]={_center.m_x,_center.m_y,_center.m_z};
+  float r2=_radius*_radius;
+  uint32_t stack[s_stackSize];
+  unsigned int top=0;
+  stack[top++]=0;
+  while(top > 0)
+  {
+    const BVHNode &node=m_nodes[stack[--top]];
+    if(pointBoxDistance2(node,p) > r2)
+    {
+      continue;
+    }
+    if(node.m_count == 0)
+    {
+      stack[top++]=node.m_first;
+      stack[top++]=node.m_first+1;
+      continue;
+    }
+    for(uint32_t pk=node.m_first; pk<node.m_first+node.m_count; ++pk)
+    {
+      const BVHPacket &packet=m_packets[pk];
+      for(int l=0; l<4 && packet.m_id[l] != NOID; ++l)
+      {
+        float u,v;
+        if(closestOnTriangle(packet,l,p,u,v) <= r2)
+        {
+          o_ids.push_back(packet.m_id[l]);
+        }
+      }
+    }
+  }
+  // a face split into several triangles may be found more than once
+  std::sort(o_ids.begin(),o_ids.end());
+  o_ids.erase(std::unique(o_ids.begin(),o_ids.end()),o_ids.end());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t MeshBVH::getDataSize() const
+{
+  return 4*sizeof(uint32_t)+m_nodes.size()*sizeof(BVHNode)+m_packets.size()*sizeof(BVHPacket);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void MeshBVH::write(
+                    std::ostream &io_stream
+                   ) const
+{
+  // the padding keeps the nodes on a 16 byte boundary
+  uint32_t counts[4]={(uint32_t)m_nodes.size(),(uint32_t)m_packets.size(),0,0};
+  io_stream.write(reinterpret_cast<const char *>(counts),sizeof(counts));
+  if(m_nodes.empty() == false)
+  {
+    io_stream.write(reinterpret_cast<const char *>(&m_nodes[0]),m_nodes.size()*sizeof(BVHNode));
+  }
+  if(m_packets.empty() == false)
+  {
+    io_stream.write(reinterpret_cast<const char *>(&m_packets[0]),m_packets.size()*sizeof(BVHPacket));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool MeshBVH::read(
+                   const unsigned char *_data,
+                   size_t _size
+                  )
+{
+  clear();
+  uint32_t counts[4];
+  if(_size < sizeof(counts))
+  {
+    return false;
+  }
+  memcpy(counts,_data,sizeof(counts));
+  uint64_t size=sizeof(counts)+uint64_t(counts[0])*sizeof(BVHNode)+uint64_t(counts[1])*sizeof(BVHPacket);
+  if(counts[0] == 0 || size > _size)
+  {
+    return false;
+  }
+  m_nodes.resize(counts[0]);
+  m_packets.resize(counts[1]);
+  memcpy(&m_nodes[0],_data+sizeof(counts),m_nodes.size()*sizeof(BVHNode));
+  if(m_packets.empty() == false)
+  {
+    memcpy(&m_packets[0],_data+sizeof(counts)+m_nodes.size()*sizeof(BVHNode),m_packets.size()*sizeof(BVHPacket));
+  }
+  // the queries trust the links so check them, the children must come after their parent so there are no loops.
+  // A traversal holds at most one node per level plus one on its fixed size stack so the depth is checked too,
+  // as parents come first the depth of every parent is final before its children are reached
+  std::vector<uint32_t> depth(m_nodes.size(),0);
+  for(size_t i=0; i<m_nodes.size(); ++i)
+  {
+    const BVHNode &node=m_nodes[i];
+    bool ok= node.m_count == 0 ?
+             node.m_first > i && uint64_t(node.m_first)+1 < m_nodes.size() && depth[i]+1 < s_stackSize :
+             node.m_count <= m_packets.size() && node.m_first <= m_packets.size()-node.m_count;
+    if(ok == false)
+    {
+      clear();
+      return false;
+    }
+    if(node.m_count == 0)
+    {
+      depth[node.m_first]=std::max(depth[node.m_first],depth[i]+1);
+      depth[node.m_first+1]=std::max(depth[node.m_first+1],depth[i]+1);
+    }
+  }
+  return true;
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
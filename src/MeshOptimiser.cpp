@@ -0,0 +1,382 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cmath>
+#include "MeshOptimiser.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshOptimiser.cpp
+/// @brief implementation of the triangle and vertex re-ordering functions
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+VertexCacheStats analyseVertexCache(
+                                    const std::vector<GLuint> &_indices,
+                                    size_t _numVerts,
+                                    unsigned int _cacheSize
+                                   )
+{
+  VertexCacheStats stats;
+  stats.m_misses=0;
+  // a FIFO cache, each vertex stores the "time" it was added and it is still in the cache if
+  // fewer than _cacheSize misses have happened since then
+  std::vector<unsigned int> added(_numVerts,0);
+  unsigned int time=_cacheSize+1;
+  for(size_t i=0; i<_indices.size(); ++i)
+  {
+    GLuint v=_indices[i];
+    if(time-added[v] > _cacheSize)
+    {
+      added[v]=time++;
+      ++stats.m_misses;
+    }
+  }
+  size_t numTris=_indices.size()/3;
+  stats.m_acmr= numTris !=0 ? float(stats.m_misses)/numTris : 0.0f;
+  stats.m_atvr= _numVerts !=0 ? float(stats.m_misses)/_numVerts : 0.0f;
+  return stats;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the size of the LRU cache used to score the vertices, the algorithm works well for any real cache size
+static const int s_maxCache=32;
+
+//----------------------------------------------------------------------------------------------------------------------
+// score a vertex on its position in the cache and how many triangles still use it, this is
+// the scoring function from Tom Forsyth's paper with the values he suggests
+static float vertexScore(
+                         int _cachePos,
+                         unsigned int _remaining
+                        )
+{
+  if(_remaining == 0)
+  {
+    // no triangles left so never pick this vertex again
+    return -1.0f;
+  }
+  float score=0.0f;
+  if(_cachePos >= 0)
+  {
+    if(_cachePos < 3)
+    {
+      // the vertices of the last triangle get a fixed score so we don't just make strips
+      score=0.75f;
+    }
+    else
+    {
+      score=powf(1.0f-float(_cachePos-3)/(s_maxCache-3),1.5f);
+    }
+  }
+  // boost vertices with few triangles left so we don't leave lone triangles behind
+  score+=2.0f*powf(float(_remaining),-0.5f);
+  return score;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void optimiseVertexCache(
+                         std::vector<GLuint> &io_indices,
+                         size_t _numVerts,
+                         std::vector<GLuint> *o_triangleOrder
+                        )
+{
+  size_t numTris=io_indices.size()/3;
+  if(numTris == 0)
+  {
+    if(o_triangleOrder !=0)
+    {
+      o_triangleOrder->clear();
+    }
+    return;
+  }
+  // build the vertex to triangle adjacency as one flat list, the used part of each vertex's list
+  // shrinks as its triangles are added
+  std::vector<GLuint> triStart(_numVerts+1,0);
+  for(size_t i=0; i<numTris*3; ++i)
+  {
+    ++triStart[io_indices[i]+1];
+  }
+  for(size_t v=0; v<_numVerts; ++v)
+  {
+    triStart[v+1]+=triStart[v];
+  }
+  std::vector<GLuint> remaining(_numVerts);
+  for(size_t v=0; v<_numVerts; ++v)
+  {
+    remaining[v]=triStart[v+1]-triStart[v];
+  }
+  std::vector<GLuint> vertTris(numTris*3);
+  {
+    std::vector<GLuint> fill(triStart.begin(),triStart.end()-1);
+    for(size_t i=0; i<numTris*3; ++i)
+    {
+      vertTris[fill[io_indices[i]]++]=i/3;
+    }
+  }
+  std::vector<int> cachePos(_numVerts,-1);
+  std::vector<float> vertScores(_numVerts);
+  for(size_t v=0; v<_numVerts; ++v)
+  {
+    vertScores[v]=vertexScore(-1,remaining[v]);
+  }
+  std::vector<float> triScores(numTris);
+  std::vector<bool> triAdded(numTris,false);
+  for(size_t t=0; t<numTris; ++t)
+  {
+    triScores[t]=vertScores[io_indices[t*3]]+vertScores[io_indices[t*3+1]]+vertScores[io_indices[t*3+2]];
+  }
+
+  std::vector<GLuint> newIndices(numTris*3);
+  std::vector<GLuint> order(numTris);
+  // the cache has room for the 3 new vertices pushing the oldest out
+  GLuint cache[s_maxCache+3];
+  GLuint newCache[s_maxCache+3];
+  int cacheSize=0;
+  int bestTri=std::max_element(triScores.begin(),triScores.end())-triScores.begin();
+  size_t scanPos=0;
+
+  for(size_t out=0; out<numTris; ++out)
+  {
+    if(bestTri < 0)
+    {
+      // nothing in the cache has triangles left so take the next one in the original order
+      while(triAdded[scanPos])
+      {
+        ++scanPos;
+      }
+      bestTri=scanPos;
+    }
+    triAdded[bestTri]=true;
+    order[out]=bestTri;
+    const GLuint *tri=&io_indices[bestTri*3];
+    // the triangle's vertices go to the front of the cache followed by the rest in their old order
+    int newSize=0;
+    for(int i=0; i<3; ++i)
+    {
+      GLuint v=tri[i];
+      newIndices[out*3+i]=v;
+      newCache[newSize++]=v;
+      // remove the triangle from the vertex's list of remaining triangles
+      GLuint *list=&vertTris[triStart[v]];
+      for(GLuint j=0; j<remaining[v]; ++j)
+      {
+        if(list[j] == GLuint(bestTri))
+        {
+          list[j]=list[remaining[v]-1];
+          break;
+        }
+      }
+      --remaining[v];
+    }
+    for(int i=0; i<cacheSize; ++i)
+    {
+      GLuint v=cache[i];
+      if(v!=tri[0] && v!=tri[1] && v!=tri[2])
+      {
+        newCache[newSize++]=v;
+      }
+    }
+    // re-score the vertices and their triangles, anything past s_maxCache has been pushed out
+    bestTri=-1;
+    float bestScore=-1.0f;
+    for(int i=0; i<newSize; ++i)
+    {
+      GLuint v=newCache[i];
+      cachePos[v]= i<s_maxCache ? i : -1;
+      float score=vertexScore(cachePos[v],remaining[v]);
+      float delta=score-vertScores[v];
+      vertScores[v]=score;
+      const GLuint *list=&vertTris[triStart[v]];
+      for(GLuint j=0; j<remaining[v]; ++j)
+      {
+        GLuint t=list[j];
+        triScores[t]+=delta;
+        if(i<s_maxCache && triScores[t] > bestScore)
+        {
+          bestScore=triScores[t];
+          bestTri=t;
+        }
+      }
+    }
+    cacheSize=std::min(newSize,s_maxCache);
+    std::copy(newCache,newCache+cacheSize,cache);
+  }
+  io_indices.swap(newIndices);
+  if(o_triangleOrder !=0)
+  {
+    o_triangleOrder->swap(order);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// used to sort the overdraw clusters
+struct OverdrawCluster
+{
+  size_t m_begin;
+  size_t m_end;
+  float m_sortKey;
+  // clusters facing out from the center are drawn first
+  bool operator<(const OverdrawCluster &_c) const {return m_sortKey > _c.m_sortKey;}
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+void optimiseOverdraw(
+                      std::vector<GLuint> &io_indices,
+                      const std::vector<Vec3> &_positions,
+                      float _threshold,
+                      std::vector<GLuint> *o_triangleOrder
+                     )
+{
+  size_t numTris=io_indices.size()/3;
+  if(o_triangleOrder !=0)
+  {
+    o_triangleOrder->resize(numTris);
+    for(size_t t=0; t<numTris; ++t)
+    {
+      (*o_triangleOrder)[t]=t;
+    }
+  }
+  if(numTris == 0)
+  {
+    return;
+  }
+  VertexCacheStats before=analyseVertexCache(io_indices,_positions.size());
+  // the cache is effectively empty when a triangle misses on all 3 vertices, splitting the list there
+  // doesn't lose any re-use so these are the cluster boundaries
+  std::vector<OverdrawCluster> clusters;
+  std::vector<unsigned int> added(_positions.size(),0);
+  const unsigned int cacheSize=16;
+  unsigned int time=cacheSize+1;
+  for(size_t t=0; t<numTris; ++t)
+  {
+    int misses=0;
+    for(int i=0; i<3; ++i)
+    {
+      GLuint v=io_indices[t*3+i];
+      if(time-added[v] > cacheSize)
+      {
+        added[v]=time++;
+        ++misses;
+      }
+    }
+    if(misses == 3 || t == 0)
+    {
+      OverdrawCluster c;
+      c.m_begin=t;
+      clusters.push_back(c);
+    }
+  }
+  // get the center of the mesh as the area weighted triangle centers
+  Vec3 meshCenter(0,0,0);
+  float meshArea=0.0f;
+  for(size_t c=0; c<clusters.size(); ++c)
+  {
+    clusters[c].m_end= c+1<clusters.size() ? clusters[c+1].m_begin : numTris;
+  }
+  std::vector<Vec3> clusterCenter(clusters.size(),Vec3(0,0,0));
+  std::vector<Vec3> clusterNormal(clusters.size(),Vec3(0,0,0));
+  for(size_t c=0; c<clusters.size(); ++c)
+  {
+    float area=0.0f;
+    for(size_t t=clusters[c].m_begin; t<clusters[c].m_end; ++t)
+    {
+      const Vec3 &p0=_positions[io_indices[t*3]];
+      const Vec3 &p1=_positions[io_indices[t*3+1]];
+      const Vec3 &p2=_positions[io_indices[t*3+2]];
+      // the cross product length is twice the area so this gives an area weighted normal
+      Vec3 n=(p1-p0).cross(p2-p0);
+      float a=n.length();
+      clusterNormal[c]+=n;
+      clusterCenter[c]+=(p0+p1+p2)*(a/3.0f);
+      area+=a;
+    }
+    meshCenter+=clusterCenter[c];
+    meshArea+=area;
+    if(area > 0.0f)
+    {
+      clusterCenter[c]/=area;
+    }
+  }
+  if(meshArea > 0.0f)
+  {
+    meshCenter/=meshArea;
+  }
+  for(size_t c=0; c<clusters.size(); ++c)
+  {
+    float len=clusterNormal[c].length();
+    clusters[c].m_sortKey= len > 0.0f ? (clusterCenter[c]-meshCenter).dot(clusterNormal[c])/len : 0.0f;
+  }
+  std::stable_sort(clusters.begin(),clusters.end());
+
+  std::vector<GLuint> newIndices(numTris*3);
+  std::vector<GLuint> order(numTris);
+  size_t out=0;
+  for(size_t c=0; c<clusters.size(); ++c)
+  {
+    for(size_t t=clusters[c].m_begin; t<clusters[c].m_end; ++t)
+    {
+      newIndices[out*3]=io_indices[t*3];
+      newIndices[out*3+1]=io_indices[t*3+1];
+      newIndices[out*3+2]=io_indices[t*3+2];
+      order[out++]=t;
+    }
+  }
+  VertexCacheStats after=analyseVertexCache(newIndices,_positions.size());
+  // only keep the new order if we haven't thrown away too much of the cache optimisation
+  if(after.m_acmr <= before.m_acmr*_threshold)
+  {
+    io_indices.swap(newIndices);
+    if(o_triangleOrder !=0)
+    {
+      o_triangleOrder->swap(order);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void optimiseVertexFetch(
+                         std::vector<GLuint> &io_indices,
+                         size_t _numVerts,
+                         std::vector<GLuint> &o_vertexOrder
+                        )
+{
+  static const GLuint s_unused=0xffffffff;
+  std::vector<GLuint> remap(_numVerts,s_unused);
+  o_vertexOrder.clear();
+  o_vertexOrder.reserve(_numVerts);
+  for(size_t i=0; i<io_indices.size(); ++i)
+  {
+    GLuint v=io_indices[i];
+    if(remap[v] == s_unused)
+    {
+      remap[v]=o_vertexOrder.size();
+      o_vertexOrder.push_back(v);
+    }
+    io_indices[i]=remap[v];
+  }
+  // keep any vertices not used by a triangle at the end so the vertex count doesn't change
+  for(size_t v=0; v<_numVerts; ++v)
+  {
+    if(remap[v] == s_unused)
+    {
+      o_vertexOrder.push_back(v);
+    }
+  }
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,439 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <queue>
+#include <stdint.h>
+#include "MeshSimplifier.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshSimplifier.cpp
+/// @brief implementation of the quadric error mesh simplification
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+// the error quadric of a vertex, a symmetric 4x4 matrix stored as its upper triangle. Doubles are used
+// as the sums over large meshes lose too much precision in floats
+struct Quadric
+{
+  double m[10];
+  Quadric(){std::fill(m,m+10,0.0);}
+  void addPlane(double _a, double _b, double _c, double _d, double _weight)
+  {
+    m[0]+=_weight*_a*_a; m[1]+=_weight*_a*_b; m[2]+=_weight*_a*_c; m[3]+=_weight*_a*_d;
+    m[4]+=_weight*_b*_b; m[5]+=_weight*_b*_c; m[6]+=_weight*_b*_d;
+    m[7]+=_weight*_c*_c; m[8]+=_weight*_c*_d;
+    m[9]+=_weight*_d*_d;
+  }
+  void operator+=(const Quadric &_q)
+  {
+    for(int i=0; i<10; ++i)
+    {
+      m[i]+=_q.m[i];
+    }
+  }
+  // the sum of the weighted squared distances from _p to the planes
+  double error(const Vec3 &_p) const
+  {
+    double x=_p.m_x; double y=_p.m_y; double z=_p.m_z;
+    return m[0]*x*x + 2.0*m[1]*x*y + 2.0*m[2]*x*z + 2.0*m[3]*x
+         + m[4]*y*y + 2.0*m[5]*y*z + 2.0*m[6]*y
+         + m[7]*z*z + 2.0*m[8]*z
+         + m[9];
+  }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// a possible collapse of m_from onto m_to, m_stamp is the version of m_from when this was worked out
+// so old entries left in the queue can be ignored
+struct Collapse
+{
+  double m_cost;
+  GLuint m_from;
+  GLuint m_to;
+  unsigned int m_stamp;
+  // std::priority_queue gives the largest first so this is reversed to give the cheapest
+  bool operator<(const Collapse &_c) const {return m_cost > _c.m_cost;}
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// holds the working state of a simplification
+class QuadricSimplifier
+{
+public :
+  QuadricSimplifier(
+                    const std::vector<GLuint> &_indices,
+                    const std::vector<Vec3> &_positions,
+                    const std::vector<GLuint> &_positionIds
+                   );
+  void simplify(
+                const std::vector<size_t> &_targetTriangles,
+                std::vector< std::vector<GLuint> > &o_levels
+               );
+private :
+  void lockSeamsAndBoundaries(const std::vector<GLuint> &_positionIds);
+  void gatherNeighbours(GLuint _v, std::vector<GLuint> &o_neighbours) const;
+  void pushBestCollapse(GLuint _v);
+  bool isValid(GLuint _from, GLuint _to);
+  void collapse(GLuint _from, GLuint _to);
+
+  const std::vector<Vec3> &m_positions;
+  std::vector<GLuint> m_tris;
+  std::vector<bool> m_triAlive;
+  size_t m_liveTris;
+  std::vector< std::vector<GLuint> > m_vertTris;
+  std::vector<Quadric> m_quadrics;
+  std::vector<bool> m_locked;
+  std::vector<bool> m_removed;
+  std::vector<unsigned int> m_stamp;
+  std::priority_queue<Collapse> m_queue;
+  // scratch lists kept to save allocations
+  std::vector<GLuint> m_fromNeighbours;
+  std::vector<GLuint> m_toNeighbours;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+QuadricSimplifier::QuadricSimplifier(
+                                     const std::vector<GLuint> &_indices,
+                                     const std::vector<Vec3> &_positions,
+                                     const std::vector<GLuint> &_positionIds
+                                    ) :
+                                      m_positions(_positions),
+                                      m_tris(_indices)
+{
+  size_t numVerts=_positions.size();
+  size_t numTris=m_tris.size()/3;
+  m_triAlive.assign(numTris,true);
+  m_liveTris=numTris;
+  m_vertTris.resize(numVerts);
+  m_quadrics.resize(numVerts);
+  m_removed.assign(numVerts,false);
+  m_stamp.assign(numVerts,0);
+  for(size_t t=0; t<numTris; ++t)
+  {
+    const GLuint *tri=&m_tris[t*3];
+    if(tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+    {
+      // already degenerate so it will never be drawn
+      m_triAlive[t]=false;
+      --m_liveTris;
+      continue;
+    }
+    for(int i=0; i<3; ++i)
+    {
+      m_vertTris[tri[i]].push_back(t);
+    }
+    // the plane of the triangle weighted by its area
+    const Vec3 &p0=m_positions[tri[0]];
+    Vec3 n=(m_positions[tri[1]]-p0).cross(m_positions[tri[2]]-p0);
+    Real len=n.length();
+    if(len > 0.0f)
+    {
+      n/=len;
+      double d=-n.dot(p0);
+      for(int i=0; i<3; ++i)
+      {
+        m_quadrics[tri[i]].addPlane(n.m_x,n.m_y,n.m_z,d,len*0.5);
+      }
+    }
+  }
+  lockSeamsAndBoundaries(_positionIds);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void QuadricSimplifier::lockSeamsAndBoundaries(
+                                               const std::vector<GLuint> &_positionIds
+                                              )
+{
+  size_t numVerts=m_positions.size();
+  GLuint numIds=0;
+  for(size_t v=0; v<numVerts; ++v)
+  {
+    numIds=std::max(numIds,_positionIds[v]+1);
+  }
+  // a position used by more than one vertex has different normals or uvs on each side
+  std::vector<GLuint> idCount(numIds,0);
+  for(size_t v=0; v<numVerts; ++v)
+  {
+    ++idCount[_positionIds[v]];
+  }
+  // an edge used by only one triangle is on the boundary, the edges are found by position so a seam
+  // isn't seen as a boundary
+  std::vector<uint64_t> edges;
+  edges.reserve(m_liveTris*3);
+  for(size_t t=0; t<m_triAlive.size(); ++t)
+  {
+    if(m_triAlive[t] == false)
+    {
+      continue;
+    }
+    for(int i=0; i<3; ++i)
+    {
+      uint64_t a=_positionIds[m_tris[t*3+i]];
+      uint64_t b=_positionIds[m_tris[t*3+(i+1)%3]];
+      edges.push_back(a<b ? (a<<32)|b : (b<<32)|a);
+    }
+  }
+  std::sort(edges.begin(),edges.end());
+  std::vector<bool> boundary(numIds,false);
+  for(size_t i=0; i<edges.size(); )
+  {
+    size_t run=i+1;
+    while(run<edges.size() && edges[run] == edges[i])
+    {
+      ++run;
+    }
+    if(run-i == 1)
+    {
+      boundary[edges[i]>>32]=true;
+      boundary[edges[i]&0xffffffff]=true;
+    }
+    i=run;
+  }
+  m_locked.resize(numVerts);
+  for(size_t v=0; v<numVerts; ++v)
+  {
+    m_locked[v]= idCount[_positionIds[v]] > 1 || boundary[_positionIds[v]];
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void QuadricSimplifier::gatherNeighbours(
+                                         GLuint _v,
+                                         std::vector<GLuint> &o_neighbours
+                                        ) const
+{
+  o_neighbours.clear();
+  const std::vector<GLuint> &tris=m_vertTris[_v];
+  for(size_t i=0; i<tris.size(); ++i)
+  {
+    const GLuint *tri=&m_tris[tris[i]*3];
+    for(int k=0; k<3; ++k)
+    {
+      if(tri[k] != _v)
+      {
+        o_neighbours.push_back(tri[k]);
+      }
+    }
+  }
+  std::sort(o_neighbours.begin(),o_neighbours.end());
+  o_neighbours.erase(std::unique(o_neighbours.begin(),o_neighbours.end()),o_neighbours.end());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void QuadricSimplifier::pushBestCollapse(
+                                         GLuint _v
+                                        )
+{
+  if(m_locked[_v] == true || m_removed[_v] == true)
+  {
+    return;
+  }
+  gatherNeighbours(_v,m_fromNeighbours);
+  Collapse best;
+  best.m_cost=0.0;
+  best.m_from=_v;
+  best.m_to=_v;
+  best.m_stamp=m_stamp[_v];
+  for(size_t i=0; i<m_fromNeighbours.size(); ++i)
+  {
+    GLuint n=m_fromNeighbours[i];
+    Quadric q=m_quadrics[_v];
+    q+=m_quadrics[n];
+    double cost=q.error(m_positions[n]);
+    if(best.m_to == _v || cost < best.m_cost)
+    {
+      best.m_cost=cost;
+      best.m_to=n;
+    }
+  }
+  if(best.m_to != _v)
+  {
+    m_queue.push(best);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool QuadricSimplifier::isValid(
+                                GLuint _from,
+                                GLuint _to
+                               )
+{
+  // if the two vertices share more than the two vertices either side of their edge the collapse
+  // would pinch the surface into a non manifold edge
+  gatherNeighbours(_from,m_fromNeighbours);
+  gatherNeighbours(_to,m_toNeighbours);
+  size_t shared=0;
+  std::vector<GLuint>::const_iterator a=m_fromNeighbours.begin();
+  std::vector<GLuint>::const_iterator b=m_toNeighbours.begin();
+  while(a != m_fromNeighbours.end() && b != m_toNeighbours.end())
+  {
+    if(*a < *b) { ++a; }
+    else if(*b < *a) { ++b; }
+    else { ++shared; ++a; ++b; }
+  }
+  if(shared > 2)
+  {
+    return false;
+  }
+  // make sure none of the triangles which are kept flip over or become slivers
+  const Vec3 &to=m_positions[_to];
+  const std::vector<GLuint> &tris=m_vertTris[_from];
+  for(size_t i=0; i<tris.size(); ++i)
+  {
+    const GLuint *tri=&m_tris[tris[i]*3];
+    if(tri[0] == _to || tri[1] == _to || tri[2] == _to)
+    {
+      continue;
+    }
+    Vec3 p[3];
+    Vec3 q[3];
+    for(int k=0; k<3; ++k)
+    {
+      p[k]=m_positions[tri[k]];
+      q[k]= tri[k] == _from ? to : p[k];
+    }
+    Vec3 before=(p[1]-p[0]).cross(p[2]-p[0]);
+    Vec3 after=(q[1]-q[0]).cross(q[2]-q[0]);
+    Real lb=before.length();
+    Real la=after.length();
+    if(la == 0.0f || (lb > 0.0f && before.dot(after) < 0.2f*lb*la))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void QuadricSimplifier::collapse(
+                                 GLuint _from,
+                                 GLuint _to
+                                )
+{
+  m_quadrics[_to]+=m_quadrics[_from];
+  std::vector<GLuint> &fromTris=m_vertTris[_from];
+  for(size_t i=0; i<fromTris.size(); ++i)
+  {
+    GLuint t=fromTris[i];
+    GLuint *tri=&m_tris[t*3];
+    if(tri[0] == _to || tri[1] == _to || tri[2] == _to)
+    {
+      m_triAlive[t]=false;
+      --m_liveTris;
+    }
+    else
+    {
+      for(int k=0; k<3; ++k)
+      {
+        if(tri[k] == _from)
+        {
+          tri[k]=_to;
+        }
+      }
+      m_vertTris[_to].push_back(t);
+    }
+  }
+  fromTris.clear();
+  m_removed[_from]=true;
+  // remove the dead triangles from the lists of the vertices around the collapse and re-score them
+  gatherNeighbours(_to,m_toNeighbours);
+  m_toNeighbours.push_back(_to);
+  for(size_t i=0; i<m_toNeighbours.size(); ++i)
+  {
+    GLuint v=m_toNeighbours[i];
+    std::vector<GLuint> &tris=m_vertTris[v];
+    size_t kept=0;
+    for(size_t j=0; j<tris.size(); ++j)
+    {
+      if(m_triAlive[tris[j]] == true)
+      {
+        tris[kept++]=tris[j];
+      }
+    }
+    tris.resize(kept);
+  }
+  // pushBestCollapse uses m_fromNeighbours so m_toNeighbours is safe to walk
+  for(size_t i=0; i<m_toNeighbours.size(); ++i)
+  {
+    GLuint v=m_toNeighbours[i];
+    ++m_stamp[v];
+    pushBestCollapse(v);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void QuadricSimplifier::simplify(
+                                 const std::vector<size_t> &_targetTriangles,
+                                 std::vector< std::vector<GLuint> > &o_levels
+                                )
+{
+  o_levels.clear();
+  for(size_t v=0; v<m_positions.size(); ++v)
+  {
+    pushBestCollapse(v);
+  }
+  size_t previous=m_liveTris;
+  for(size_t level=0; level<_targetTriangles.size(); ++level)
+  {
+    while(m_liveTris > _targetTriangles[level] && m_queue.empty() == false)
+    {
+      Collapse c=m_queue.top();
+      m_queue.pop();
+      if(m_removed[c.m_from] == true || m_removed[c.m_to] == true || c.m_stamp != m_stamp[c.m_from])
+      {
+        continue;
+      }
+      if(isValid(c.m_from,c.m_to) == true)
+      {
+        collapse(c.m_from,c.m_to);
+      }
+    }
+    if(m_liveTris >= previous)
+    {
+      // nothing more can be removed
+      break;
+    }
+    previous=m_liveTris;
+    o_levels.push_back(std::vector<GLuint>());
+    std::vector<GLuint> &indices=o_levels.back();
+    indices.reserve(m_liveTris*3);
+    for(size_t t=0; t<m_triAlive.size(); ++t)
+    {
+      if(m_triAlive[t] == true)
+      {
+        indices.insert(indices.end(),&m_tris[t*3],&m_tris[t*3]+3);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void simplifyMesh(
+                  const std::vector<GLuint> &_indices,
+                  const std::vector<Vec3> &_positions,
+                  const std::vector<GLuint> &_positionIds,
+                  const std::vector<size_t> &_targetTriangles,
+                  std::vector< std::vector<GLuint> > &o_levels
+                 )
+{
+  QuadricSimplifier simplifier(_indices,_positions,_positionIds);
+  simplifier.simplify(_targetTriangles,o_levels);
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
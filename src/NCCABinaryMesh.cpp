@@ -0,0 +1,234 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include "NCCABinaryMesh.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file NCCABinaryMesh.cpp
+/// @brief implementation files for NCCABinaryMesh class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCABinaryMesh::init()
+{
+  // the rest of the mesh is set empty by the AbstractMesh ctor
+  m_dataPackType=GL_TRIANGLES;
+  memset(&m_header,0,sizeof(NCCABinaryMeshHeader));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+NCCABinaryMesh::NCCABinaryMesh()
+{
+  init();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+NCCABinaryMesh::NCCABinaryMesh(
+                               const std::string &_fname
+                              )
+{
+  init();
+  m_loaded=load(_fname);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+NCCABinaryMesh::NCCABinaryMesh(
+                               const std::string &_fname,
+                               const std::string &_texName
+                              )
+{
+  init();
+  m_loaded=load(_fname);
+  loadTexture(_texName);
+  m_texture=true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// swap the byte order of a 32 bit value, used to give a better error for files from the other endian
+static inline uint32_t swapBytes(
+                                 uint32_t _v
+                                )
+{
+  return (_v>>24) | ((_v>>8) & 0xff00) | ((_v<<8) & 0xff0000) | (_v<<24);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCABinaryMesh::load(
+                          const std::string &_fname,
+                          bool _calcBB,
+                          unsigned int _numThreads
+                         )
+{
+  // there is nothing to parse so the thread count is not needed
+  (void)_numThreads;
+  // the data is read once by glBufferData so tell the kernel to read ahead
+  if(m_file.open(_fname,MemoryMappedFile::SEQUENTIAL) == false)
+  {
+    return false;
+  }
+  if(m_file.size() < sizeof(NCCABinaryMeshHeader))
+  {
+    std::cerr<<_fname<<" is too small to be an NCCA binary mesh\n";
+    m_file.close();
+    return false;
+  }
+  // copy the header as the mapping is released once the VAO is created
+  memcpy(&m_header,m_file.data(),sizeof(NCCABinaryMeshHeader));
+  const NCCABinaryMeshHeader &h=m_header;
+  bool valid=true;
+  if(memcmp(h.m_magic,"ngl::bin",8) !=0)
+  {
+    std::cerr<<_fname<<" is not an NCCA binary mesh\n";
+    valid=false;
+  }
+  else if(h.m_endian == swapBytes(NCCABINARY_ENDIAN))
+  {
+    std::cerr<<_fname<<" was saved on a machine with a different byte order, please re-save it\n";
+    valid=false;
+  }
+  else if(h.m_endian != NCCABINARY_ENDIAN || h.m_version != NCCABINARY_VERSION)
+  {
+    // the original format had no version and stored the counts as longs
+    std::cerr<<_fname<<" is an unsupported NCCA binary mesh version, please re-save it\n";
+    valid=false;
+  }
+  else if(h.m_headerSize < sizeof(NCCABinaryMeshHeader) ||
+          h.m_vertexFormat != VERTDATA ||
+          h.m_vertexStride != 8*sizeof(GLfloat) ||
+          (h.m_indexType != GL_UNSIGNED_SHORT && h.m_indexType != GL_UNSIGNED_INT)
+         )
+  {
+    std::cerr<<_fname<<" has an unknown vertex or index format\n";
+    valid=false;
+  }
+  else
+  {
+    // make sure the blocks are inside the file and aligned so GL can read the floats directly
+    uint64_t indexSize= h.m_indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    uint64_t vertEnd=uint64_t(h.m_vertexOffset)+uint64_t(h.m_numVertices)*h.m_vertexStride;
+    uint64_t indexEnd=uint64_t(h.m_indexOffset)+uint64_t(h.m_numIndices)*indexSize;
+    if(vertEnd > m_file.size() || indexEnd > m_file.size() ||
+       h.m_vertexOffset % NCCABINARY_ALIGN !=0 || h.m_indexOffset % NCCABINARY_ALIGN !=0 ||
+       h.m_numVertices == 0)
+    {
+      std::cerr<<_fname<<" is truncated or corrupt\n";
+      valid=false;
+    }
+  }
+  if(valid == false)
+  {
+    m_file.close();
+    return false;
+  }
+
+  // only the packed GPU data is stored so the vert / face lists stay empty
+  m_nVerts=m_nNorm=m_nTex=m_nFaces=0;
+  m_indexSize=h.m_numVertices;
+  m_meshSize= h.m_numIndices !=0 ? h.m_numIndices : h.m_numVertices;
+  m_dataPackType=h.m_drawMode;
+  m_bufferPackSize=h.m_vertexStride/sizeof(GLfloat);
+  m_minX=h.m_min[0]; m_minY=h.m_min[1]; m_minZ=h.m_min[2];
+  m_maxX=h.m_max[0]; m_maxY=h.m_max[1]; m_maxZ=h.m_max[2];
+  m_center.set(h.m_center[0],h.m_center[1],h.m_center[2]);
+  m_sphereCenter.set(h.m_sphereCenter[0],h.m_sphereCenter[1],h.m_sphereCenter[2]);
+  m_sphereRadius=h.m_sphereRadius;
+  // the BVH is optional so a bad one is just ignored
+  m_bvh.clear();
+  if(h.m_bvhOffset !=0)
+  {
+    if(h.m_bvhOffset % NCCABINARY_ALIGN !=0 || uint64_t(h.m_bvhOffset)+h.m_bvhSize > m_file.size() ||
+       m_bvh.read(reinterpret_cast<const unsigned char *>(m_file.data()+h.m_bvhOffset),h.m_bvhSize) == false)
+    {
+      std::cerr<<_fname<<" has a corrupt BVH, picking queries won't work\n";
+    }
+  }
+  if(_calcBB == true)
+  {
+    if(m_ext !=0)
+    {
+      delete m_ext;
+    }
+    m_ext=new BBox(m_minX,m_maxX,m_minY,m_maxY,m_minZ,m_maxZ);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+VertexArrayObject * NCCABinaryMesh::createVAOFromFile(
+                                                      GLenum _drawMode
+                                                     ) const
+{
+  if(m_file.isOpen() == false)
+  {
+    std::cerr<<"no NCCA binary mesh mapped to create VAO from\n";
+    return 0;
+  }
+  const NCCABinaryMeshHeader &h=m_header;
+  // the blocks are passed straight from the mapping to GL so there is no intermediate copy
+  const GLfloat *verts=reinterpret_cast<const GLfloat *>(m_file.data()+h.m_vertexOffset);
+  unsigned int vertBytes=h.m_numVertices*h.m_vertexStride;
+
+  VertexArrayObject *vao=VertexArrayObject::createVOA(_drawMode);
+  vao->bind();
+  if(h.m_numIndices == 0)
+  {
+    vao->setData(vertBytes,*verts);
+  }
+  else if(h.m_indexType == GL_UNSIGNED_SHORT)
+  {
+    const GLushort *indices=reinterpret_cast<const GLushort *>(m_file.data()+h.m_indexOffset);
+    vao->setIndexedData(vertBytes,*verts,h.m_numIndices,*indices);
+  }
+  else
+  {
+    // split into 16 bit buffers if GL_OES_element_index_uint is not supported
+    const GLuint *indices=reinterpret_cast<const GLuint *>(m_file.data()+h.m_indexOffset);
+    vao->setIndexedDataAuto(h.m_vertexStride,h.m_numVertices,*verts,h.m_numIndices,*indices);
+  }
+  setVertDataAttributes(vao);
+  vao->setNumIndices(h.m_numIndices !=0 ? h.m_numIndices : h.m_numVertices);
+  vao->unbind();
+  return vao;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCABinaryMesh::createVAO(
+                               bool _indexed,
+                               VERTEXFORMAT _format
+                              )
+{
+  // the file decides the layout
+  (void)_indexed;
+  (void)_format;
+  if(m_vao == true)
+  {
+    std::cout<<"VAO exist so returning\n";
+    return;
+  }
+  m_vaoMesh=createVAOFromFile(m_header.m_drawMode);
+  if(m_vaoMesh == 0)
+  {
+    return;
+  }
+  m_vao=true;
+  // GL has its own copy now so release the pages
+  m_file.close();
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,970 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "NCCAPointBake.h"
+#include "ParseUtil.h"
+#include "AbstractMesh.h"
+#include "VertexArrayObject.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file NCCAPointBake.cpp
+/// @brief implementation files for NCCAPointBake class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+// m_stateFrame when m_state doesn't hold a frame
+static const unsigned int NOFRAME=0xffffffff;
+
+//----------------------------------------------------------------------------------------------------------------------
+NCCAPointBake::NCCAPointBake()
+{
+  m_data=0;
+  m_frameTable=0;
+  m_mesh=0;
+  m_positionBuffer=0;
+  m_directUpload=false;
+  clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+NCCAPointBake::NCCAPointBake(
+                             const std::string &_fileName
+                            )
+{
+  m_data=0;
+  m_frameTable=0;
+  m_mesh=0;
+  m_positionBuffer=0;
+  m_directUpload=false;
+  clear();
+  // a binary bake starts with the magic number, anything else is treated as xml
+  char magic[8]={0};
+  std::ifstream file(_fileName.c_str(),std::ios::in | std::ios::binary);
+  file.read(magic,8);
+  file.close();
+  if(memcmp(magic,"ngl::pbk",8) == 0)
+  {
+    loadBinaryPointBake(_fileName);
+  }
+  else
+  {
+    loadPointBake(_fileName);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+NCCAPointBake::~NCCAPointBake()
+{
+  clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCAPointBake::clear()
+{
+  m_frames.clear();
+  m_file.close();
+  m_data=0;
+  m_format=POINTBAKE_FLOAT;
+  m_frameTable=0;
+  m_state.clear();
+  m_previousState.clear();
+  m_nextState.clear();
+  m_hasPreviousState=false;
+  m_stateFrame=NOFRAME;
+  m_decoded.clear();
+  m_numFrames=0;
+  m_currFrame=0;
+  m_nVerts=0;
+  m_startFrame=0;
+  m_endFrame=0;
+  m_meshName.clear();
+  m_binFile=false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the offset of a quantised frame in the file
+static inline uint64_t frameOffset(
+                                   const NCCAPointBakeFrame &_entry
+                                  )
+{
+  return uint64_t(_entry.m_offsetLow) | (uint64_t(_entry.m_offsetHigh)<<32);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the size of a quantised frame of _n values
+static inline uint64_t frameSize(
+                                 uint32_t _type,
+                                 size_t _n
+                                )
+{
+  return _type == POINTBAKE_DELTA8 ? _n : _n*sizeof(uint16_t);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// decode one quantised frame of _n planar values into o_q, a delta is added to the prediction from the frame
+// before (_q) and the one before that (_previous, 0 after a key). The sums wrap so they are exact
+static void applyFrame(
+                       const NCCAPointBakeFrame &_entry,
+                       const char *_file,
+                       const uint16_t *_q,
+                       const uint16_t *_previous,
+                       uint16_t *o_q,
+                       size_t _n
+                      )
+{
+  const char *data=_file+frameOffset(_entry);
+  if(_entry.m_type == POINTBAKE_KEY)
+  {
+    memcpy(o_q,data,_n*sizeof(uint16_t));
+  }
+  else if(_entry.m_type == POINTBAKE_DELTA8)
+  {
+    const int8_t *delta=reinterpret_cast<const int8_t *>(data);
+    if(_previous == 0)
+    {
+      for(size_t i=0; i<_n; ++i)
+      {
+        o_q[i]=uint16_t(_q[i]+delta[i]);
+      }
+    }
+    else
+    {
+      for(size_t i=0; i<_n; ++i)
+      {
+        o_q[i]=uint16_t(2*_q[i]-_previous[i]+delta[i]);
+      }
+    }
+  }
+  else
+  {
+    const int16_t *delta=reinterpret_cast<const int16_t *>(data);
+    if(_previous == 0)
+    {
+      for(size_t i=0; i<_n; ++i)
+      {
+        o_q[i]=uint16_t(_q[i]+delta[i]);
+      }
+    }
+    else
+    {
+      for(size_t i=0; i<_n; ++i)
+      {
+        o_q[i]=uint16_t(2*_q[i]-_previous[i]+delta[i]);
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// turn planar quantised values into x,y,z, blending towards _next by _t if it is given
+static void dequantise(
+                       const uint16_t *_q,
+                       const uint16_t *_next,
+                       Real _t,
+                       const Real *_min,
+                       const Real *_scale,
+                       size_t _numVerts,
+                       Real *o_data
+                      )
+{
+  for(int c=0; c<3; ++c)
+  {
+    const uint16_t *q=_q+c*_numVerts;
+    const Real min=_min[c];
+    const Real scale=_scale[c];
+    Real *out=o_data+c;
+    if(_next == 0)
+    {
+      for(size_t i=0; i<_numVerts; ++i)
+      {
+        out[i*3]=min+scale*q[i];
+      }
+    }
+    else
+    {
+      const uint16_t *next=_next+c*_numVerts;
+      for(size_t i=0; i<_numVerts; ++i)
+      {
+        Real a=q[i];
+        out[i*3]=min+scale*(a+_t*(Real(next[i])-a));
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// write zeros so the next block starts on an NCCAPOINTBAKE_ALIGN boundary
+static void padToAlignment(
+                           std::ostream &io_file,
+                           uint64_t _written
+                          )
+{
+  static const char padding[NCCAPOINTBAKE_ALIGN]={0};
+  io_file.write(padding,(NCCAPOINTBAKE_ALIGN-_written%NCCAPOINTBAKE_ALIGN)%NCCAPOINTBAKE_ALIGN);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCAPointBake::fillHeader(
+                               NCCAPointBakeHeader &o_header,
+                               POINTBAKEFORMAT _format
+                              ) const
+{
+  memset(&o_header,0,sizeof(NCCAPointBakeHeader));
+  memcpy(o_header.m_magic,"ngl::pbk",8);
+  o_header.m_endian=NCCAPOINTBAKE_ENDIAN;
+  o_header.m_version=NCCAPOINTBAKE_VERSION;
+  o_header.m_headerSize=sizeof(NCCAPointBakeHeader);
+  o_header.m_numVerts=m_nVerts;
+  o_header.m_numFrames=m_numFrames;
+  o_header.m_startFrame=m_startFrame;
+  o_header.m_endFrame=m_endFrame;
+  o_header.m_nameSize=m_meshName.size();
+  o_header.m_format=_format;
+  uint32_t nameEnd=o_header.m_headerSize+o_header.m_nameSize;
+  o_header.m_dataOffset=(nameEnd+NCCAPOINTBAKE_ALIGN-1)/NCCAPOINTBAKE_ALIGN*NCCAPOINTBAKE_ALIGN;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// parse the integer text of an element, the element text starts at _p
+static unsigned int elementInt(
+                               const char *_p,
+                               const char *_end
+                              )
+{
+  int value=0;
+  parse::parseInt(_p,_end,value);
+  return value > 0 ? value : 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// parse the number="" attribute of a tag
+static bool numberAttribute(
+                            const parse::XmlTag &_tag,
+                            int &o_value
+                           )
+{
+  const char *begin;
+  const char *end;
+  return parse::xmlAttribute(_tag,"number",begin,end) && parse::parseInt(begin,end,o_value);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCAPointBake::loadPointBake(
+                                  const std::string &_fileName,
+                                  const std::string &_binaryName
+                                 )
+{
+  clear();
+  MemoryMappedFile xml;
+  if(xml.open(_fileName,MemoryMappedFile::SEQUENTIAL) == false)
+  {
+    return false;
+  }
+  // sizes from the header elements, the frames are allocated at the first <Frame> once they are known
+  unsigned int numFrames=0;
+  bool root=false;
+  bool sized=false;
+  bool converting= _binaryName.empty() == false;
+  size_t frameSize=0;
+  // the frame being read, either in m_frames or in frame when converting
+  Real *current=0;
+  int currentIndex=0;
+  std::vector<Real> frame;
+  std::vector<bool> written;
+  NCCAPointBakeHeader h;
+  std::fstream binary;
+
+  const char *p=xml.data();
+  const char *end=xml.end();
+  parse::XmlTag tag;
+  // each tag is handled as it is found so the file is read once from start to end
+  while(parse::nextTag(p,end,tag) == true)
+  {
+    if(tag.m_close == true)
+    {
+      if(converting == true && current !=0 && parse::isTag(tag,"Frame") == true)
+      {
+        // the frame is finished so write it and reuse the buffer for the next one
+        binary.seekp(h.m_dataOffset+uint64_t(currentIndex)*frameSize*sizeof(Real));
+        binary.write(reinterpret_cast<const char *>(current),frameSize*sizeof(Real));
+        written[currentIndex]=true;
+        current=0;
+      }
+      continue;
+    }
+    if(parse::isTag(tag,"NCCAPointBake") == true)
+    {
+      root=true;
+    }
+    else if(root == false)
+    {
+      continue;
+    }
+    else if(parse::isTag(tag,"Vertex") == true)
+    {
+      int index;
+      if(current !=0 && numberAttribute(tag,index) == true && index >= 0 && unsigned(index) < m_nVerts)
+      {
+        Real *v=current+index*3;
+        parse::parseReal(p,end,v[0]);
+        parse::parseReal(p,end,v[1]);
+        parse::parseReal(p,end,v[2]);
+      }
+    }
+    else if(parse::isTag(tag,"Frame") == true)
+    {
+      if(sized == false)
+      {
+        if(numFrames == 0 && m_endFrame >= m_startFrame)
+        {
+          numFrames=m_endFrame-m_startFrame+1;
+        }
+        if(m_nVerts == 0 || numFrames == 0)
+        {
+          std::cerr<<_fileName<<" has no verts or frames\n";
+          return false;
+        }
+        m_numFrames=numFrames;
+        frameSize=size_t(m_nVerts)*3;
+        if(converting == true)
+        {
+          binary.open(_binaryName.c_str(),std::ios::out | std::ios::binary);
+          if (!binary.is_open())
+          {
+            std::cerr<<"problems Opening File "<<_binaryName<<std::endl;
+            return false;
+          }
+          fillHeader(h,POINTBAKE_FLOAT);
+          binary.write(reinterpret_cast <const char *>(&h),sizeof(NCCAPointBakeHeader));
+          binary.write(m_meshName.data(),m_meshName.size());
+          padToAlignment(binary,h.m_headerSize+h.m_nameSize);
+          frame.resize(frameSize);
+          written.assign(m_numFrames,false);
+        }
+        else
+        {
+          m_frames.assign(m_numFrames*frameSize,0.0f);
+        }
+        sized=true;
+      }
+      // frames are numbered from the start frame of the export
+      current=0;
+      if(numberAttribute(tag,currentIndex) == false || currentIndex < int(m_startFrame) ||
+         unsigned(currentIndex)-m_startFrame >= m_numFrames)
+      {
+        std::cerr<<"ignoring bad frame in "<<_fileName<<"\n";
+        continue;
+      }
+      currentIndex-=m_startFrame;
+      if(converting == true)
+      {
+        current=&frame[0];
+        std::fill(frame.begin(),frame.end(),0.0f);
+      }
+      else
+      {
+        current=&m_frames[currentIndex*frameSize];
+      }
+    }
+    else if(parse::isTag(tag,"MeshName") == true)
+    {
+      // the exporter pads the name with spaces
+      const char *name=parse::skipWhiteSpace(p,end);
+      const char *nameEnd=end;
+      if(name < end)
+      {
+        size_t remaining=size_t(end-name);
+        const char *lt=static_cast<const char *>(memchr(name,'<',remaining));
+        nameEnd= lt == 0 ? end : lt;
+      }
+      while(nameEnd > name && (parse::isSpace(nameEnd[-1]) || nameEnd[-1] == '\n'))
+      {
+        --nameEnd;
+      }
+      m_meshName.assign(name,nameEnd);
+    }
+    else if(parse::isTag(tag,"NumVerts") == true && sized == false)
+    {
+      m_nVerts=elementInt(p,end);
+    }
+    else if(parse::isTag(tag,"StartFrame") == true && sized == false)
+    {
+      m_startFrame=elementInt(p,end);
+    }
+    else if(parse::isTag(tag,"EndFrame") == true && sized == false)
+    {
+      m_endFrame=elementInt(p,end);
+    }
+    else if(parse::isTag(tag,"NumFrames") == true && sized == false)
+    {
+      numFrames=elementInt(p,end);
+    }
+  }
+  if(root == false || sized == false)
+  {
+    std::cerr<<_fileName<<" is not an NCCAPointBake file or has no frames\n";
+    clear();
+    return false;
+  }
+  if(converting == true)
+  {
+    // any frame missing from the xml is written as zeros as it would be when loading
+    std::fill(frame.begin(),frame.end(),0.0f);
+    for(unsigned int f=0; f<m_numFrames; ++f)
+    {
+      if(written[f] == false)
+      {
+        binary.seekp(h.m_dataOffset+uint64_t(f)*frameSize*sizeof(Real));
+        binary.write(reinterpret_cast<const char *>(&frame[0]),frameSize*sizeof(Real));
+      }
+    }
+    bool ok=binary.good();
+    binary.close();
+    if(ok == false)
+    {
+      std::cerr<<"error writing "<<_binaryName<<"\n";
+      clear();
+      return false;
+    }
+    // only one frame was held in memory, the converted file is mapped in its place
+    return loadBinaryPointBake(_binaryName);
+  }
+  m_data=&m_frames[0];
+  // a mesh attached to the old data needs the new frame
+  if(m_mesh !=0)
+  {
+    attachMesh(m_mesh);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCAPointBake::loadBinaryPointBake(
+                                        const std::string &_fileName
+                                       )
+{
+  clear();
+  // frames are played in order but may loop so leave the read ahead alone and use willNeed in setMeshToFrame
+  if(m_file.open(_fileName) == false)
+  {
+    return false;
+  }
+  // files saved before the quantised format have a shorter header and the new fields are left 0
+  const size_t originalHeaderSize=offsetof(NCCAPointBakeHeader,m_format);
+  NCCAPointBakeHeader h;
+  memset(&h,0,sizeof(NCCAPointBakeHeader));
+  bool valid=m_file.size() >= originalHeaderSize;
+  if(valid == true)
+  {
+    memcpy(&h,m_file.data(),originalHeaderSize);
+    if(h.m_headerSize > originalHeaderSize && h.m_headerSize <= m_file.size())
+    {
+      memcpy(&h,m_file.data(),std::min(size_t(h.m_headerSize),sizeof(NCCAPointBakeHeader)));
+    }
+  }
+  if(valid == false || memcmp(h.m_magic,"ngl::pbk",8) !=0)
+  {
+    std::cerr<<_fileName<<" is not a binary NCCAPointBake file\n";
+    valid=false;
+  }
+  else if(h.m_endian != NCCAPOINTBAKE_ENDIAN || h.m_version != NCCAPOINTBAKE_VERSION)
+  {
+    std::cerr<<_fileName<<" is an unsupported binary NCCAPointBake version or byte order, please re-save it\n";
+    valid=false;
+  }
+  else
+  {
+    uint64_t n=uint64_t(h.m_numVerts)*3;
+    uint64_t dataSize= h.m_format == POINTBAKE_QUANTISED ? h.m_numFrames*sizeof(NCCAPointBakeFrame) : h.m_numFrames*n*sizeof(Real);
+    if(h.m_headerSize < originalHeaderSize || uint64_t(h.m_headerSize)+h.m_nameSize > h.m_dataOffset ||
+       h.m_dataOffset % NCCAPOINTBAKE_ALIGN !=0 || h.m_dataOffset+dataSize > m_file.size() ||
+       h.m_numFrames == 0 || h.m_numVerts == 0 || h.m_format > POINTBAKE_QUANTISED)
+    {
+      valid=false;
+    }
+    else if(h.m_format == POINTBAKE_QUANTISED)
+    {
+      // check every frame now so playback doesn't have to
+      const NCCAPointBakeFrame *table=reinterpret_cast<const NCCAPointBakeFrame *>(m_file.data()+h.m_dataOffset);
+      valid= table[0].m_type == POINTBAKE_KEY;
+      for(uint32_t f=0; f<h.m_numFrames && valid == true; ++f)
+      {
+        valid= table[f].m_type <= POINTBAKE_DELTA16 && table[f].m_size == frameSize(table[f].m_type,n) &&
+               frameOffset(table[f]) % NCCAPOINTBAKE_ALIGN == 0 &&
+               frameOffset(table[f])+table[f].m_size <= m_file.size();
+      }
+    }
+    if(valid == false)
+    {
+      std::cerr<<_fileName<<" is truncated or corrupt\n";
+    }
+  }
+  if(valid == false)
+  {
+    m_file.close();
+    return false;
+  }
+  m_meshName.assign(m_file.data()+h.m_headerSize,h.m_nameSize);
+  m_nVerts=h.m_numVerts;
+  m_numFrames=h.m_numFrames;
+  m_startFrame=h.m_startFrame;
+  m_endFrame=h.m_endFrame;
+  m_format=static_cast<POINTBAKEFORMAT>(h.m_format);
+  // nothing is read here, the pages of a frame are loaded the first time it is used
+  if(m_format == POINTBAKE_QUANTISED)
+  {
+    m_frameTable=reinterpret_cast<const NCCAPointBakeFrame *>(m_file.data()+h.m_dataOffset);
+    for(int c=0; c<3; ++c)
+    {
+      m_min[c]=h.m_min[c];
+      m_scale[c]=h.m_scale[c];
+    }
+  }
+  else
+  {
+    m_data=reinterpret_cast<const Real *>(m_file.data()+h.m_dataOffset);
+  }
+  m_binFile=true;
+  if(m_mesh !=0)
+  {
+    attachMesh(m_mesh);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCAPointBake::saveBinaryPointBake(
+                                        const std::string &_fileName
+                                       )
+{
+  if(m_numFrames == 0)
+  {
+    std::cerr<<"no point bake data to save to "<<_fileName<<"\n";
+    return false;
+  }
+  NCCAPointBakeHeader h;
+  fillHeader(h,POINTBAKE_FLOAT);
+  uint32_t nameEnd=h.m_headerSize+h.m_nameSize;
+
+  std::fstream file;
+  file.open(_fileName.c_str(),std::ios::out | std::ios::binary);
+  if (!file.is_open())
+  {
+    std::cerr<<"problems Opening File "<<_fileName<<std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast <const char *>(&h),sizeof(NCCAPointBakeHeader));
+  file.write(m_meshName.data(),m_meshName.size());
+  padToAlignment(file,nameEnd);
+  size_t frameSize=size_t(m_nVerts)*3*sizeof(Real);
+  if(m_data !=0)
+  {
+    file.write(reinterpret_cast <const char *>(m_data),m_numFrames*frameSize);
+  }
+  else
+  {
+    // a quantised bake is written a frame at a time as it is decoded
+    std::vector<Real> frame(size_t(m_nVerts)*3);
+    for(unsigned int f=0; f<m_numFrames; ++f)
+    {
+      getFrame(f,&frame[0]);
+      file.write(reinterpret_cast <const char *>(&frame[0]),frameSize);
+    }
+  }
+  bool ok=file.good();
+  file.close();
+  if(ok == false)
+  {
+    std::cerr<<"error writing "<<_fileName<<"\n";
+  }
+  return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCAPointBake::saveCompressedPointBake(
+                                            const std::string &_fileName,
+                                            unsigned int _keyInterval
+                                           )
+{
+  if(m_numFrames == 0)
+  {
+    std::cerr<<"no point bake data to save to "<<_fileName<<"\n";
+    return false;
+  }
+  if(_keyInterval == 0)
+  {
+    _keyInterval=1;
+  }
+  size_t n=size_t(m_nVerts)*3;
+  std::vector<Real> frame(n);
+  // the positions are quantised relative to the bounds of every frame
+  Real min[3]={1e30f,1e30f,1e30f};
+  Real max[3]={-1e30f,-1e30f,-1e30f};
+  for(unsigned int f=0; f<m_numFrames; ++f)
+  {
+    getFrame(f,&frame[0]);
+    for(size_t i=0; i<n; ++i)
+    {
+      min[i%3]=std::min(min[i%3],frame[i]);
+      max[i%3]=std::max(max[i%3],frame[i]);
+    }
+  }
+  NCCAPointBakeHeader h;
+  fillHeader(h,POINTBAKE_QUANTISED);
+  h.m_keyInterval=_keyInterval;
+  for(int c=0; c<3; ++c)
+  {
+    h.m_min[c]=min[c];
+    // a flat axis has every value 0 so any scale will do
+    h.m_scale[c]= max[c] > min[c] ? (max[c]-min[c])/65535.0f : 1.0f;
+  }
+  uint32_t nameEnd=h.m_headerSize+h.m_nameSize;
+  uint64_t offset=h.m_dataOffset+uint64_t(m_numFrames)*sizeof(NCCAPointBakeFrame);
+  offset=(offset+NCCAPOINTBAKE_ALIGN-1)/NCCAPOINTBAKE_ALIGN*NCCAPOINTBAKE_ALIGN;
+
+  std::fstream file;
+  file.open(_fileName.c_str(),std::ios::out | std::ios::binary);
+  if (!file.is_open())
+  {
+    std::cerr<<"problems Opening File "<<_fileName<<std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast <const char *>(&h),sizeof(NCCAPointBakeHeader));
+  file.write(m_meshName.data(),m_meshName.size());
+  padToAlignment(file,nameEnd);
+  // the table is written once the frame sizes are known
+  std::vector<NCCAPointBakeFrame> table(m_numFrames);
+  file.write(reinterpret_cast <const char *>(&table[0]),table.size()*sizeof(NCCAPointBakeFrame));
+  padToAlignment(file,h.m_dataOffset+table.size()*sizeof(NCCAPointBakeFrame));
+
+  std::vector<uint16_t> q(n);
+  std::vector<uint16_t> previous(n);
+  std::vector<uint16_t> beforePrevious(n);
+  std::vector<int8_t> delta8(n);
+  std::vector<int16_t> delta16(n);
+  for(unsigned int f=0; f<m_numFrames; ++f)
+  {
+    getFrame(f,&frame[0]);
+    // planar so decoding is a straight run over each of x, y and z
+    for(size_t v=0; v<m_nVerts; ++v)
+    {
+      for(int c=0; c<3; ++c)
+      {
+        Real value=floorf((frame[v*3+c]-h.m_min[c])/h.m_scale[c]+0.5f);
+        q[c*m_nVerts+v]=uint16_t(std::max(0.0f,std::min(65535.0f,value)));
+      }
+    }
+    NCCAPointBakeFrame &entry=table[f];
+    entry.m_offsetLow=uint32_t(offset);
+    entry.m_offsetHigh=uint32_t(offset>>32);
+    entry.m_type=POINTBAKE_KEY;
+    const char *data=reinterpret_cast<const char *>(&q[0]);
+    if(f % _keyInterval !=0)
+    {
+      // predict as applyFrame does, from the key alone straight after it
+      bool afterKey= (f-1) % _keyInterval == 0;
+      bool small=true;
+      for(size_t i=0; i<n; ++i)
+      {
+        uint16_t predicted= afterKey == true ? previous[i] : uint16_t(2*previous[i]-beforePrevious[i]);
+        // the difference wraps so it is exact when added back to the prediction as an unsigned short
+        delta16[i]=int16_t(uint16_t(q[i]-predicted));
+        delta8[i]=int8_t(delta16[i]);
+        small&= delta16[i] >= -128 && delta16[i] <= 127;
+      }
+      entry.m_type= small == true ? POINTBAKE_DELTA8 : POINTBAKE_DELTA16;
+      data= small == true ? reinterpret_cast<const char *>(&delta8[0]) : reinterpret_cast<const char *>(&delta16[0]);
+    }
+    entry.m_size=frameSize(entry.m_type,n);
+    file.write(data,entry.m_size);
+    padToAlignment(file,entry.m_size);
+    offset=(offset+entry.m_size+NCCAPOINTBAKE_ALIGN-1)/NCCAPOINTBAKE_ALIGN*NCCAPOINTBAKE_ALIGN;
+    beforePrevious.swap(previous);
+    previous.swap(q);
+  }
+  file.seekp(h.m_dataOffset);
+  file.write(reinterpret_cast <const char *>(&table[0]),table.size()*sizeof(NCCAPointBakeFrame));
+  bool ok=file.good();
+  file.close();
+  if(ok == false)
+  {
+    std::cerr<<"error writing "<<_fileName<<"\n";
+  }
+  return ok;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const Real * NCCAPointBake::getRawDataPointerAtFrame(
+                                                     unsigned int _f
+                                                    ) const
+{
+  if(m_data == 0 || _f >= m_numFrames)
+  {
+    return 0;
+  }
+  return m_data+size_t(_f)*m_nVerts*3;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCAPointBake::reorderVerts()
+{
+  // the VBO has a vertex per welded v/n/t triple or per triangle corner, each uses one baked vert
+  const std::vector<IndexRef> &refs= m_mesh->m_vaoIndexed == true ? m_mesh->m_indices : m_mesh->m_triangles;
+  m_vertOrder.resize(refs.size());
+  m_directUpload= refs.size() == m_nVerts;
+  for(size_t i=0; i<refs.size(); ++i)
+  {
+    if(refs[i].m_v >= m_nVerts)
+    {
+      m_vertOrder.clear();
+      return false;
+    }
+    m_vertOrder[i]=refs[i].m_v;
+    m_directUpload&= (refs[i].m_v == i);
+  }
+  m_uploadFrame.resize(m_directUpload == true ? 0 : m_vertOrder.size()*3);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCAPointBake::attachMesh(
+                               ngl::AbstractMesh *_mesh
+                              )
+{
+  if(_mesh == 0 || m_numFrames == 0)
+  {
+    return false;
+  }
+  if(_mesh->m_vao == false || _mesh->m_vaoMesh->getNumBuffers() != 1)
+  {
+    std::cerr<<"create the VAO of the mesh before attaching it to the point bake\n";
+    return false;
+  }
+  if(_mesh->m_vertexFormat != VERTEX_FLOAT)
+  {
+    std::cerr<<"quantised positions are relative to the rest pose, use a VERTEX_FLOAT VAO for point bake playback\n";
+    return false;
+  }
+  if(_mesh->m_nVerts != m_nVerts)
+  {
+    std::cerr<<"mesh has "<<_mesh->m_nVerts<<" verts but the point bake has "<<m_nVerts<<"\n";
+    return false;
+  }
+  bool newMesh= _mesh != m_mesh;
+  m_mesh=_mesh;
+  if(reorderVerts() == false)
+  {
+    std::cerr<<"mesh uses verts not in the point bake\n";
+    m_mesh=0;
+    return false;
+  }
+  if(newMesh == true)
+  {
+    // the positions come from their own stream so a frame is one contiguous glBufferSubData, the
+    // attribute is added after the interleaved ones so it replaces the rest pose position
+    std::vector<Real> positions(m_vertOrder.size()*3,0.0f);
+    m_mesh->m_vaoMesh->bind();
+    unsigned int stream=m_mesh->m_vaoMesh->setStreamData(positions.size()*sizeof(Real),positions[0],GL_STREAM_DRAW);
+    m_mesh->m_vaoMesh->setStreamAttributePointer(stream,0,3,GL_FLOAT,3*sizeof(Real),0);
+    m_mesh->m_vaoMesh->unbind();
+    m_positionBuffer=m_mesh->m_vaoMesh->getStreamID(stream);
+  }
+  setMeshToFrame(m_currFrame < m_numFrames ? m_currFrame : 0);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCAPointBake::decodeFrame(
+                                unsigned int _frame
+                               )
+{
+  if(m_stateFrame == _frame)
+  {
+    return;
+  }
+  // frame 0 is always a key so this stops
+  unsigned int key=_frame;
+  while(m_frameTable[key].m_type != POINTBAKE_KEY)
+  {
+    --key;
+  }
+  // playing forward carries on from the current frame rather than going back to the key
+  unsigned int first= m_stateFrame != NOFRAME && m_stateFrame >= key && m_stateFrame < _frame ? m_stateFrame+1 : key;
+  size_t n=size_t(m_nVerts)*3;
+  m_state.resize(n);
+  m_previousState.resize(n);
+  m_nextState.resize(n);
+  for(unsigned int f=first; f<=_frame; ++f)
+  {
+    const uint16_t *previous= m_hasPreviousState == true ? &m_previousState[0] : 0;
+    applyFrame(m_frameTable[f],m_file.data(),&m_state[0],previous,&m_nextState[0],n);
+    // rotate the buffers rather than copy, m_nextState is only scratch here
+    m_previousState.swap(m_state);
+    m_state.swap(m_nextState);
+    m_hasPreviousState= m_frameTable[f].m_type != POINTBAKE_KEY;
+  }
+  m_stateFrame=_frame;
+  // start paging in the next frame so playback doesn't stall on a page fault
+  if(_frame+1 < m_numFrames)
+  {
+    m_file.willNeed(frameOffset(m_frameTable[_frame+1]),m_frameTable[_frame+1].m_size);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool NCCAPointBake::getFrame(
+                             Real _frame,
+                             Real *o_data
+                            )
+{
+  if(m_numFrames == 0)
+  {
+    return false;
+  }
+  _frame=std::max(Real(0),std::min(Real(m_numFrames-1),_frame));
+  unsigned int frame=static_cast<unsigned int>(_frame);
+  Real t=_frame-frame;
+  if(frame+1 >= m_numFrames)
+  {
+    t=0.0f;
+  }
+  size_t n=size_t(m_nVerts)*3;
+  if(m_format == POINTBAKE_QUANTISED)
+  {
+    decodeFrame(frame);
+    if(t == 0.0f)
+    {
+      dequantise(&m_state[0],0,0.0f,m_min,m_scale,m_nVerts,o_data);
+    }
+    else
+    {
+      const uint16_t *previous= m_hasPreviousState == true ? &m_previousState[0] : 0;
+      applyFrame(m_frameTable[frame+1],m_file.data(),&m_state[0],previous,&m_nextState[0],n);
+      dequantise(&m_state[0],&m_nextState[0],t,m_min,m_scale,m_nVerts,o_data);
+    }
+    return true;
+  }
+  const Real *a=getRawDataPointerAtFrame(frame);
+  if(t == 0.0f)
+  {
+    memcpy(o_data,a,n*sizeof(Real));
+  }
+  else
+  {
+    const Real *b=a+n;
+    for(size_t i=0; i<n; ++i)
+    {
+      o_data[i]=a[i]+t*(b[i]-a[i]);
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCAPointBake::uploadFrame(
+                                const Real *_data
+                               )
+{
+  GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER,m_positionBuffer);
+  if(m_directUpload == true)
+  {
+    // straight from the mapped file (or m_frames) to GL
+    glBufferSubData(GL_ARRAY_BUFFER,0,size_t(m_nVerts)*3*sizeof(Real),_data);
+  }
+  else
+  {
+    Real *out=&m_uploadFrame[0];
+    for(size_t i=0; i<m_vertOrder.size(); ++i)
+    {
+      const Real *v=_data+m_vertOrder[i]*3;
+      out[0]=v[0];
+      out[1]=v[1];
+      out[2]=v[2];
+      out+=3;
+    }
+    glBufferSubData(GL_ARRAY_BUFFER,0,m_uploadFrame.size()*sizeof(Real),&m_uploadFrame[0]);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCAPointBake::setMeshToFrame(
+                                   const unsigned int _frame
+                                  )
+{
+  if(m_mesh == 0 || _frame >= m_numFrames)
+  {
+    return;
+  }
+  if(m_format == POINTBAKE_QUANTISED)
+  {
+    m_decoded.resize(size_t(m_nVerts)*3);
+    getFrame(_frame,&m_decoded[0]);
+    uploadFrame(&m_decoded[0]);
+    m_currFrame=_frame;
+    return;
+  }
+  const Real *frame=getRawDataPointerAtFrame(_frame);
+  uploadFrame(frame);
+  m_currFrame=_frame;
+  // start paging in the next frame so playback doesn't stall on a page fault
+  if(m_binFile == true && _frame+1 < m_numFrames)
+  {
+    size_t frameSize=size_t(m_nVerts)*3*sizeof(Real);
+    size_t offset=reinterpret_cast<const char *>(frame)-m_file.data()+frameSize;
+    m_file.willNeed(offset,frameSize);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCAPointBake::setMeshToTime(
+                                  Real _frame
+                                 )
+{
+  if(m_mesh == 0 || m_numFrames == 0)
+  {
+    return;
+  }
+  m_decoded.resize(size_t(m_nVerts)*3);
+  getFrame(_frame,&m_decoded[0]);
+  uploadFrame(&m_decoded[0]);
+  m_currFrame=static_cast<unsigned int>(std::max(Real(0),std::min(Real(m_numFrames-1),_frame)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void NCCAPointBake::setFrame(
+                             const unsigned int _frame
+                            )
+{
+  if(m_mesh !=0)
+  {
+    setMeshToFrame(_frame);
+  }
+  else if(_frame < m_numFrames)
+  {
+    m_currFrame=_frame;
+  }
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
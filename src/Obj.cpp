@@ -14,13 +14,12 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
-#include "boost/bind.hpp"
-
-#include "boost/spirit.hpp"
-#warning re-write this at some stage to use boost::spirit::qi
-
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
 #include "Obj.h"
+#include "ParseUtil.h"
+#include "ParallelFor.h"
 //----------------------------------------------------------------------------------------------------------------------
 /// @file Obj.cpp
 /// @brief implementation files for Obj class
@@ -30,199 +29,400 @@
 namespace ngl
 {
 
-// make a namespace for our parser to save writing boost::spirit:: all the time
-namespace spt=boost::spirit;
-
-// syntactic sugar for specifying our grammar
-typedef spt::rule<spt::phrase_scanner_t> srule;
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a block of the mapped file (split at line boundaries) parsed by a single thread, the count pass
+/// fills in the number of each record then the base values are set from the running totals so
+/// each chunk knows where in the mesh lists its own data goes
+//----------------------------------------------------------------------------------------------------------------------
+struct ObjChunk
+{
+  const char *m_begin;
+  const char *m_end;
+  size_t m_nVerts;
+  size_t m_nNorm;
+  size_t m_nTex;
+  size_t m_nFaces;
+  size_t m_nCorners;
+  size_t m_vertBase;
+  size_t m_normBase;
+  size_t m_texBase;
+  size_t m_faceBase;
+  size_t m_cornerBase;
+};
 
+//----------------------------------------------------------------------------------------------------------------------
+// the obj records we are interested in, everything else (comments, groups, materials) is skipped
+enum OBJRECORD{NONE,VERTEX,TEXCORD,NORMAL,FACE};
 
 //----------------------------------------------------------------------------------------------------------------------
-// parse a vertex
-void Obj::parseVertex(
-                      const char *_begin
-                     )
+// see below for the rest of the obj spec and other good format data
+// http://local.wasp.uwa.edu.au/~pbourke/dataformats/obj/
+// work out which record the line holds and move io_p to the start of the record data
+static inline OBJRECORD classifyLine(
+                                     const char *&io_p,
+                                     const char *_eol
+                                    )
 {
-  std::vector<float> values;
-  // here is the parse rule to load the data into a vector (above)
-  srule vertex = "v" >> spt::real_p[spt::append(values)] >>
-                        spt::real_p[spt::append(values)] >>
-                        spt::real_p[spt::append(values)];
-  // now parse the data
-  spt::parse_info<> result = spt::parse(_begin, vertex, spt::space_p);
-  // and add it to our vert list in abstact mesh parent
-  m_verts.push_back(Vec3(values[0],values[1],values[2]));
+  const char *p=parse::skipSpace(io_p,_eol);
+  OBJRECORD type=NONE;
+  if(_eol-p > 1)
+  {
+    if(p[0]=='v')
+    {
+      if(parse::isSpace(p[1]))
+      {
+        type=VERTEX; p+=1;
+      }
+      else if(p[1]=='t' && _eol-p>2 && parse::isSpace(p[2]))
+      {
+        type=TEXCORD; p+=2;
+      }
+      else if(p[1]=='n' && _eol-p>2 && parse::isSpace(p[2]))
+      {
+        type=NORMAL; p+=2;
+      }
+    }
+    else if(p[0]=='f' && parse::isSpace(p[1]))
+    {
+      type=FACE; p+=1;
+    }
+  }
+  io_p=p;
+  return type;
 }
 
-
 //----------------------------------------------------------------------------------------------------------------------
-// parse a texture coordinate
-void Obj::parseTextureCoordinate(
-                                 const char * _begin
-                                )
+// obj indices start from 1, negative values are relative to the current end of the list
+// so -1 is the last element read so far
+static inline unsigned long int objIndex(
+                                         int _i,
+                                         size_t _count
+                                        )
 {
-  std::vector<float> values;
-  // generate our parse rule for a tex cord,
-  // this can be either a 2 or 3 d text so the *rule looks for an additional one
-  srule texcord = "vt" >> spt::real_p[spt::append(values)] >>
-                          spt::real_p[spt::append(values)] >>
-                          *(spt::real_p[spt::append(values)]);
-  spt::parse_info<> result = spt::parse(_begin, texcord, spt::space_p);
-  // should check the return values at some stage
-
-  // build tex cord
-  // if we have a value use it other wise set to 0
-  float vt3 = values.size() == 3 ? values[2] : 0.0f;
-  m_tex.push_back(Vec3(values[0],values[1],vt3));
+  return _i < 0 ? _count+_i : _i-1;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-// parse a normal
-void Obj::parseNormal(
-                      const char *_begin
+// parse a vertex or normal, if the record is broken we still store a value so the
+// indices of all the following records stay the same
+static void parseVec3(
+                      const char *_begin,
+                      const char *_end,
+                      Vec3 &o_v
                      )
 {
-  std::vector<float> values;
-  // here is our rule for normals
-  srule norm = "vn" >> spt::real_p[spt::append(values)] >>
-                       spt::real_p[spt::append(values)] >>
-                       spt::real_p[spt::append(values)];
-  // parse and push back to the list
-  spt::parse_info<> result = spt::parse(_begin, norm, spt::space_p);
-  // should check the return values at some stage
-  m_norm.push_back(Vec3(values[0],values[1],values[2]));
+  Real x,y,z;
+  if(parse::parseReal(_begin,_end,x) &&
+     parse::parseReal(_begin,_end,y) &&
+     parse::parseReal(_begin,_end,z))
+  {
+    o_v.set(x,y,z);
+  }
+  else
+  {
+    std::cerr<<"bad vertex data in obj file\n";
+    o_v.set(0.0f,0.0f,0.0f);
+  }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-// parse face
-void Obj::parseFace(
-                    const char * _begin
-                   )
+// parse a texture coordinate
+static void parseTextureCoordinate(
+                                   const char *_begin,
+                                   const char *_end,
+                                   Vec3 &o_t
+                                  )
 {
-  // ok this one is quite complex first create some lists for our face data
-  // list to hold the vertex data indices
-  std::vector<int> vec;
-  // list to hold the tex cord indices
-  std::vector<int> tvec;
-  // list to hold the normal indices
-  std::vector<int> nvec;
-
-  // create the parse rule for a face entry V/T/N
-  // so our entry can be always a vert, followed by optional t and norm seperated by /
-  // also it is possible to have just a V value with no / so the rule should do all this
-  srule entry = spt::int_p[spt::append(vec)] >>
-    (
-      ("/" >> (spt::int_p[spt::append(tvec)] | spt::epsilon_p) >>
-       "/" >> (spt::int_p[spt::append(nvec)] | spt::epsilon_p)
-      )
-      | spt::epsilon_p
-    );
-  // a face has at least 3 of the above entries plus many optional ones
-  srule face = "f"  >> entry >> entry >> entry >> *(entry);
-  // now we've done this we can parse
-  spt::parse_info<> result = spt::parse(_begin, face, spt::space_p);
-
-  int numVerts=vec.size();
-  // so now build a face structure.
-  Face f;
-  // verts are -1 the size
-  f.m_numVerts=numVerts-1;
-  f.m_textureCoord=false;
-  // copy the vertex indices into our face data structure index in obj start from 1
-  // so we need to do -1 for our array index
-  BOOST_FOREACH(int i, vec)
+  Real u,v;
+  // a tex cord can be either 2 or 3 d so the last value is optional
+  if(parse::parseReal(_begin,_end,u) && parse::parseReal(_begin,_end,v))
   {
-    f.m_vert.push_back(i-1);
+    // if we have a value use it other wise set to 0
+    Real w;
+    if(!parse::parseReal(_begin,_end,w))
+    {
+      w=0.0f;
+    }
+    o_t.set(u,v,w);
   }
+  else
+  {
+    std::cerr<<"bad texture co-ordinate data in obj file\n";
+    o_t.set(0.0f,0.0f,0.0f);
+  }
+}
 
-  // merge in texture coordinates and normals, if present
-  // OBJ format requires an encoding for faces which uses one of the vertex/texture/normal specifications
-  // consistently across the entire face.  eg. we can have all v/vt/vn, or all v//vn, or all v, but not
-  // v//vn then v/vt/vn ...
-  if(!nvec.empty())
+//----------------------------------------------------------------------------------------------------------------------
+// parse face, the counts passed in are the number of each element read before this face
+// and are used to resolve relative (negative) indices. The corners are written to the output
+// arrays (missing normals / tex cords as NOINDEX) up to _capacity corners, if the outputs are null
+// the corners are only counted, this is used by the count pass so both passes agree on the size of
+// every face
+// returns the number of corners in the face
+static unsigned int parseFace(
+                              const char *_begin,
+                              const char *_end,
+                              size_t _nVerts,
+                              size_t _nTex,
+                              size_t _nNorm,
+                              size_t _capacity,
+                              GLuint *o_vert,
+                              GLuint *o_tex,
+                              GLuint *o_norm
+                             )
+{
+  unsigned int numVerts=0;
+  unsigned int numTex=0;
+  unsigned int numNorm=0;
+  // each entry is always a vert, followed by optional t and norm seperated by /
+  // so we can have V, V/T, V//N or V/T/N
+  int index;
+  while(parse::parseInt(_begin,_end,index))
   {
-    if(nvec.size() != vec.size())
+    GLuint v=objIndex(index,_nVerts);
+    GLuint t=IndexRef::NOINDEX;
+    GLuint n=IndexRef::NOINDEX;
+    if(_begin<_end && *_begin=='/')
     {
-     std::cerr <<"Something wrong with the face data will continue but may not be correct\n";
+      ++_begin;
+      if(_begin<_end && (parse::isDigit(*_begin) || *_begin=='-'))
+      {
+        parse::parseInt(_begin,_end,index);
+        t=objIndex(index,_nTex);
+        ++numTex;
+      }
+      if(_begin<_end && *_begin=='/')
+      {
+        ++_begin;
+        if(_begin<_end && (parse::isDigit(*_begin) || *_begin=='-'))
+        {
+          parse::parseInt(_begin,_end,index);
+          n=objIndex(index,_nNorm);
+          ++numNorm;
+        }
+      }
     }
-
-    // copy in these references to normal vectors to the mesh's normal vector
-    BOOST_FOREACH(int i, nvec)
+    if(o_vert !=0 && numVerts<_capacity)
     {
-      f.m_norm.push_back(i-1);
+      o_vert[numVerts]=v;
+      o_tex[numVerts]=t;
+      o_norm[numVerts]=n;
     }
-
+    ++numVerts;
   }
-
-  //
-  // merge in texture coordinates, if present
-  //
-  if(!tvec.empty())
+  // only report problems in the count pass so each one is only reported once
+  if(o_vert == 0)
   {
-    if(tvec.size() != vec.size())
+    if(numVerts<3)
     {
-     std::cerr <<"Something wrong with the face data will continue but may not be correct\n";
+      std::cerr <<"Face with less than 3 vertices found ignoring\n";
     }
-
-    // copy in these references to normal vectors to the mesh's normal vector
-    BOOST_FOREACH(int i, tvec)
+    // OBJ format requires an encoding for faces which uses one of the vertex/texture/normal specifications
+    // consistently across the entire face.  eg. we can have all v/vt/vn, or all v//vn, or all v, but not
+    // v//vn then v/vt/vn ...
+    else if((numNorm !=0 && numNorm != numVerts) || (numTex !=0 && numTex != numVerts))
     {
-      f.m_tex.push_back(i-1);
+      std::cerr <<"Something wrong with the face data will continue but may not be correct\n";
     }
+  }
+  return numVerts;
+}
 
-    f.m_textureCoord=true;
+//----------------------------------------------------------------------------------------------------------------------
+void Obj::countRecords(
+                       std::vector<ObjChunk> &io_chunks,
+                       size_t _begin,
+                       size_t _end
+                      ) const
+{
+  for(size_t c=_begin; c<_end; ++c)
+  {
+    ObjChunk &chunk=io_chunks[c];
+    chunk.m_nVerts=chunk.m_nNorm=chunk.m_nTex=chunk.m_nFaces=chunk.m_nCorners=0;
+    const char *p=chunk.m_begin;
+    while(p<chunk.m_end)
+    {
+      const char *eol=parse::lineEnd(p,chunk.m_end);
+      switch(classifyLine(p,eol))
+      {
+        case VERTEX : ++chunk.m_nVerts; break;
+        case TEXCORD : ++chunk.m_nTex; break;
+        case NORMAL : ++chunk.m_nNorm; break;
+        case FACE :
+        {
+          // the face corners are stored in flat arrays so we need to know how many there are
+          unsigned int numVerts=parseFace(p,eol,0,0,0,0,0,0,0);
+          if(numVerts>=3)
+          {
+            ++chunk.m_nFaces;
+            chunk.m_nCorners+=numVerts;
+          }
+        }
+        break;
+        default : break;
+      }
+      p=eol+1;
+    }
+  }
+}
 
+//----------------------------------------------------------------------------------------------------------------------
+void Obj::parseChunks(
+                      std::vector<ObjChunk> &io_chunks,
+                      size_t _begin,
+                      size_t _end
+                     )
+{
+  for(size_t c=_begin; c<_end; ++c)
+  {
+    ObjChunk &chunk=io_chunks[c];
+    // these are global indices, so each chunk writes to its own part of the lists and
+    // relative face indices resolve exactly as they would for a single pass
+    size_t v=chunk.m_vertBase;
+    size_t n=chunk.m_normBase;
+    size_t t=chunk.m_texBase;
+    size_t f=chunk.m_faceBase;
+    size_t corner=chunk.m_cornerBase;
+    size_t cornerEnd=chunk.m_cornerBase+chunk.m_nCorners;
+    const char *p=chunk.m_begin;
+    while(p<chunk.m_end)
+    {
+      const char *eol=parse::lineEnd(p,chunk.m_end);
+      switch(classifyLine(p,eol))
+      {
+        case VERTEX : parseVec3(p,eol,m_verts[v++]); break;
+        case TEXCORD : parseTextureCoordinate(p,eol,m_tex[t++]); break;
+        case NORMAL : parseVec3(p,eol,m_norm[n++]); break;
+        case FACE :
+        {
+          // a bad face may write a couple of corners which are then overwritten by the next face,
+          // the capacity stops it writing past the end of this chunk's corners
+          unsigned int numVerts;
+          if(corner<cornerEnd)
+          {
+            numVerts=parseFace(p,eol,v,t,n,cornerEnd-corner,&m_faceVert[corner],&m_faceTex[corner],&m_faceNorm[corner]);
+          }
+          else
+          {
+            GLuint unused;
+            numVerts=parseFace(p,eol,v,t,n,0,&unused,&unused,&unused);
+          }
+          if(numVerts>=3)
+          {
+            m_faceOffset[f++]=corner;
+            corner+=numVerts;
+          }
+        }
+        break;
+        default : break;
+      }
+      p=eol+1;
+    }
   }
-// finally save the face into our face list
-  m_face.push_back(f);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-bool Obj::load(
-               const std::string &_fname,bool _calcBB
-              )
+void Obj::parseBlock(
+                     const char *_begin,
+                     const char *_end,
+                     unsigned int _numThreads
+                    )
 {
- // here we build up our ebnf rules for parsing
-  // so first we have a comment
-  srule comment = spt::comment_p("#");
-
-  // see below for the rest of the obj spec and other good format data
-  // http://local.wasp.uwa.edu.au/~pbourke/dataformats/obj/
-
-  // vertices rule v is a parse of 3 reals and we run the parseVertex function
-  srule vertex= ("v"  >> spt::real_p >> spt::real_p >> spt::real_p) [bind(&Obj::parseVertex,boost::ref(*this), _1)];
-  /// our tex rule and binding of the parse function
-  srule tex= ("vt" >> spt::real_p >> spt::real_p) [bind(&Obj::parseTextureCoordinate, boost::ref(*this), _1)];
-  // the normal rule and parsing function
-  srule norm= ("vn" >> spt::real_p >> spt::real_p >> spt::real_p) [bind(&Obj::parseNormal,boost::ref(*this), _1)];
-
-  // our vertex data can be any of the above values
-  srule vertex_type = vertex | tex | norm;
-
-  // the rule for the face and parser
-  srule  face = (spt::ch_p('f') >> *(spt::anychar_p))[bind(&Obj::parseFace, boost::ref(*this), _1)];
-  // open the file to parse
-  std::ifstream in(_fname.c_str());
-	if (in.is_open() != true)
-	{
-		std::cout<<"FILE NOT FOUND !!!! "<<_fname.c_str()<<"\n";
-		return false;
-
-	}
-  std::string str;
-  // loop grabbing a line and then pass it to our parsing framework
-  while(getline(in, str))
+  if(_numThreads==0)
+  {
+    _numThreads=defaultThreadCount();
+  }
+  size_t size=_end-_begin;
+  // split the block into one chunk per thread at line boundaries, small blocks aren't worth splitting
+  static const size_t s_minChunkSize=256*1024;
+  size_t numChunks=std::min<size_t>(_numThreads,size/s_minChunkSize);
+  if(numChunks<1)
+  {
+    numChunks=1;
+  }
+  std::vector<ObjChunk> chunks(numChunks);
+  const char *start=_begin;
+  for(size_t i=0; i<numChunks; ++i)
+  {
+    const char *end=_end;
+    if(i<numChunks-1)
+    {
+      end=_begin+(size*(i+1))/numChunks;
+      if(end<start)
+      {
+        end=start;
+      }
+      end=parse::lineEnd(end,_end);
+      if(end<_end)
+      {
+        ++end;
+      }
+    }
+    chunks[i].m_begin=start;
+    chunks[i].m_end=end;
+    start=end;
+  }
+  // first pass counts the records so we can size the lists and give each chunk its base index
+  parallelFor(0,numChunks,boost::bind(&Obj::countRecords,this,boost::ref(chunks),_1,_2),_numThreads,1);
+  size_t nVerts=m_verts.size();
+  size_t nNorm=m_norm.size();
+  size_t nTex=m_tex.size();
+  // the face offsets have an extra entry for the total corners which we replace as we add to them
+  if(m_faceOffset.empty())
+  {
+    m_faceOffset.push_back(0);
+  }
+  size_t nFaces=m_faceOffset.size()-1;
+  size_t nCorners=m_faceVert.size();
+  for(size_t i=0; i<numChunks; ++i)
   {
-    spt::parse(str.c_str(), vertex_type  | face | comment, spt::space_p);
+    chunks[i].m_vertBase=nVerts; nVerts+=chunks[i].m_nVerts;
+    chunks[i].m_normBase=nNorm; nNorm+=chunks[i].m_nNorm;
+    chunks[i].m_texBase=nTex; nTex+=chunks[i].m_nTex;
+    chunks[i].m_faceBase=nFaces; nFaces+=chunks[i].m_nFaces;
+    chunks[i].m_cornerBase=nCorners; nCorners+=chunks[i].m_nCorners;
   }
-  // now we are done close the file
-  in.close();
+  m_verts.resize(nVerts);
+  m_norm.resize(nNorm);
+  m_tex.resize(nTex);
+  m_faceOffset.resize(nFaces+1);
+  m_faceOffset[nFaces]=nCorners;
+  m_faceVert.resize(nCorners);
+  m_faceNorm.resize(nCorners);
+  m_faceTex.resize(nCorners);
+  // now the real parse, each chunk fills in its own part of the lists
+  parallelFor(0,numChunks,boost::bind(&Obj::parseChunks,this,boost::ref(chunks),_1,_2),_numThreads,1);
 
   // grab the sizes used for drawing later
   m_nVerts=m_verts.size();
   m_nNorm=m_norm.size();
   m_nTex=m_tex.size();
-  m_nFaces=m_face.size();
+  m_nFaces=nFaces;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool Obj::load(
+               const std::string &_fname,
+               bool _calcBB,
+               unsigned int _numThreads
+              )
+{
+  // map the whole file, the OS will page it in as we walk through it so there is
+  // no need to copy each line out as a string
+  MemoryMappedFile file;
+  if(file.open(_fname,MemoryMappedFile::SEQUENTIAL) != true)
+  {
+    return false;
+  }
+  parseBlock(file.data(),file.end(),_numThreads);
+  // now we are done unmap the file
+  file.close();
+  // the faces have changed so any previous triangulation is out of date
+  m_triangles.clear();
+  m_faceTriStart.clear();
+  m_vaoPrepared=false;
+  m_cornerFace.clear();
+  m_bvh.clear();
 
   // Calculate the center of the object.
   if(_calcBB == true)
@@ -230,14 +430,70 @@ bool Obj::load(
     this->calcDimensions();
   }
   return true;
+}
 
-//	fileIn.close(); // close the file.
+//----------------------------------------------------------------------------------------------------------------------
+bool Obj::beginStream(
+                      const std::string &_fname,
+                      size_t _blockSize,
+                      unsigned int _numThreads
+                     )
+{
+  if(m_vao == true || isStreaming())
+  {
+    std::cerr<<"Obj already has a VAO, can't stream "<<_fname<<" into it\n";
+    return false;
+  }
+  if(m_streamFile.open(_fname,MemoryMappedFile::SEQUENTIAL) != true)
+  {
+    return false;
+  }
+  m_streamPos=m_streamFile.data();
+  m_streamBlockSize= _blockSize==0 ? 1 : _blockSize;
+  m_streamThreads=_numThreads;
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool Obj::streamStep()
+{
+  if(isStreaming() == false)
+  {
+    return false;
+  }
+  // parse the next block of whole lines
+  const char *end=m_streamFile.end();
+  if(size_t(end-m_streamPos) > m_streamBlockSize)
+  {
+    end=parse::lineEnd(m_streamPos+m_streamBlockSize,m_streamFile.end());
+    if(end<m_streamFile.end())
+    {
+      ++end;
+    }
+  }
+  unsigned long int firstFace=m_nFaces;
+  parseBlock(m_streamPos,end,m_streamThreads);
+  m_streamPos=end;
+  // the new faces become the next draw range of the VAO
+  appendStreamFaces(firstFace,m_streamThreads);
+  if(m_streamPos < m_streamFile.end())
+  {
+    return true;
+  }
+  // all done so release the file and set up the bounds as load would
+  m_streamFile.close();
+  if(m_nVerts !=0)
+  {
+    calcDimensions();
+  }
+  m_loaded=true;
+  return false;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 Obj::Obj(
          const std::string& _fname
-        ) :AbstractMesh()
+        ) :AbstractMesh(),m_streamPos(0),m_streamBlockSize(0),m_streamThreads(1)
 {
     m_vbo=false;
     m_ext=0;
@@ -257,7 +513,7 @@ Obj::Obj(
 Obj::Obj(
          const std::string& _fname,
          const std::string& _texName
-        ):AbstractMesh()
+        ):AbstractMesh(),m_streamPos(0),m_streamBlockSize(0),m_streamThreads(1)
 {
     m_vbo=false;
     m_vao=false;
@@ -310,22 +566,28 @@ void Obj::save(
   }
 
   // finally the faces
-  BOOST_FOREACH(Face f,m_face)
-  {
-  fileOut<<"f ";
-  // we now have V/T/N for each to write out
-  for(unsigned int i=0; i<f.m_numVerts; ++i)
+  for(unsigned long int f=0; f<m_nFaces; ++f)
   {
-    // don't forget that obj indices start from 1 not 0 (i did originally !)
-    fileOut<<f.m_vert[i]+1;
-    fileOut<<"/";
-    fileOut<<f.m_tex[i]+1;
-    fileOut<<"/";
-
-    fileOut<<f.m_norm[i]+1;
-    fileOut<<" ";
-  }
-  fileOut<<std::endl;
+    fileOut<<"f";
+    // we now have V/T/N for each to write out, missing tex cords or normals are left out
+    for(GLuint c=m_faceOffset[f]; c<m_faceOffset[f+1]; ++c)
+    {
+      // don't forget that obj indices start from 1 not 0 (i did originally !)
+      fileOut<<" "<<m_faceVert[c]+1;
+      if(m_faceTex[c] != IndexRef::NOINDEX || m_faceNorm[c] != IndexRef::NOINDEX)
+      {
+        fileOut<<"/";
+        if(m_faceTex[c] != IndexRef::NOINDEX)
+        {
+          fileOut<<m_faceTex[c]+1;
+        }
+        if(m_faceNorm[c] != IndexRef::NOINDEX)
+        {
+          fileOut<<"/"<<m_faceNorm[c]+1;
+        }
+      }
+    }
+    fileOut<<std::endl;
   }
 }
 
@@ -0,0 +1,78 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ParallelFor.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ParallelFor.cpp
+/// @brief implementation of the parallelFor helper
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int defaultThreadCount()
+{
+  unsigned int n=boost::thread::hardware_concurrency();
+  return n==0 ? 1 : n;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void parallelFor(
+                 size_t _begin,
+                 size_t _end,
+                 const RangeFunction &_body,
+                 unsigned int _numThreads,
+                 size_t _minBlock
+                )
+{
+  if(_end<=_begin)
+  {
+    return;
+  }
+  size_t size=_end-_begin;
+  size_t numThreads= _numThreads==0 ? defaultThreadCount() : _numThreads;
+  if(_minBlock==0)
+  {
+    _minBlock=1;
+  }
+  // don't spawn threads for less work than a thread costs
+  size_t maxBlocks=(size+_minBlock-1)/_minBlock;
+  if(numThreads>maxBlocks)
+  {
+    numThreads=maxBlocks;
+  }
+  if(numThreads<=1)
+  {
+    _body(_begin,_end);
+    return;
+  }
+  boost::thread_group threads;
+  size_t start=_begin;
+  for(size_t i=0; i<numThreads-1; ++i)
+  {
+    size_t end=_begin+(size*(i+1))/numThreads;
+    threads.create_thread(boost::bind(_body,start,end));
+    start=end;
+  }
+  // the calling thread does the last block rather than sitting idle
+  _body(start,_end);
+  threads.join_all();
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
@@ -50,7 +50,7 @@ void printInfoLog(
 
 
 Shader::Shader(
-                std::string _name,
+                const std::string &_name,
                 SHADERTYPE _type
               )
 {
@@ -110,7 +110,7 @@ void Shader::compile()
 
 
 void Shader::load(
-                   std::string _name
+                   const std::string &_name
                  )
 {
   // see if we already have some source attached
@@ -16,6 +16,7 @@
 */
 #include <cstdlib>
 #include "ShaderLib.h"
+#include "GLStateCache.h"
 #include "TextShaders.h"
 #include "ColourShaders.h"
 
@@ -32,91 +33,91 @@ namespace ngl
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setShaderParamFromMatrix(
                                             const std::string &_paramName,
-                                            ngl::Mat4 _p1
+                                            const ngl::Mat4 &_p1
                                            )
 {
-  (*this)[m_currentShader]->setUniformMatrix4fv(_paramName.c_str(),1,GL_FALSE,_p1.openGL());
+  m_currentProgram->setUniformMatrix4fv(_paramName.c_str(),1,GL_FALSE,_p1.openGL());
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setRegisteredUniformFromMatrix(
                                                 const std::string &_registeredUniformName,
-                                                ngl::Mat4 _p1
+                                                const ngl::Mat4 &_p1
                                                )
 {
-  (*this)[m_currentShader]->setRegisteredUniformMatrix4fv(_registeredUniformName,1,GL_FALSE,_p1.openGL());
+  m_currentProgram->setRegisteredUniformMatrix4fv(_registeredUniformName,1,GL_FALSE,_p1.openGL());
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setShaderParamFromMat3x3(
                                             const std::string &_paramName,
-                                            ngl::Mat3 _p1
+                                            const ngl::Mat3 &_p1
                                            )
 {
-  (*this)[m_currentShader]->setUniformMatrix3fv(_paramName.c_str(),1,GL_FALSE,_p1.openGL());
+  m_currentProgram->setUniformMatrix3fv(_paramName.c_str(),1,GL_FALSE,_p1.openGL());
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setRegisteredUniformFromMat3x3(
                                               const std::string &_paramName,
-                                              ngl::Mat3 _p1
+                                              const ngl::Mat3 &_p1
                                              )
 {
-  (*this)[m_currentShader]->setRegisteredUniformMatrix3fv(_paramName,1,GL_FALSE,_p1.openGL());
+  m_currentProgram->setRegisteredUniformMatrix3fv(_paramName,1,GL_FALSE,_p1.openGL());
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setShaderParamFromVector(
 																							const std::string &_paramName,
-																							ngl::Vec4 _p1
+																							const ngl::Vec4 &_p1
 																						 )
 {
 
-	(*this)[m_currentShader]->setUniform4fv(_paramName.c_str(),1,_p1.openGL());
+	m_currentProgram->setUniform4fv(_paramName.c_str(),1,_p1.openGL());
 
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setRegisteredUniformVector(
                                               const std::string &_paramName,
-                                              ngl::Vec4 _p1
+                                              const ngl::Vec4 &_p1
                                              )
 {
-  (*this)[m_currentShader]->setRegisteredUniform4f(_paramName,_p1.m_x,_p1.m_y,_p1.m_z,_p1.m_w);
+  m_currentProgram->setRegisteredUniform4f(_paramName,_p1.m_x,_p1.m_y,_p1.m_z,_p1.m_w);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setShaderParamFromColour(
                                               const std::string &_paramName,
-                                              ngl::Colour _p1
+                                              const ngl::Colour &_p1
                                              )
 {
 
-  (*this)[m_currentShader]->setUniform4fv(_paramName.c_str(),1,_p1.openGL());
+  m_currentProgram->setUniform4fv(_paramName.c_str(),1,_p1.openGL());
 
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setRegisteredUniformFromColour(
                                               const std::string &_paramName,
-                                              ngl::Colour _p1
+                                              const ngl::Colour &_p1
                                              )
 {
-  (*this)[m_currentShader]->setRegisteredUniform4f(_paramName,_p1.m_r,_p1.m_g,_p1.m_b,_p1.m_a);
+  m_currentProgram->setRegisteredUniform4f(_paramName,_p1.m_r,_p1.m_g,_p1.m_b,_p1.m_a);
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setRegisteredUniformVec3(
                                               const std::string &_paramName,
-                                              ngl::Vec3 _p1
+                                              const ngl::Vec3 &_p1
                                              )
 {
-  (*this)[m_currentShader]->setRegisteredUniform3f(_paramName,_p1.m_x,_p1.m_y,_p1.m_z);
+  m_currentProgram->setRegisteredUniform3f(_paramName,_p1.m_x,_p1.m_y,_p1.m_z);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setRegisteredUniformVec2(
                                               const std::string &_paramName,
-                                              ngl::Vec2 _p1
+                                              const ngl::Vec2 &_p1
                                              )
 {
-  (*this)[m_currentShader]->setRegisteredUniform2f(_paramName,_p1.m_x,_p1.m_y);
+  m_currentProgram->setRegisteredUniform2f(_paramName,_p1.m_x,_p1.m_y);
 }
 
 
@@ -132,7 +133,7 @@ void ShaderLib::setShaderParam4f(
 
                                   )
 {
-	(*this)[m_currentShader]->setUniform4f(_paramName.c_str(),_p1,_p2,_p3,_p4);
+	m_currentProgram->setUniform4f(_paramName.c_str(),_p1,_p2,_p3,_p4);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -145,7 +146,7 @@ void ShaderLib::setRegisteredUniform4f(
 
                                         )
 {
-  (*this)[m_currentShader]->setRegisteredUniform4f(_paramName,_p1,_p2,_p3,_p4);
+  m_currentProgram->setRegisteredUniform4f(_paramName,_p1,_p2,_p3,_p4);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -156,7 +157,7 @@ void ShaderLib::setShaderParam3f(
                                       float _p3
                                     )
 {
-	(*this)[m_currentShader]->setUniform3f(_paramName.c_str(),_p1,_p2,_p3);
+	m_currentProgram->setUniform3f(_paramName.c_str(),_p1,_p2,_p3);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -167,7 +168,7 @@ void ShaderLib::setRegisteredUniform3f(
                                         float _p3
                                         )
 {
-  (*this)[m_currentShader]->setRegisteredUniform3f(_paramName,_p1,_p2,_p3);
+  m_currentProgram->setRegisteredUniform3f(_paramName,_p1,_p2,_p3);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -177,7 +178,7 @@ void ShaderLib::setShaderParam2f(
                                       float _p2
                                     )
 {
-	(*this)[m_currentShader]->setUniform2f(_paramName.c_str(),_p1,_p2);
+	m_currentProgram->setUniform2f(_paramName.c_str(),_p1,_p2);
 
 }
 
@@ -188,7 +189,7 @@ void ShaderLib::setRegisteredUniform2f(
                                         float _p2
                                         )
 {
-  (*this)[m_currentShader]->setRegisteredUniform2f(_paramName,_p1,_p2);
+  m_currentProgram->setRegisteredUniform2f(_paramName,_p1,_p2);
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::setShaderParam1i(
@@ -196,7 +197,7 @@ void ShaderLib::setShaderParam1i(
                                       int _p1
                                     )
 {
-	(*this)[m_currentShader]->setUniform1i(_paramName.c_str(),_p1);
+	m_currentProgram->setUniform1i(_paramName.c_str(),_p1);
 
 }
 
@@ -206,7 +207,7 @@ void ShaderLib::setRegisteredUniform1i(
                                       int _p1
                                       )
 {
-  (*this)[m_currentShader]->setRegisteredUniform1i(_paramName,_p1);
+  m_currentProgram->setRegisteredUniform1i(_paramName,_p1);
 }
 
 
@@ -217,7 +218,7 @@ void ShaderLib::setShaderParam1f(
                                       float _p1
                                     )
 {
-	(*this)[m_currentShader]->setUniform1f(_paramName.c_str(),_p1);
+	m_currentProgram->setUniform1f(_paramName.c_str(),_p1);
 
 }
 
@@ -227,7 +228,7 @@ void ShaderLib::setRegisteredUniform1f(
                                       float _p1
                                       )
 {
-  (*this)[m_currentShader]->setRegisteredUniform1f(_paramName,_p1);
+  m_currentProgram->setRegisteredUniform1f(_paramName,_p1);
 }
 
 
@@ -287,6 +288,11 @@ void ShaderLib::reset()
     delete sbegin->second;
     ++sbegin;
   }
+  // the maps would be left holding deleted pointers
+  m_shaderPrograms.clear();
+  m_shaders.clear();
+  m_currentShader="NULL";
+  m_currentProgram=m_nullProgram;
 
 }
 
@@ -327,6 +333,7 @@ ShaderLib::ShaderLib()
  m_numShaders=0;
  m_nullProgram = new ShaderProgram("NULL");
  m_currentShader="NULL";
+ m_currentProgram=m_nullProgram;
  loadTextShaders();
  loadColourShaders();
 }
@@ -334,7 +341,7 @@ ShaderLib::ShaderLib()
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::attachShader(
-                                  std::string _name,
+                                  const std::string &_name,
                                   SHADERTYPE _type
                                 )
 {
@@ -344,7 +351,7 @@ void ShaderLib::attachShader(
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::compileShader(
-																	 std::string _name
+																	 const std::string &_name
 																	)
 {
   // get an iterator to the shaders
@@ -360,7 +367,7 @@ void ShaderLib::compileShader(
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::createShaderProgram(
-																				 std::string _name
+																				 const std::string &_name
 																			  )
 {
  std::cerr<<"creating empty ShaderProgram "<<_name.c_str()<<"\n";
@@ -368,8 +375,8 @@ void ShaderLib::createShaderProgram(
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::attachShaderToProgram(
-																					 std::string _program,
-																					 std::string _shader
+																					 const std::string &_program,
+																					 const std::string &_shader
 																					)
 
 {
@@ -396,8 +403,8 @@ void ShaderLib::attachShaderToProgram(
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::loadShaderSource(
-																			std::string _shaderName,
-																			std::string _sourceFile
+																			const std::string &_shaderName,
+																			const std::string &_sourceFile
 																		 )
 {
   std::map <std::string, Shader * >::const_iterator shader=m_shaders.find(_shaderName);
@@ -430,7 +437,7 @@ void ShaderLib::loadShaderSourceFromString(const std::string &_shaderName,
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::linkProgramObject(
-																			 std::string _name
+																			 const std::string &_name
 																			)
 {
 
@@ -447,7 +454,7 @@ void ShaderLib::linkProgramObject(
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::use(
-												 std::string _name
+												 const std::string &_name
 												)
 {
   std::map <std::string, ShaderProgram * >::const_iterator program=m_shaderPrograms.find(_name);
@@ -456,13 +463,15 @@ void ShaderLib::use(
   {
     //std::cerr<<"Shader manager Use\n";
 		m_currentShader=_name;
+    m_currentProgram=program->second;
     program->second->use();
   }
   else
   {
     std::cerr<<"Warning Program not know in use "<<_name.c_str();
 		m_currentShader="NULL";
-    glUseProgram(0);
+    m_currentProgram=m_nullProgram;
+    GLStateCache::instance()->useProgram(0);
   }
 
 }
@@ -470,7 +479,7 @@ void ShaderLib::use(
 
 //----------------------------------------------------------------------------------------------------------------------
 GLuint ShaderLib::getProgramID(
-																		std::string _name
+																		const std::string &_name
 																	 )
 {
   std::map <std::string, ShaderProgram * >::const_iterator program=m_shaderPrograms.find(_name);
@@ -488,8 +497,8 @@ GLuint ShaderLib::getProgramID(
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::registerUniform(
-                                 std::string _shaderName,
-                                 std::string _uniformName
+                                 const std::string &_shaderName,
+                                 const std::string &_uniformName
                                )
 {
   std::map <std::string, ShaderProgram * >::const_iterator program=m_shaderPrograms.find(_shaderName);
@@ -507,7 +516,7 @@ void ShaderLib::registerUniform(
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::autoRegisterUniforms(
-                                      std::string _shaderName
+                                      const std::string &_shaderName
                                     )
 {
   std::map <std::string, ShaderProgram * >::const_iterator program=m_shaderPrograms.find(_shaderName);
@@ -524,9 +533,9 @@ void ShaderLib::autoRegisterUniforms(
 
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderLib::bindAttribute(
-																	 std::string _programName,
+																	 const std::string &_programName,
 																	 GLuint _index,
-																	 std::string _attribName
+																	 const std::string &_attribName
 																  )
 {
   std::map <std::string, ShaderProgram * >::const_iterator program=m_shaderPrograms.find(_programName);
@@ -561,6 +570,7 @@ ShaderProgram * ShaderLib::operator[](
 	if(program!=m_shaderPrograms.end() )
   {
 		m_currentShader=_name;
+		m_currentProgram=program->second;
 		return  program->second;
   }
   else
@@ -582,7 +592,7 @@ ShaderProgram * ShaderLib::operator[](
 	if(program!=m_shaderPrograms.end() )
   {
 		m_currentShader=_name;
-
+		m_currentProgram=program->second;
     return  program->second;
   }
   else
@@ -597,6 +607,7 @@ ShaderProgram * ShaderLib::operator[](
 void ShaderLib::useNullProgram()
 {
 	m_currentShader="NULL";
+  m_currentProgram=m_nullProgram;
   m_nullProgram->use();
 }
 
@@ -682,7 +693,7 @@ void ShaderLib::loadColourShaders()
 
 
 
-void ShaderLib::printRegisteredUniforms(std::string _shader) const
+void ShaderLib::printRegisteredUniforms(const std::string &_shader) const
 {
   std::map <std::string, ShaderProgram * >::const_iterator program=m_shaderPrograms.find(_shader);
   // make sure we have a valid  program
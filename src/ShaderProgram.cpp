@@ -27,10 +27,11 @@
 
 
 #include "ShaderProgram.h"
+#include "VertexArrayObject.h"
 namespace ngl
 {
 //----------------------------------------------------------------------------------------------------------------------
-ShaderProgram::ShaderProgram(std::string _name)
+ShaderProgram::ShaderProgram(const std::string &_name)
 {
   // we create a special NULL program so the shader manager can return
   // a NULL object.
@@ -51,13 +52,13 @@ if (_name !="NULL")
 ShaderProgram::~ShaderProgram()
 {
   std::cerr<<"removing shader program "<< m_programName<<"\n";
-  glDeleteProgram(m_programID);
+  GLStateCache::instance()->deleteProgram(m_programID);
 }
 //----------------------------------------------------------------------------------------------------------------------
 void ShaderProgram::use()
 {
  // std::cerr<<"Using shader "<<m_programName<<" id "<<m_programID<<"\n";
-  glUseProgram(m_programID);
+  GLStateCache::instance()->useProgram(m_programID);
   //NGLCheckGLError(__FILE__,__LINE__);
   m_active=true;
 }
@@ -66,7 +67,7 @@ void ShaderProgram::use()
 void ShaderProgram::unbind()
 {
   m_active=false;
-  glUseProgram(0);
+  GLStateCache::instance()->useProgram(0);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -77,7 +78,7 @@ void ShaderProgram::attatchShader(Shader *_shader)
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void ShaderProgram::bindAttribute(GLuint _index, std::string _attribName)
+void ShaderProgram::bindAttribute(GLuint _index, const std::string &_attribName)
 {
   if(m_linked == true)
   {
@@ -560,7 +561,8 @@ void ShaderProgram::enableAttribArray(
   if(index!=m_attribs.end())
   {
     std::cerr<<"Enable attrib "<<index->second<<"\n";
-    glEnableVertexAttribArray( index->second  );
+    VertexArrayObject::resetBinding();
+    GLStateCache::instance()->enableVertexAttribArray( index->second  );
   }
 }
 
@@ -569,7 +571,8 @@ void ShaderProgram::disableAttribArray(
                                         const char* _name
                                        ) const
 {
-  glDisableVertexAttribArray(getUniformLocation(_name));
+  VertexArrayObject::resetBinding();
+  GLStateCache::instance()->disableVertexAttribArray(getUniformLocation(_name));
 
 }
 
@@ -593,7 +596,7 @@ GLuint ShaderProgram::getUniformBlockIndex(
 
 
 void ShaderProgram::registerUniform(
-                                      std::string _uniformName
+                                      const std::string &_uniformName
                                     )
 {
 
@@ -0,0 +1,392 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include "SharedContextLoader.h"
+#include "VertexArrayObject.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SharedContextLoader.cpp
+/// @brief implementation files for SharedContextLoader class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+typedef boost::shared_ptr< std::vector<unsigned char> > ByteArray;
+
+//----------------------------------------------------------------------------------------------------------------------
+// the bytes per pixel for the unsigned byte formats GLES 2 supports
+static GLsizei bytesPerPixel(
+                             GLenum _format
+                            )
+{
+  switch(_format)
+  {
+    case GL_RGBA : return 4;
+    case GL_RGB : return 3;
+    case GL_LUMINANCE_ALPHA : return 2;
+    default : return 1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// copy the client data so the caller can free it before the job runs
+static ByteArray copyData(
+                          const void *_data,
+                          size_t _size
+                         )
+{
+  const unsigned char *data=static_cast<const unsigned char *>(_data);
+  return ByteArray(new std::vector<unsigned char>(data,data+_size));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the loader side of uploadBuffer
+static void bufferJob(
+                      GLenum _target,
+                      GLuint _buffer,
+                      GLenum _usage,
+                      ByteArray _data
+                     )
+{
+  glBindBuffer(_target,_buffer);
+  glBufferData(_target,_data->size(),&(*_data)[0],_usage);
+  glBindBuffer(_target,0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the loader side of uploadTexture
+static void textureJob(
+                       GLuint _texture,
+                       GLenum _format,
+                       GLsizei _width,
+                       GLsizei _height,
+                       ByteArray _data
+                      )
+{
+  glBindTexture(GL_TEXTURE_2D,_texture);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+  glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+  glTexImage2D(GL_TEXTURE_2D,0,_format,_width,_height,0,_format,GL_UNSIGNED_BYTE,&(*_data)[0]);
+  glPixelStorei(GL_UNPACK_ALIGNMENT,4);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D,0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+SharedContextLoader::SharedContextLoader(
+                                         EGLDisplay _display,
+                                         EGLConfig _config,
+                                         EGLContext _share
+                                        )
+{
+  m_display=_display;
+  m_context=EGL_NO_CONTEXT;
+  m_surface=EGL_NO_SURFACE;
+  m_createSync=0;
+  m_destroySync=0;
+  m_clientWaitSync=0;
+  m_nextID=0;
+  m_firstPendingID=0;
+  m_runID=0;
+  m_quit=false;
+  m_started=false;
+  m_current=false;
+
+  const char *extensions=eglQueryString(m_display,EGL_EXTENSIONS);
+  if(extensions !=0 && strstr(extensions,"EGL_KHR_fence_sync") !=0)
+  {
+    m_createSync=(PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+    m_destroySync=(PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+    m_clientWaitSync=(PFNEGLCLIENTWAITSYNCKHRPROC)eglGetProcAddress("eglClientWaitSyncKHR");
+    if(m_createSync == 0 || m_destroySync == 0 || m_clientWaitSync == 0)
+    {
+      m_createSync=0;
+    }
+  }
+  if(m_createSync == 0)
+  {
+    std::cerr<<"EGL_KHR_fence_sync not found, loader jobs will use glFinish\n";
+  }
+  // the loader needs a surface to be made current, a 1x1 pbuffer if the config allows it
+  EGLint surfaceType=0;
+  eglGetConfigAttrib(m_display,_config,EGL_SURFACE_TYPE,&surfaceType);
+  if(surfaceType & EGL_PBUFFER_BIT)
+  {
+    const EGLint pbufferAttributes[] =
+    {
+      EGL_WIDTH, 1,
+      EGL_HEIGHT, 1,
+      EGL_NONE
+    };
+    m_surface=eglCreatePbufferSurface(m_display,_config,pbufferAttributes);
+  }
+  if(m_surface == EGL_NO_SURFACE && (extensions == 0 || strstr(extensions,"EGL_KHR_surfaceless_context") == 0))
+  {
+    std::cerr<<"couldn't create a loader surface, add EGL_PBUFFER_BIT to the config surface type\n";
+    return;
+  }
+  static const EGLint contextAttributes[] =
+  {
+    EGL_CONTEXT_CLIENT_VERSION, 2,
+    EGL_NONE
+  };
+  m_context=eglCreateContext(m_display,_config,_share,contextAttributes);
+  if(m_context == EGL_NO_CONTEXT)
+  {
+    std::cerr<<"couldn't create a shared loader context\n";
+    if(m_surface != EGL_NO_SURFACE)
+    {
+      eglDestroySurface(m_display,m_surface);
+      m_surface=EGL_NO_SURFACE;
+    }
+    return;
+  }
+  m_thread=boost::thread(boost::bind(&SharedContextLoader::loaderLoop,this));
+  // wait for the loader to make its context current, if it can't the loader is invalid so submit
+  // runs the jobs on the calling thread instead of queueing them for a thread that can't run them
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while(m_started == false)
+    {
+      m_ran.wait(lock);
+    }
+  }
+  if(m_current == false)
+  {
+    m_thread.join();
+    eglDestroyContext(m_display,m_context);
+    m_context=EGL_NO_CONTEXT;
+    if(m_surface != EGL_NO_SURFACE)
+    {
+      eglDestroySurface(m_display,m_surface);
+      m_surface=EGL_NO_SURFACE;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+SharedContextLoader::~SharedContextLoader()
+{
+  if(isValid() == false)
+  {
+    return;
+  }
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_quit=true;
+  }
+  m_wake.notify_all();
+  m_thread.join();
+  for(size_t i=0; i<m_fences.size(); ++i)
+  {
+    if(m_fences[i].m_sync != EGL_NO_SYNC_KHR)
+    {
+      m_destroySync(m_display,m_fences[i].m_sync);
+    }
+  }
+  eglDestroyContext(m_display,m_context);
+  if(m_surface != EGL_NO_SURFACE)
+  {
+    eglDestroySurface(m_display,m_surface);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SharedContextLoader::loaderLoop()
+{
+  eglBindAPI(EGL_OPENGL_ES_API);
+  bool current=eglMakeCurrent(m_display,m_surface,m_surface,m_context) != EGL_FALSE;
+  if(current == false)
+  {
+    std::cerr<<"couldn't make the loader context current, jobs will run on the calling thread\n";
+  }
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_started=true;
+    m_current=current;
+  }
+  m_ran.notify_all();
+  if(current == false)
+  {
+    eglReleaseThread();
+    return;
+  }
+  for(;;)
+  {
+    Job job;
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while(m_jobs.empty() == true && m_quit == false)
+      {
+        m_wake.wait(lock);
+      }
+      // the queued jobs are finished before quitting so nothing submitted is lost
+      if(m_jobs.empty() == true)
+      {
+        break;
+      }
+      job=m_jobs.front();
+      m_jobs.pop_front();
+    }
+    job();
+    Fence fence;
+    fence.m_sync=EGL_NO_SYNC_KHR;
+    if(m_createSync !=0)
+    {
+      fence.m_sync=m_createSync(m_display,EGL_SYNC_FENCE_KHR,0);
+    }
+    // the flush makes sure the fence is submitted so waiting on it from the render thread can't hang
+    if(fence.m_sync != EGL_NO_SYNC_KHR)
+    {
+      glFlush();
+    }
+    else
+    {
+      glFinish();
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    fence.m_id=m_runID++;
+    m_fences.push_back(fence);
+    m_ran.notify_all();
+  }
+  eglMakeCurrent(m_display,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+  eglReleaseThread();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int SharedContextLoader::submit(
+                                         const Job &_job
+                                        )
+{
+  if(isValid() == false)
+  {
+    // no loader context so do the work now on the calling thread, the job's binds aren't in the state cache
+    _job();
+    GLStateCache::instance()->invalidate();
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_firstPendingID=++m_nextID;
+    return m_nextID-1;
+  }
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_jobs.push_back(_job);
+  m_wake.notify_one();
+  return m_nextID++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+GLuint SharedContextLoader::uploadBuffer(
+                                         GLenum _target,
+                                         size_t _size,
+                                         const void *_data,
+                                         unsigned int &o_id,
+                                         GLenum _usage
+                                        )
+{
+  // names are shared between the contexts so the buffer can be made here
+  GLuint buffer;
+  glGenBuffers(1,&buffer);
+  // without a loader context the job runs here and mustn't change the render thread's bound VAO
+  if(isValid() == false && _target == GL_ELEMENT_ARRAY_BUFFER)
+  {
+    VertexArrayObject::resetBinding();
+  }
+  o_id=submit(boost::bind(bufferJob,_target,buffer,_usage,copyData(_data,_size)));
+  return buffer;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+GLuint SharedContextLoader::uploadTexture(
+                                          GLenum _format,
+                                          GLsizei _width,
+                                          GLsizei _height,
+                                          const void *_data,
+                                          unsigned int &o_id
+                                         )
+{
+  GLuint texture;
+  glGenTextures(1,&texture);
+  size_t size=size_t(_width)*_height*bytesPerPixel(_format);
+  o_id=submit(boost::bind(textureJob,texture,_format,_width,_height,copyData(_data,size)));
+  return texture;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int SharedContextLoader::processCompleted()
+{
+  unsigned int done=0;
+  boost::mutex::scoped_lock lock(m_mutex);
+  while(m_fences.empty() == false)
+  {
+    Fence &fence=m_fences.front();
+    if(fence.m_sync != EGL_NO_SYNC_KHR)
+    {
+      // a zero timeout just polls the fence
+      if(m_clientWaitSync(m_display,fence.m_sync,0,0) != EGL_CONDITION_SATISFIED_KHR)
+      {
+        break;
+      }
+      m_destroySync(m_display,fence.m_sync);
+    }
+    m_firstPendingID=fence.m_id+1;
+    m_fences.pop_front();
+    ++done;
+  }
+  return done;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void SharedContextLoader::finish()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  while(m_runID != m_nextID && isValid() == true)
+  {
+    m_ran.wait(lock);
+  }
+  while(m_fences.empty() == false)
+  {
+    Fence &fence=m_fences.front();
+    if(fence.m_sync != EGL_NO_SYNC_KHR)
+    {
+      m_clientWaitSync(m_display,fence.m_sync,0,EGL_FOREVER_KHR);
+      m_destroySync(m_display,fence.m_sync);
+    }
+    m_firstPendingID=fence.m_id+1;
+    m_fences.pop_front();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+bool SharedContextLoader::isReady(
+                                  unsigned int _id
+                                 ) const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return _id < m_firstPendingID;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int SharedContextLoader::getNumPending() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_nextID-m_firstPendingID;
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
@@ -1,5 +1,6 @@
 #include "Text.h"
 #include "VertexArrayObject.h"
+#include "GLStateCache.h"
 #include <iostream>
 #include "ShaderLib.h"
 #include <boost/foreach.hpp>
@@ -175,7 +176,7 @@ Text::Text(
 
      // now we create the OpenGL texture ID and bind to make it active
     glGenTextures(1, &fc.textureID);
-    glBindTexture(GL_TEXTURE_2D, fc.textureID);
+    GLStateCache::instance()->bindTexture(GL_TEXTURE_2D, fc.textureID);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, widthPow2, heightPow2,
@@ -280,7 +281,7 @@ Text::~Text()
 
   BOOST_FOREACH(map_t::value_type &i, m_characters)
   {
-    glDeleteTextures(1,&i.second.textureID);
+    GLStateCache::instance()->deleteTextures(1,&i.second.textureID);
     i.second.vao->removeVOA();
   }
 
@@ -298,7 +299,8 @@ void Text::renderText(
 {
   // make sure we are in texture unit 0 as this is what the
   // shader expects
-  glActiveTexture(0);
+  GLStateCache *cache=GLStateCache::instance();
+  cache->activeTexture(GL_TEXTURE0);
   // grab an instance of the shader manager
   ngl::ShaderLib *shader=ngl::ShaderLib::instance();
   // use the built in text rendering shader
@@ -308,9 +310,9 @@ void Text::renderText(
   shader->setRegisteredUniform1f("ypos",_y);
   // now enable blending and disable depth sorting so the font renders
   // correctly
-  glEnable(GL_BLEND);
-  glDisable(GL_DEPTH_TEST);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  cache->enable(GL_BLEND);
+  cache->disable(GL_DEPTH_TEST);
+  cache->blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   // now loop for each of the char and draw our billboard
   unsigned int textLength=text.length();
 
@@ -323,7 +325,7 @@ void Text::renderText(
     char c=text[i];
     FontChar f = m_characters[c];
     // bind the pre-generated texture
-    glBindTexture(GL_TEXTURE_2D, f.textureID);
+    cache->bindTexture(GL_TEXTURE_2D, f.textureID);
     std::cerr<<"doing draw for "<<c<<" "<<f.textureID<<"\n";
     // bind the vao
     f.vao->bind();
@@ -337,8 +339,8 @@ void Text::renderText(
 
   }
   // finally disable the blend and re-enable depth sort
-  glDisable(GL_BLEND);
-  glEnable(GL_DEPTH_TEST);
+  cache->disable(GL_BLEND);
+  cache->enable(GL_DEPTH_TEST);
 
 }
 
@@ -20,6 +20,8 @@
 //----------------------------------------------------------------------------------------------------------------------
 #include "Texture.h"
 #include "NGLassert.h"
+#include "UploadQueue.h"
+#include "GLStateCache.h"
 #include <Magick++.h>
 #include <Magick++/Exception.h>
 
@@ -155,8 +157,8 @@ GLuint Texture::setTextureGL() const
 {
   GLuint textureName;
   glGenTextures(1,&textureName);
-  glActiveTexture(GL_TEXTURE0+m_multiTextureID);
-  glBindTexture(GL_TEXTURE_2D,textureName);
+  GLStateCache::instance()->activeTexture(GL_TEXTURE0+m_multiTextureID);
+  GLStateCache::instance()->bindTexture(GL_TEXTURE_2D,textureName);
   glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
   glTexImage2D(GL_TEXTURE_2D,0,m_format,m_width,m_height,0,m_format,GL_UNSIGNED_BYTE,m_data);
@@ -167,6 +169,24 @@ GLuint Texture::setTextureGL() const
   return textureName;
 }
 //----------------------------------------------------------------------------------------------------------------------
+GLuint Texture::setTextureGLDeferred(
+                                     unsigned int *o_uploadID
+                                    ) const
+{
+  GLuint textureName;
+  glGenTextures(1,&textureName);
+  GLStateCache::instance()->activeTexture(GL_TEXTURE0+m_multiTextureID);
+  GLStateCache::instance()->bindTexture(GL_TEXTURE_2D,textureName);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+  unsigned int id=UploadQueue::instance()->queueTexture(textureName,m_format,m_width,m_height,m_data);
+  if(o_uploadID !=0)
+  {
+    *o_uploadID=id;
+  }
+  return textureName;
+}
+//----------------------------------------------------------------------------------------------------------------------
 
 void Texture::setMultiTexture(
                               const GLint _id
@@ -90,7 +90,7 @@ std::ostream& operator<<(std::ostream& _output,  TransformStack& _m)
 }
 
 void TransformStack::loadMatrixToShader(
-                                        std::string _param,
+                                        const std::string &_param,
                                         ACTIVEMATRIX _which
                                        )
 {
@@ -98,7 +98,7 @@ void TransformStack::loadMatrixToShader(
 }
 
 void TransformStack::loadGlobalAndCurrentMatrixToShader(
-                                                        std::string _param,
+                                                        const std::string &_param,
                                                         ACTIVEMATRIX _which
                                                        )
 {
@@ -106,7 +106,7 @@ void TransformStack::loadGlobalAndCurrentMatrixToShader(
 }
 
 void TransformStack::loadGlobalMatrixToShader(
-                                                std::string _param,
+                                                const std::string &_param,
                                                 ACTIVEMATRIX _which
                                                )
 {
@@ -0,0 +1,225 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sys/time.h>
+#include "UploadQueue.h"
+#include "GLStateCache.h"
+#include "VertexArrayObject.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file UploadQueue.cpp
+/// @brief implementation files for UploadQueue class
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+// the time in milli seconds, only used for differences
+static double milliSeconds()
+{
+  timeval t;
+  gettimeofday(&t,0);
+  return t.tv_sec*1000.0+t.tv_usec/1000.0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// the bytes per pixel for the unsigned byte formats GLES 2 supports
+static GLsizei bytesPerPixel(
+                             GLenum _format
+                            )
+{
+  switch(_format)
+  {
+    case GL_RGBA : return 4;
+    case GL_RGB : return 3;
+    case GL_LUMINANCE_ALPHA : return 2;
+    default : return 1;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+UploadQueue::UploadQueue()
+{
+  m_firstPendingID=0;
+  m_nextID=0;
+  m_byteBudget=1024*1024;
+  m_timeBudget=2.0f;
+  m_sliceSize=64*1024;
+  m_backlogBytes=0;
+  memset(&m_stats,0,sizeof(UploadStats));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int UploadQueue::queueBuffer(
+                                      GLenum _target,
+                                      GLuint _buffer,
+                                      size_t _size,
+                                      const void *_data,
+                                      GLenum _usage
+                                     )
+{
+  // allocate the storage now, the contents are filled in by processFrame
+  if(_target == GL_ELEMENT_ARRAY_BUFFER)
+  {
+    VertexArrayObject::resetBinding();
+  }
+  GLStateCache::instance()->bindBuffer(_target,_buffer);
+  glBufferData(_target,_size,0,_usage);
+  m_jobs.push_back(Upload());
+  Upload &u=m_jobs.back();
+  u.m_target=_target;
+  u.m_id=_buffer;
+  u.m_format=0;
+  u.m_width=u.m_height=0;
+  u.m_mipmap=false;
+  u.m_offset=0;
+  const unsigned char *data=static_cast<const unsigned char *>(_data);
+  u.m_data.assign(data,data+_size);
+  m_backlogBytes+=_size;
+  return m_nextID++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int UploadQueue::queueTexture(
+                                       GLuint _texture,
+                                       GLenum _format,
+                                       GLsizei _width,
+                                       GLsizei _height,
+                                       const void *_data,
+                                       bool _mipmap
+                                      )
+{
+  GLStateCache::instance()->bindTexture(GL_TEXTURE_2D,_texture);
+  glTexImage2D(GL_TEXTURE_2D,0,_format,_width,_height,0,_format,GL_UNSIGNED_BYTE,0);
+  m_jobs.push_back(Upload());
+  Upload &u=m_jobs.back();
+  u.m_target=GL_TEXTURE_2D;
+  u.m_id=_texture;
+  u.m_format=_format;
+  u.m_width=_width;
+  u.m_height=_height;
+  u.m_mipmap=_mipmap;
+  u.m_offset=0;
+  // a zero sized (or bad) texture has nothing to upload so it goes in as an empty job
+  // that processFrame completes without a glTexSubImage2D call
+  size_t size=0;
+  if(_width > 0 && _height > 0)
+  {
+    size=size_t(_width)*_height*bytesPerPixel(_format);
+  }
+  else if(_width < 0 || _height < 0)
+  {
+    std::cerr<<"warning queueTexture size "<<_width<<"x"<<_height<<" is negative, nothing uploaded\n";
+  }
+  const unsigned char *data=static_cast<const unsigned char *>(_data);
+  u.m_data.assign(data,data+size);
+  m_backlogBytes+=size;
+  return m_nextID++;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+size_t UploadQueue::uploadSlice()
+{
+  Upload &u=m_jobs.front();
+  size_t remaining=u.m_data.size()-u.m_offset;
+  size_t bytes;
+  if(remaining == 0)
+  {
+    // empty uploads just complete
+    bytes=0;
+  }
+  else if(u.m_target == GL_TEXTURE_2D)
+  {
+    // textures go up in whole rows, always at least one
+    size_t rowBytes=size_t(u.m_width)*bytesPerPixel(u.m_format);
+    size_t row=u.m_offset/rowBytes;
+    size_t rows=std::max(size_t(1),m_sliceSize/rowBytes);
+    rows=std::min(rows,size_t(u.m_height)-row);
+    bytes=rows*rowBytes;
+    GLStateCache::instance()->bindTexture(GL_TEXTURE_2D,u.m_id);
+    // the rows are tightly packed so may not be 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+    glTexSubImage2D(GL_TEXTURE_2D,0,0,row,u.m_width,rows,u.m_format,GL_UNSIGNED_BYTE,&u.m_data[u.m_offset]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT,4);
+  }
+  else
+  {
+    bytes=std::min(m_sliceSize,remaining);
+    if(u.m_target == GL_ELEMENT_ARRAY_BUFFER)
+    {
+      VertexArrayObject::resetBinding();
+    }
+    GLStateCache::instance()->bindBuffer(u.m_target,u.m_id);
+    glBufferSubData(u.m_target,u.m_offset,bytes,&u.m_data[u.m_offset]);
+  }
+  u.m_offset+=bytes;
+  m_backlogBytes-=bytes;
+  if(u.m_offset >= u.m_data.size())
+  {
+    if(u.m_mipmap == true && u.m_data.empty() == false)
+    {
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    m_jobs.pop_front();
+    ++m_firstPendingID;
+    ++m_stats.m_completed;
+  }
+  return bytes;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+const UploadStats &UploadQueue::processFrame()
+{
+  double start=milliSeconds();
+  m_stats.m_bytesUploaded=0;
+  m_stats.m_slices=0;
+  m_stats.m_completed=0;
+  while(m_jobs.empty() == false)
+  {
+    // always do at least one slice so the queue can't stall with a tiny budget
+    if(m_stats.m_slices !=0)
+    {
+      if(m_byteBudget !=0 && m_stats.m_bytesUploaded+m_sliceSize > m_byteBudget)
+      {
+        break;
+      }
+      if(m_timeBudget > 0.0f && milliSeconds()-start >= m_timeBudget)
+      {
+        break;
+      }
+    }
+    m_stats.m_bytesUploaded+=uploadSlice();
+    ++m_stats.m_slices;
+  }
+  m_stats.m_timeMs=milliSeconds()-start;
+  m_stats.m_backlogBytes=m_backlogBytes;
+  m_stats.m_backlogItems=m_jobs.size();
+  return m_stats;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void UploadQueue::flush()
+{
+  while(m_jobs.empty() == false)
+  {
+    uploadSlice();
+  }
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------
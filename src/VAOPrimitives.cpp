@@ -19,6 +19,7 @@
 #include <cstdlib>
 #include "VAOPrimitives.h"
 #include "Meshes.h"
+#include "NCCABinaryMesh.h"
 #include "Util.h"
 
 
@@ -33,21 +34,30 @@ namespace ngl
 
 //----------------------------------------------------------------------------------------------------------------------
 VAOPrimitives::VAOPrimitives()
+{
+	m_vertexFormat=VERTEX_FLOAT;
+	createDefaultVAOs(VERTEX_FLOAT);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VAOPrimitives::createDefaultVAOs(
+                                      const VERTEXFORMAT _format
+                                     )
 {
 	// load into the vbo list some basic primitives (these are created in .h file arrays from Obj2VBO)
 	// Obj2VBO and the original models may be found in the Models directory
-	createVAOFromHeader("teapot",teapot,teapotSIZE);
-	createVAOFromHeader("octahedron",Octahedron,OctahedronSIZE);
-	createVAOFromHeader("dodecahedron",dodecahedron,dodecahedronSIZE);
-	createVAOFromHeader("icosahedron",icosahedron,icosahedronSIZE);
-	createVAOFromHeader("tetrahedron",tetrahedron,tetrahedronSIZE);
-	createVAOFromHeader("football",football,footballSIZE);
-	createVAOFromHeader("cube",cube,cubeSIZE);
+	createVAOFromHeader("teapot",teapot,teapotSIZE,_format);
+	createVAOFromHeader("octahedron",Octahedron,OctahedronSIZE,_format);
+	createVAOFromHeader("dodecahedron",dodecahedron,dodecahedronSIZE,_format);
+	createVAOFromHeader("icosahedron",icosahedron,icosahedronSIZE,_format);
+	createVAOFromHeader("tetrahedron",tetrahedron,tetrahedronSIZE,_format);
+	createVAOFromHeader("football",football,footballSIZE,_format);
+	createVAOFromHeader("cube",cube,cubeSIZE,_format);
 	#ifdef LARGEMODELS
-  	createVAOFromHeader("troll",troll,trollSIZE);
-  	createVAOFromHeader("bunny",bunny,bunnySIZE);
-  	createVAOFromHeader("dragon",dragon,dragonSIZE);
-  	createVAOFromHeader("buddah",buddah,buddahSIZE);
+  	createVAOFromHeader("troll",troll,trollSIZE,_format);
+  	createVAOFromHeader("bunny",bunny,bunnySIZE,_format);
+  	createVAOFromHeader("dragon",dragon,dragonSIZE,_format);
+  	createVAOFromHeader("buddah",buddah,buddahSIZE,_format);
 	#endif
 }
 
@@ -76,12 +86,10 @@ void VAOPrimitives::draw(
 void VAOPrimitives::createVAOFromHeader(
                                         const std::string &_name,
                                         const Real *_data,
-                                        const unsigned int _size
+                                        const unsigned int _size,
+                                        const VERTEXFORMAT _format
                                        )
 {
-	VertexArrayObject *vao = ngl::VertexArrayObject::createVOA(GL_TRIANGLES);
-	// next we bind it so it's active for setting data
-	vao->bind();
     std::vector <vertData> data;
     vertData d;
 	// format tx,ty,nx,ny,nz,vx,vy,vz so increment by 8
@@ -97,33 +105,7 @@ void VAOPrimitives::createVAOFromHeader(
 	  d.z=_data[i+7];
       data.push_back(d);
 	}
-	// now we have our data add it to the VAO, we need to tell the VAO the following
-	// how much (in bytes) data we are copying
-	// a pointer to the first element of data (in this case the address of the first element of the
-	// std::vector
-    vao->setData(data.size()*sizeof(vertData),data[0].u);
-	// in this case we have packed our data in interleaved format as follows
-	// u,v,nx,ny,nz,x,y,z
-	// If you look at the shader we have the following attributes being used
-	// attribute vec3 inVert; attribute 0
-	// attribute vec2 inUV; attribute 1
-	// attribute vec3 inNormal; attribure 2
-	// so we need to set the vertexAttributePointer so the correct size and type as follows
-	// vertex is attribute 0 with x,y,z(3) parts of type GL_FLOAT, our complete packed data is
-	// sizeof(vertData) and the offset into the data structure for the first x component is 5 (u,v,nx,ny,nz)..x
-    vao->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(vertData),5);
-	// uv same as above but starts at 0 and is attrib 1 and only u,v so 2
-    vao->setVertexAttributePointer(1,2,GL_FLOAT,sizeof(vertData),0);
-	// normal same as vertex only starts at position 2 (u,v)-> nx
-    vao->setVertexAttributePointer(2,3,GL_FLOAT,sizeof(vertData),2);
-	// now we have set the vertex attributes we tell the VAO class how many indices to draw when
-	// glDrawArrays is called, in this case we use buffSize (but if we wished less of the sphere to be drawn we could
-	// specify less (in steps of 3))
-	vao->setNumIndices(data.size());
-	// finally we have finished for now so time to unbind the VAO
-	vao->unbind();
-	m_createdVAOs[_name]=vao;
-
+	createVAO(_name,data,GL_TRIANGLES,_format);
 }
 
 void VAOPrimitives::createLineGrid(
@@ -179,7 +161,7 @@ void VAOPrimitives::createLineGrid(
 			v2+=dstep;
 	  }
 
-	createVAO(_name,data,GL_LINES);
+	createVAO(_name,data,GL_LINES,m_vertexFormat);
 
 }
 
@@ -246,7 +228,7 @@ void VAOPrimitives::createSphere(
 		} // end inner loop
 	}// end outer loop
 
-createVAO(_name,data,GL_TRIANGLE_STRIP);
+createVAO(_name,data,GL_TRIANGLE_STRIP,m_vertexFormat);
 
 }
 
@@ -254,33 +236,57 @@ createVAO(_name,data,GL_TRIANGLE_STRIP);
 void VAOPrimitives::createVAO(
 														  const std::string &_name,
                               const std::vector<vertData> &_data,
-															const GLenum _mode
+															const GLenum _mode,
+                              const VERTEXFORMAT _format
 														 )
 {
+	// re-creating a primitive (say in another format) replaces the old VAO so delete its GL objects first
+	std::map <std::string, VertexArrayObject * >::iterator old=m_createdVAOs.find(_name);
+	if(old !=m_createdVAOs.end())
+	{
+		old->second->removeVOA();
+	}
 
 	VertexArrayObject *vao = ngl::VertexArrayObject::createVOA(_mode);
 	// next we bind it so it's active for setting data
 	vao->bind();
 
-	// now we have our data add it to the VAO, we need to tell the VAO the following
-	// how much (in bytes) data we are copying
-	// a pointer to the first element of data (in this case the address of the first element of the
-	// std::vector
-    vao->setData(_data.size()*sizeof(vertData),_data[0].u);
-	// in this case we have packed our data in interleaved format as follows
-	// u,v,nx,ny,nz,x,y,z
-	// If you look at the shader we have the following attributes being used
-	// attribute vec3 inVert; attribute 0
-	// attribute vec2 inUV; attribute 1
-	// attribute vec3 inNormal; attribure 2
-	// so we need to set the vertexAttributePointer so the correct size and type as follows
-	// vertex is attribute 0 with x,y,z(3) parts of type GL_FLOAT, our complete packed data is
-	// sizeof(vertData) and the offset into the data structure for the first x component is 5 (u,v,nx,ny,nz)..x
-    vao->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(vertData),5);
-	// uv same as above but starts at 0 and is attrib 1 and only u,v so 2
-    vao->setVertexAttributePointer(1,2,GL_FLOAT,sizeof(vertData),0);
-	// normal same as vertex only starts at position 2 (u,v)-> nx
-    vao->setVertexAttributePointer(2,3,GL_FLOAT,sizeof(vertData),2);
+	if(_format == VERTEX_QUANTISED)
+	{
+		std::vector <QuantisedVertData> quantised;
+		Vec4 uvTransform;
+		m_dequantise[_name]=quantiseVertData(&_data[0].u,_data.size(),quantised,&uvTransform);
+		if(uvTransform.m_z !=0.0f || uvTransform.m_w !=0.0f || uvTransform.m_x !=1.0f || uvTransform.m_y !=1.0f)
+		{
+			std::cerr<<"warning "<<_name<<" has uvs outside 0-1 which will be re-scaled by quantisation\n";
+		}
+		// the quantised vertex is 16 bytes, see VertexQuantiser.h for the layout
+		vao->setData(quantised.size()*sizeof(QuantisedVertData),*reinterpret_cast<const GLfloat *>(&quantised[0]));
+		setQuantisedVertDataAttributes(vao);
+	}
+	else
+	{
+		m_dequantise.erase(_name);
+		// now we have our data add it to the VAO, we need to tell the VAO the following
+		// how much (in bytes) data we are copying
+		// a pointer to the first element of data (in this case the address of the first element of the
+		// std::vector
+		vao->setData(_data.size()*sizeof(vertData),_data[0].u);
+		// in this case we have packed our data in interleaved format as follows
+		// u,v,nx,ny,nz,x,y,z
+		// If you look at the shader we have the following attributes being used
+		// attribute vec3 inVert; attribute 0
+		// attribute vec2 inUV; attribute 1
+		// attribute vec3 inNormal; attribure 2
+		// so we need to set the vertexAttributePointer so the correct size and type as follows
+		// vertex is attribute 0 with x,y,z(3) parts of type GL_FLOAT, our complete packed data is
+		// sizeof(vertData) and the offset into the data structure for the first x component is 5 (u,v,nx,ny,nz)..x
+		vao->setVertexAttributePointer(0,3,GL_FLOAT,sizeof(vertData),5);
+		// uv same as above but starts at 0 and is attrib 1 and only u,v so 2
+		vao->setVertexAttributePointer(1,2,GL_FLOAT,sizeof(vertData),0);
+		// normal same as vertex only starts at position 2 (u,v)-> nx
+		vao->setVertexAttributePointer(2,3,GL_FLOAT,sizeof(vertData),2);
+	}
 	// now we have set the vertex attributes we tell the VAO class how many indices to draw when
 	// glDrawArrays is called, in this case we use buffSize (but if we wished less of the sphere to be drawn we could
 	// specify less (in steps of 3))
@@ -291,6 +297,16 @@ void VAOPrimitives::createVAO(
 
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+Mat4 VAOPrimitives::getDequantiseTransform(
+                                           const std::string &_name
+                                          ) const
+{
+  std::map <std::string,Mat4>::const_iterator it=m_dequantise.find(_name);
+  // primitives stored as floats don't need any transform
+  return it !=m_dequantise.end() ? it->second : Mat4();
+}
+
 /*----------------------------------------------------------------------------------------------------------------------
  * Compute lookup table of cos and sin values forming a cirle
  * borrowed from free glut implimentation of primitive drawing
@@ -442,7 +458,7 @@ void VAOPrimitives::createCylinder(
 			z0 = z1; z1 += zStep;
 	}
 	// create VAO
-  createVAO(_name,data,GL_TRIANGLES);
+  createVAO(_name,data,GL_TRIANGLES,m_vertexFormat);
 
 	/* Release sin and cos tables */
 
@@ -532,7 +548,7 @@ void VAOPrimitives::createCone(
 	}
 	// create VAO
 
-  createVAO(_name,data,GL_TRIANGLE_STRIP);
+  createVAO(_name,data,GL_TRIANGLE_STRIP,m_vertexFormat);
 	/* Release sin and cos tables */
 
 	delete [] sint;
@@ -586,7 +602,7 @@ void VAOPrimitives::createDisk(
 		u+=du;
 	}
 	// create VBO
-	createVAO(_name,data,GL_TRIANGLE_FAN);
+	createVAO(_name,data,GL_TRIANGLE_FAN,m_vertexFormat);
 
 	/* Release sin and cos tables */
 	delete [] sint;
@@ -765,7 +781,7 @@ void VAOPrimitives::createTorus(
 
 	// now create the VBO
 
-  createVAO(_name,data,GL_TRIANGLES);
+  createVAO(_name,data,GL_TRIANGLES,m_vertexFormat);
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -852,10 +868,31 @@ void VAOPrimitives::createTrianglePlane(
 		v+=du;
 	} // end d loop
 	// now create the VBO
-	createVAO(_name,data,GL_TRIANGLES);
+	createVAO(_name,data,GL_TRIANGLES,m_vertexFormat);
 }
 
 
+//----------------------------------------------------------------------------------------------------------------------
+void VAOPrimitives::loadBinary(
+                               const std::string &_name,
+                               const std::string &_fName,
+                               const GLenum _type
+                              )
+{
+  // map the file and give the buffers straight to GL, we don't need a BBox for primitives
+  NCCABinaryMesh mesh;
+  if(mesh.load(_fName,false) == false)
+  {
+    std::cerr<<"unable to load binary mesh "<<_fName<<" for "<<_name<<"\n";
+    return;
+  }
+  VertexArrayObject *vao=mesh.createVAOFromFile(_type);
+  if(vao !=0)
+  {
+    m_createdVAOs[_name]=vao;
+  }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 void VAOPrimitives::clear()
 {
@@ -876,6 +913,7 @@ void VAOPrimitives::clear()
 		//glDeleteVertexArrays(1,&address);
 	}
 	m_createdVAOs.erase(m_createdVAOs.begin(),m_createdVAOs.end());
+	m_dequantise.clear();
 }
 
 
@@ -16,6 +16,10 @@
 */
 
 #include "VertexArrayObject.h"
+#include "UploadQueue.h"
+#include <EGL/egl.h>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 //----------------------------------------------------------------------------------------------------------------------
 /// @file VertexArrayObject.cpp
@@ -31,7 +35,8 @@ VertexAttribute::VertexAttribute(
 																	GLenum _type,
 																	GLsizei _stride,
 																	unsigned int _dataOffset,
-																	bool _normalise
+																	bool _normalise,
+																	GLuint _buffer
 																 )
 {
 	m_id=_id;
@@ -40,9 +45,20 @@ VertexAttribute::VertexAttribute(
 	m_stride=_stride;
 	m_dataOffset=_dataOffset;
 	m_normalise=_normalise;
+	m_buffer=_buffer;
 }
 
 
+bool VertexArrayObject::s_extensionChecked=false;
+bool VertexArrayObject::s_useExtension=false;
+bool VertexArrayObject::s_allowExtension=true;
+bool VertexArrayObject::s_uintIndices=false;
+PFNGLMAPBUFFEROESPROC VertexArrayObject::s_mapBuffer=0;
+PFNGLUNMAPBUFFEROESPROC VertexArrayObject::s_unmapBuffer=0;
+PFNGLGENVERTEXARRAYSOESPROC VertexArrayObject::s_genVertexArrays=0;
+PFNGLDELETEVERTEXARRAYSOESPROC VertexArrayObject::s_deleteVertexArrays=0;
+const VertexArrayObject *VertexArrayObject::s_layoutOwner=0;
+unsigned int VertexArrayObject::s_layoutBuffer=0;
 
 //----------------------------------------------------------------------------------------------------------------------
 VertexArrayObject::VertexArrayObject(
@@ -50,49 +66,90 @@ VertexArrayObject::VertexArrayObject(
 																		 )
 {
 	m_allocated=false;
-	// first we create a vertex array Object
-
-  //glGenVertexArraysOES(1, &m_id);
+	// the GL VAOs are made at the first draw once we know how many buffers there are
+	m_id=0;
 	m_bound=false;
+	m_dirty=true;
 	m_drawMode=_mode;
 	m_indicesCount=0;
 	m_indexed=false;
+	m_indexType=GL_UNSIGNED_BYTE;
+	m_dynamicSize=0;
+	m_dynamicOffset=0;
+	m_dynamicOrphans=0;
+	checkExtension();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void VertexArrayObject::bind()
+void VertexArrayObject::checkExtension()
 {
-/*
-struct vertData
+	if(s_extensionChecked == true)
+	{
+		return;
+	}
+	s_extensionChecked=true;
+	const char *extensions=reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+	s_uintIndices=extensions !=0 && strstr(extensions,"GL_OES_element_index_uint") !=0;
+	if(extensions !=0 && strstr(extensions,"GL_OES_mapbuffer") !=0)
+	{
+		s_mapBuffer=(PFNGLMAPBUFFEROESPROC)eglGetProcAddress("glMapBufferOES");
+		s_unmapBuffer=(PFNGLUNMAPBUFFEROESPROC)eglGetProcAddress("glUnmapBufferOES");
+		if(s_mapBuffer == 0 || s_unmapBuffer == 0)
+		{
+			s_mapBuffer=0;
+			s_unmapBuffer=0;
+		}
+	}
+	if(s_allowExtension == false || extensions == 0 || strstr(extensions,"GL_OES_vertex_array_object") == 0)
+	{
+		return;
+	}
+	s_genVertexArrays=(PFNGLGENVERTEXARRAYSOESPROC)eglGetProcAddress("glGenVertexArraysOES");
+	PFNGLBINDVERTEXARRAYOESPROC bindVertexArray=(PFNGLBINDVERTEXARRAYOESPROC)eglGetProcAddress("glBindVertexArrayOES");
+	s_deleteVertexArrays=(PFNGLDELETEVERTEXARRAYSOESPROC)eglGetProcAddress("glDeleteVertexArraysOES");
+	s_useExtension=s_genVertexArrays !=0 && bindVertexArray !=0 && s_deleteVertexArrays !=0;
+	if(s_useExtension == true)
+	{
+		GLStateCache::instance()->setBindVertexArray(bindVertexArray);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::setUseExtension(
+																				bool _use
+																			 )
 {
-  GLfloat u;
-	GLfloat v;
-	GLfloat nx;
-	GLfloat ny;
-	GLfloat nz;
-	GLfloat x;
-	GLfloat y;
-	GLfloat z;
-};
-
-	//glBindVertexArrayOES(m_id);
-	glBindBuffer(GL_ARRAY_BUFFER,m_id);
-	glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,sizeof(vertData),((float *)NULL + (5)));
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1,2,GL_FLOAT,GL_FALSE,sizeof(vertData),((float *)NULL + (0)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2,3,GL_FLOAT,GL_FALSE,sizeof(vertData),((float *)NULL + (2)));
-	glEnableVertexAttribArray(2);
-*/
+	s_allowExtension=_use;
+	if(_use == false)
+	{
+		resetBinding();
+		GLStateCache::instance()->setBindVertexArray(0);
+		s_useExtension=false;
+	}
+	else
+	{
+		s_extensionChecked=false;
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::resetBinding()
+{
+	GLStateCache::instance()->bindVertexArray(0);
+	s_layoutOwner=0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::bind()
+{
+	// no GL calls here, draw binds the GL VAO only if it isn't already bound
 	m_bound=true;
 }
 //----------------------------------------------------------------------------------------------------------------------
 void VertexArrayObject::unbind()
 {
-	//glBindVertexArrayOES(0);
-  //glEnableVertexAttribArray(0);
-  //glBindBuffer(GL_ARRAY_BUFFER,0);
-
+	// the GL VAO is left bound so drawing the same VAO again costs nothing, everything which could change
+	// its state goes through resetBinding first
 	m_bound=false;
 }
 //----------------------------------------------------------------------------------------------------------------------
@@ -102,12 +159,41 @@ void VertexArrayObject::removeVOA()
 	{
 		unbind();
 	}
+	if(m_vaoIDs.size() !=0)
+	{
+		GLStateCache *cache=GLStateCache::instance();
+		for(unsigned int i=0; i<m_vaoIDs.size(); ++i)
+		{
+			// GL binds 0 when the bound VAO is deleted so do it through the cache first
+			if(m_vaoIDs[i] == cache->getVertexArray())
+			{
+				cache->bindVertexArray(0);
+			}
+		}
+		s_deleteVertexArrays(m_vaoIDs.size(),&m_vaoIDs[0]);
+		m_vaoIDs.clear();
+		m_id=0;
+	}
+	if(s_layoutOwner == this)
+	{
+		s_layoutOwner=0;
+	}
+	m_dirty=true;
 	if( m_allocated ==true)
 	{
-	//glDeleteVertexArraysOES(1,&m_id);
 	m_allocated=false;
 	}
 }
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::setDirty()
+{
+	m_dirty=true;
+	if(s_layoutOwner == this)
+	{
+		s_layoutOwner=0;
+	}
+}
 //----------------------------------------------------------------------------------------------------------------------
 void VertexArrayObject::setData(
 																 unsigned int _size,
@@ -122,11 +208,158 @@ void VertexArrayObject::setData(
 	GLuint vboID;
 	glGenBuffers(1, &vboID);
 	m_vbos.push_back(vboID);
+	m_bufferIndicesCount.push_back(0);
 	// now we will bind an array buffer to the first one and load the data for the verts
-	glBindBuffer(GL_ARRAY_BUFFER, vboID);
+	GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, vboID);
 	glBufferData(GL_ARRAY_BUFFER, _size, &_data, _mode);
 	m_allocated=true;
+	setDirty();
+}
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::updateData(
+																	 unsigned int _index,
+																	 unsigned int _size,
+																	 const GLvoid *_data,
+																	 const std::vector< std::pair<unsigned int,unsigned int> > &_ranges
+																	)
+{
+	if(_index >= m_vbos.size() || _ranges.size() == 0)
+	{
+		return;
+	}
+	const unsigned char *data=static_cast<const unsigned char *>(_data);
+	GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, m_vbos[_index]);
+	unsigned int covered=0;
+	for(size_t i=0; i<_ranges.size(); ++i)
+	{
+		covered+=_ranges[i].second;
+	}
+	if(covered >= _size/2)
+	{
+		glBufferData(GL_ARRAY_BUFFER,_size,_data,GL_DYNAMIC_DRAW);
+		return;
+	}
+	if(s_mapBuffer !=0 && _ranges.size() > 1)
+	{
+		unsigned char *ptr=static_cast<unsigned char *>(s_mapBuffer(GL_ARRAY_BUFFER,GL_WRITE_ONLY_OES));
+		if(ptr !=0)
+		{
+			for(size_t i=0; i<_ranges.size(); ++i)
+			{
+				memcpy(ptr+_ranges[i].first,data+_ranges[i].first,_ranges[i].second);
+			}
+			if(s_unmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE)
+			{
+				return;
+			}
+			// false means the store was lost while mapped (e.g. a mode change) and the whole buffer is now
+			// undefined, not just the ranges, so it all has to be specified again
+			glBufferData(GL_ARRAY_BUFFER,_size,_data,GL_DYNAMIC_DRAW);
+			return;
+		}
+	}
+	for(size_t i=0; i<_ranges.size(); ++i)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER,_ranges[i].first,_ranges[i].second,data+_ranges[i].first);
+	}
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::setDynamicData(
+																			 unsigned int _size
+																			)
+{
+	if(m_bound == false)
+	{
+		std::cerr<<"trying to set VOA data when unbound\n";
+	}
+	if(m_vbos.size() !=0)
+	{
+		std::cerr<<"warning the dynamic buffer must be the first buffer of a VOA\n";
+		return;
+	}
+	GLuint vboID;
+	glGenBuffers(1, &vboID);
+	m_vbos.push_back(vboID);
+	m_bufferIndicesCount.push_back(0);
+	GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, vboID);
+	glBufferData(GL_ARRAY_BUFFER, _size, NULL, GL_STREAM_DRAW);
+	m_dynamicSize=_size;
+	m_dynamicOffset=0;
+	m_allocated=true;
+	setDirty();
+}
 
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::orphanDynamicData()
+{
+	if(m_dynamicSize == 0)
+	{
+		return;
+	}
+	// new storage for the same buffer name so the GL VAO and attribute pointers are still valid
+	GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, m_dynamicSize, NULL, GL_STREAM_DRAW);
+	m_dynamicOffset=0;
+	++m_dynamicOrphans;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+DynamicRange VertexArrayObject::appendData(
+																					 unsigned int _vertexSize,
+																					 unsigned int _numVerts,
+																					 const GLfloat &_data
+																					)
+{
+	DynamicRange range={0,0};
+	if(m_dynamicSize == 0 || _vertexSize == 0)
+	{
+		std::cerr<<"warning appendData needs a VOA made with setDynamicData\n";
+		return range;
+	}
+	unsigned int size=_vertexSize*_numVerts;
+	// drawRange counts in vertices so each batch starts on a whole vertex
+	unsigned int offset=((m_dynamicOffset+_vertexSize-1)/_vertexSize)*_vertexSize;
+	if(size > m_dynamicSize)
+	{
+		// grow to fit, glBufferData with a new size orphans the old storage too
+		m_dynamicSize=size;
+		orphanDynamicData();
+		offset=0;
+	}
+	else if(offset+size > m_dynamicSize)
+	{
+		orphanDynamicData();
+		offset=0;
+	}
+	GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, &_data);
+	m_dynamicOffset=offset+size;
+	range.m_first=offset/_vertexSize;
+	range.m_count=_numVerts;
+	return range;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int VertexArrayObject::setDataDeferred(
+																								unsigned int _size,
+																								const GLfloat &_data,
+																								GLenum _mode
+																							 )
+{
+	if(m_bound == false)
+	{
+		std::cerr<<"trying to set VOA data when unbound\n";
+	}
+	GLuint vboID;
+	glGenBuffers(1, &vboID);
+	m_vbos.push_back(vboID);
+	m_bufferIndicesCount.push_back(0);
+	// queueBuffer leaves the buffer bound so the attribute pointers can be set as usual
+	unsigned int id=UploadQueue::instance()->queueBuffer(GL_ARRAY_BUFFER,vboID,_size,&_data,_mode);
+	m_allocated=true;
+	setDirty();
+	return id;
 }
 
 void VertexArrayObject::setIndexedData(
@@ -137,6 +370,43 @@ void VertexArrayObject::setIndexedData(
 																			GLenum _mode
 																		 )
 {
+	setIndexedBuffers(_size,_data,_indexSize*sizeof(GLubyte),&_indexData,GL_UNSIGNED_BYTE,_mode);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::setIndexedData(
+																			unsigned int _size,
+																			const GLfloat &_data,
+																			unsigned int _indexSize,
+																			const GLushort &_indexData,
+																			GLenum _mode
+																		 )
+{
+	setIndexedBuffers(_size,_data,_indexSize*sizeof(GLushort),&_indexData,GL_UNSIGNED_SHORT,_mode);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::setIndexedData(
+																			unsigned int _size,
+																			const GLfloat &_data,
+																			unsigned int _indexSize,
+																			const GLuint &_indexData,
+																			GLenum _mode
+																		 )
+{
+	setIndexedBuffers(_size,_data,_indexSize*sizeof(GLuint),&_indexData,GL_UNSIGNED_INT,_mode);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::setIndexedBuffers(
+																					unsigned int _size,
+																					const GLfloat &_data,
+																					unsigned int _indexBytes,
+																					const GLvoid *_indexData,
+																					GLenum _indexType,
+																					GLenum _mode
+																				 )
+{
 
 	if(m_bound == false)
 	{
@@ -145,23 +415,118 @@ void VertexArrayObject::setIndexedData(
 	GLuint vboID;
 	glGenBuffers(1, &vboID);
 	m_vbos.push_back(vboID);
+	m_bufferIndicesCount.push_back(0);
 	GLuint iboID;
 	glGenBuffers(1, &iboID);
 	m_ibos.push_back(iboID);
 
 	// now we will bind an array buffer to the first one and load the data for the verts
-	glBindBuffer(GL_ARRAY_BUFFER, vboID);
+	GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, vboID);
 	glBufferData(GL_ARRAY_BUFFER, _size, &_data, _mode);
 
-// now for the indices
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexSize * sizeof(GLubyte), &_indexData, GL_STATIC_DRAW);
+// now for the indices, binding them with a GL VAO bound would change that VAO
+	resetBinding();
+	GLStateCache::instance()->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexBytes, _indexData, GL_STATIC_DRAW);
 
 	m_allocated=true;
 	m_indexed=true;
+	m_indexType=_indexType;
+	setDirty();
+}
 
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int VertexArrayObject::setIndexedDataAuto(
+																									 unsigned int _vertexSize,
+																									 unsigned int _numVerts,
+																									 const GLfloat &_data,
+																									 unsigned int _indexSize,
+																									 const GLuint &_indexData,
+																									 GLenum _mode
+																									)
+{
+	if(_indexSize == 0)
+	{
+		std::cerr<<"warning setIndexedDataAuto called with no indices, no buffer added\n";
+		return 0;
+	}
+	const GLuint *indices=&_indexData;
+	// the indices may come straight from a file so check them before they're narrowed or used to index
+	GLuint maxIndex=*std::max_element(indices,indices+_indexSize);
+	if(maxIndex >= _numVerts)
+	{
+		std::cerr<<"warning setIndexedDataAuto index "<<maxIndex<<" is out of range for "<<_numVerts<<" vertices, no buffer added\n";
+		return 0;
+	}
+	if(_numVerts <= 65536)
+	{
+		std::vector<GLushort> shortIndices(indices,indices+_indexSize);
+		setIndexedData(_numVerts*_vertexSize,_data,_indexSize,shortIndices[0],_mode);
+		return 1;
+	}
+	unsigned int primSize= m_drawMode == GL_TRIANGLES ? 3 : m_drawMode == GL_LINES ? 2 : m_drawMode == GL_POINTS ? 1 : 0;
+	if(s_uintIndices == true || primSize == 0)
+	{
+		if(s_uintIndices == false)
+		{
+			std::cerr<<"warning strips and fans can't be split and GL_OES_element_index_uint is not supported\n";
+		}
+		setIndexedData(_numVerts*_vertexSize,_data,_indexSize,_indexData,_mode);
+		return 1;
+	}
+	// greedily add whole primitives to a buffer until the next one would take it over 65536 vertices,
+	// local holds the index of each vertex in the current buffer or NOINDEX if it isn't in it yet
+	static const GLuint NOINDEX=0xffffffff;
+	const unsigned char *verts=reinterpret_cast<const unsigned char *>(&_data);
+	std::vector<GLuint> local(_numVerts,NOINDEX);
+	std::vector<GLuint> used;
+	std::vector<GLushort> partIndices;
+	std::vector<unsigned char> partVerts;
+	unsigned int buffers=0;
+	for(unsigned int i=0; ; i+=primSize)
+	{
+		bool end= i+primSize > _indexSize;
+		unsigned int added=0;
+		for(unsigned int c=0; c<primSize && end == false; ++c)
+		{
+			added+= local[indices[i+c]] == NOINDEX ? 1 : 0;
+		}
+		if(end == true || used.size()+added > 65536)
+		{
+			if(partIndices.size() !=0)
+			{
+				partVerts.resize(used.size()*_vertexSize);
+				for(size_t v=0; v<used.size(); ++v)
+				{
+					memcpy(&partVerts[v*_vertexSize],verts+size_t(used[v])*_vertexSize,_vertexSize);
+					local[used[v]]=NOINDEX;
+				}
+				setIndexedData(partVerts.size(),*reinterpret_cast<const GLfloat *>(&partVerts[0]),partIndices.size(),partIndices[0],_mode);
+				setBufferNumIndices(m_vbos.size()-1,partIndices.size());
+				++buffers;
+				used.clear();
+				partIndices.clear();
+			}
+			if(end == true)
+			{
+				break;
+			}
+		}
+		for(unsigned int c=0; c<primSize; ++c)
+		{
+			GLuint &l=local[indices[i+c]];
+			if(l == NOINDEX)
+			{
+				l=used.size();
+				used.push_back(indices[i+c]);
+			}
+			partIndices.push_back(GLushort(l));
+		}
+	}
+	return buffers;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
 GLuint VertexArrayObject::getVBOid(unsigned int _index)
 {
   GLuint id=0;
@@ -188,25 +553,131 @@ void VertexArrayObject::setVertexAttributePointer(
 		std::cerr<<"Warning trying to set attribute  on Unbound VOA\n";
 	}
 
-	m_attributes.push_back(VertexAttribute(_id,_size,_type,_stride,_dataOffset,GL_FALSE));
+	m_attributes.push_back(VertexAttribute(_id,_size,_type,_stride,_dataOffset,_normalise));
+	setDirty();
 
+}
 
+//----------------------------------------------------------------------------------------------------------------------
+unsigned int VertexArrayObject::setStreamData(
+																							unsigned int _size,
+																							const GLfloat &_data,
+																							GLenum _mode
+																						 )
+{
+	if(m_bound == false)
+	{
+		std::cerr<<"trying to set VOA stream data when unbound\n";
+	}
+	GLuint vboID;
+	glGenBuffers(1, &vboID);
+	m_streams.push_back(vboID);
+	GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, vboID);
+	glBufferData(GL_ARRAY_BUFFER, _size, &_data, _mode);
+	// put the first vertex buffer back so setVertexAttributePointer works as before
+	if(m_vbos.size() !=0)
+	{
+		GLStateCache::instance()->bindBuffer(GL_ARRAY_BUFFER, m_vbos[0]);
+	}
+	return m_streams.size()-1;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-void VertexArrayObject::draw() const
+void VertexArrayObject::setStreamAttributePointer(
+																									unsigned int _stream,
+																									GLuint _id,
+																									GLint _size,
+																									GLenum _type,
+																									GLsizei _stride,
+																									unsigned int _dataOffset,
+																									bool _normalise
+																								 )
 {
-struct vertData
+	if(_stream >= m_streams.size())
+	{
+		std::cerr<<"Warning trying to set attribute on a stream which doesn't exist\n";
+		return;
+	}
+	m_attributes.push_back(VertexAttribute(_id,_size,_type,_stride,_dataOffset,_normalise,m_streams[_stream]));
+	setDirty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::record() const
+{
+	while(m_vaoIDs.size() < m_vbos.size())
+	{
+		GLuint id;
+		s_genVertexArrays(1,&id);
+		m_vaoIDs.push_back(id);
+	}
+	// attributes are only ever added so recording over an existing VAO just sets the new ones as well
+	GLStateCache *cache=GLStateCache::instance();
+	for(unsigned int i=0; i<m_vbos.size(); ++i)
+	{
+		cache->bindVertexArray(m_vaoIDs[i]);
+		cache->bindBuffer(GL_ARRAY_BUFFER,m_vbos[i]);
+		if(m_indexed == true)
+		{
+			cache->bindBuffer(GL_ELEMENT_ARRAY_BUFFER,m_ibos[i]);
+		}
+		for(unsigned int a=0; a<m_attributes.size(); ++a)
+		{
+			m_attributes[a].bind(m_vbos[i]);
+		}
+	}
+	m_id=m_vaoIDs.size() !=0 ? m_vaoIDs[0] : 0;
+	m_dirty=false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::bindBuffer(
+																	 unsigned int _index
+																	) const
+{
+	GLStateCache *cache=GLStateCache::instance();
+	if(s_useExtension == true)
+	{
+		if(m_dirty == true)
+		{
+			record();
+		}
+		cache->bindVertexArray(m_vaoIDs[_index]);
+		return;
+	}
+	// the fallback, nothing to do if this buffer's attributes are the ones set
+	if(s_layoutOwner == this && s_layoutBuffer == _index)
+	{
+		return;
+	}
+	cache->bindBuffer(GL_ARRAY_BUFFER,m_vbos[_index]);
+	if(m_indexed == true)
+	{
+		cache->bindBuffer(GL_ELEMENT_ARRAY_BUFFER,m_ibos[_index]);
+	}
+	unsigned int enabled=0;
+	for(unsigned int a=0; a<m_attributes.size(); ++a)
+	{
+		m_attributes[a].bind(m_vbos[_index]);
+		enabled|=1u<<m_attributes[a].getID();
+	}
+	// turn off the arrays the last layout used and this one doesn't
+	unsigned int stale=cache->getEnabledAttributes() & ~enabled;
+	for(GLuint id=0; stale !=0; ++id, stale>>=1)
+	{
+		if(stale & 1)
+		{
+			cache->disableVertexAttribArray(id);
+		}
+	}
+	s_layoutOwner=this;
+	s_layoutBuffer=_index;
+	m_dirty=false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::draw() const
 {
-  GLfloat u;
-	GLfloat v;
-	GLfloat nx;
-	GLfloat ny;
-	GLfloat nz;
-	GLfloat x;
-	GLfloat y;
-	GLfloat z;
-};
 	if(m_allocated == false)
 	{
 		std::cerr<<"Warning trying to draw an unallocated VOA\n";
@@ -216,34 +687,41 @@ struct vertData
 		std::cerr<<"Warning trying to draw an unbound VOA\n";
 	}
 
-	if(m_indexed == false)
+	for(unsigned int i=0; i<m_vbos.size(); ++i)
 	{
-		for(unsigned int i=0; i<m_vbos.size(); ++i)
+		bindBuffer(i);
+		GLuint count= m_bufferIndicesCount[i]!=0 ? m_bufferIndicesCount[i] : m_indicesCount;
+		if(m_indexed == false)
 		{
-			//glBindVertexArrayOES(m_id);
-			glBindBuffer(GL_ARRAY_BUFFER,m_vbos[i]);
-			for(unsigned int a=0; a<m_attributes.size(); ++a)
-			{
-				m_attributes[a].bind();
-			}
-			glDrawArrays(m_drawMode, 0, m_indicesCount);	// draw first object
+			glDrawArrays(m_drawMode, 0, count);
 		}
+		else
+		{
+			glDrawElements(m_drawMode,count,m_indexType,0);
+		}
+	}
+}
+//----------------------------------------------------------------------------------------------------------------------
+void VertexArrayObject::drawRange(
+																	GLuint _first,
+																	GLuint _count
+																 ) const
+{
+	if(m_allocated == false)
+	{
+		std::cerr<<"Warning trying to draw an unallocated VOA\n";
+		return;
+	}
+	bindBuffer(0);
+	if(m_indexed == false)
+	{
+		glDrawArrays(m_drawMode,_first,_count);
 	}
 	else
 	{
-			std::cout<<"draw el num vbo "<<m_vbos.size()<<"\n";
-		for(unsigned int i=0; i<m_vbos.size(); ++i)
-		{
-			//glBindVertexArrayOES(m_id);
-			glBindBuffer(GL_ARRAY_BUFFER,m_vbos[i]);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibos[i]);
-
-			for(unsigned int a=0; a<m_attributes.size(); ++a)
-			{
-				m_attributes[a].bind();
-			}
-			glDrawElements(m_drawMode,m_indicesCount,GL_UNSIGNED_BYTE,0);
-		}
+		size_t indexSize= m_indexType == GL_UNSIGNED_INT ? sizeof(GLuint) :
+											m_indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLubyte);
+		glDrawElements(m_drawMode,_count,m_indexType,reinterpret_cast<const GLvoid *>(_first*indexSize));
 	}
 }
 //----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,147 @@
+/*
+  Copyright (C) 2012 Jon Macey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cmath>
+#include "VertexQuantiser.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file VertexQuantiser.cpp
+/// @brief implementation of the vertex quantisation functions
+//----------------------------------------------------------------------------------------------------------------------
+namespace ngl
+{
+
+//----------------------------------------------------------------------------------------------------------------------
+// GLES 2 converts a normalised signed value c of b bits to (2c+1)/(2^b-1) so this is the inverse
+static inline int quantiseSigned(
+                                 float _v,
+                                 int _max
+                                )
+{
+  float c=floorf((_v*(2*_max+1)-1.0f)*0.5f+0.5f);
+  return std::max(-_max-1,std::min(_max,int(c)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// unsigned normalised values are c/(2^b-1)
+static inline int quantiseUnsigned(
+                                   float _v,
+                                   int _max
+                                  )
+{
+  float c=floorf(_v*_max+0.5f);
+  return std::max(0,std::min(_max,int(c)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+Mat4 quantiseVertData(
+                      const GLfloat *_data,
+                      size_t _numVerts,
+                      std::vector<QuantisedVertData> &o_data,
+                      Vec4 *o_uvTransform
+                     )
+{
+  o_data.resize(_numVerts);
+  Mat4 dequantise;
+  if(o_uvTransform !=0)
+  {
+    o_uvTransform->set(1.0f,1.0f,0.0f,0.0f);
+  }
+  if(_numVerts == 0)
+  {
+    return dequantise;
+  }
+  // find the bounds of the positions and uvs
+  float pMin[3]={_data[5],_data[6],_data[7]};
+  float pMax[3]={_data[5],_data[6],_data[7]};
+  float uvMin[2]={_data[0],_data[1]};
+  float uvMax[2]={_data[0],_data[1]};
+  for(size_t i=0; i<_numVerts; ++i)
+  {
+    const GLfloat *d=&_data[i*8];
+    for(int a=0; a<3; ++a)
+    {
+      pMin[a]=std::min(pMin[a],d[5+a]);
+      pMax[a]=std::max(pMax[a],d[5+a]);
+    }
+    for(int a=0; a<2; ++a)
+    {
+      uvMin[a]=std::min(uvMin[a],d[a]);
+      uvMax[a]=std::max(uvMax[a],d[a]);
+    }
+  }
+  float center[3];
+  float scale=0.0f;
+  for(int a=0; a<3; ++a)
+  {
+    center[a]=(pMin[a]+pMax[a])*0.5f;
+    scale=std::max(scale,(pMax[a]-pMin[a])*0.5f);
+  }
+  if(scale == 0.0f)
+  {
+    scale=1.0f;
+  }
+  float invScale=1.0f/scale;
+  // if the uvs don't fit in 0-1 (for example tiled textures) store them relative to their bounds
+  float uvOffset[2]={0.0f,0.0f};
+  float uvScale[2]={1.0f,1.0f};
+  if(uvMin[0] < 0.0f || uvMin[1] < 0.0f || uvMax[0] > 1.0f || uvMax[1] > 1.0f)
+  {
+    for(int a=0; a<2; ++a)
+    {
+      uvOffset[a]=uvMin[a];
+      uvScale[a]= uvMax[a] > uvMin[a] ? uvMax[a]-uvMin[a] : 1.0f;
+    }
+    if(o_uvTransform !=0)
+    {
+      o_uvTransform->set(uvScale[0],uvScale[1],uvOffset[0],uvOffset[1]);
+    }
+  }
+
+  for(size_t i=0; i<_numVerts; ++i)
+  {
+    const GLfloat *d=&_data[i*8];
+    QuantisedVertData &q=o_data[i];
+    q.x=quantiseSigned((d[5]-center[0])*invScale,32767);
+    q.y=quantiseSigned((d[6]-center[1])*invScale,32767);
+    q.z=quantiseSigned((d[7]-center[2])*invScale,32767);
+    q.w=0;
+    q.nx=quantiseSigned(d[2],127);
+    q.ny=quantiseSigned(d[3],127);
+    q.nz=quantiseSigned(d[4],127);
+    q.nw=0;
+    q.u=quantiseUnsigned((d[0]-uvOffset[0])/uvScale[0],65535);
+    q.v=quantiseUnsigned((d[1]-uvOffset[1])/uvScale[1],65535);
+  }
+  // ngl matrices have the translation in the bottom row so this is p*scale+center
+  dequantise.scale(scale,scale,scale);
+  dequantise.translate(center[0],center[1],center[2]);
+  return dequantise;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+void setQuantisedVertDataAttributes(
+                                    VertexArrayObject *_vao
+                                   )
+{
+  // the offsets are in floats so x,y,z,w is at 0, nx,ny,nz,nw at 2 and u,v at 3
+  _vao->setVertexAttributePointer(0,3,GL_SHORT,sizeof(QuantisedVertData),0,true);
+  _vao->setVertexAttributePointer(1,2,GL_UNSIGNED_SHORT,sizeof(QuantisedVertData),3,true);
+  _vao->setVertexAttributePointer(2,3,GL_BYTE,sizeof(QuantisedVertData),2,true);
+}
+
+} // end ngl namespace
+//----------------------------------------------------------------------------------------------------------------------